@@ -1,3 +1,8 @@
 C:/VulkanSDK/1.2.148.0/Bin32/glslc.exe shader.vert -o vert.spv
 C:/VulkanSDK/1.2.148.0/Bin32/glslc.exe shader.frag -o frag.spv
+C:/VulkanSDK/1.2.148.0/Bin32/glslc.exe mesh.vert -o mesh_vert.spv
+C:/VulkanSDK/1.2.148.0/Bin32/glslc.exe packed_mesh.vert -o packed_mesh_vert.spv
+C:/VulkanSDK/1.2.148.0/Bin32/glslc.exe instanced.vert -o instanced_mesh_vert.spv
+C:/VulkanSDK/1.2.148.0/Bin32/glslc.exe -DPACKED instanced.vert -o instanced_packed_mesh_vert.spv
+C:/VulkanSDK/1.2.148.0/Bin32/glslc.exe cull.comp -o cull_comp.spv
 pause
\ No newline at end of file
@@ -0,0 +1,10 @@
+#!/bin/sh
+# the same as compile.bat with glslc from the PATH
+cd "$(dirname "$0")"
+glslc shader.vert -o vert.spv
+glslc shader.frag -o frag.spv
+glslc mesh.vert -o mesh_vert.spv
+glslc packed_mesh.vert -o packed_mesh_vert.spv
+glslc instanced.vert -o instanced_mesh_vert.spv
+glslc -DPACKED instanced.vert -o instanced_packed_mesh_vert.spv
+glslc cull.comp -o cull_comp.spv
\ No newline at end of file
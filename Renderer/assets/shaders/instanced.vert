@@ -0,0 +1,42 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// compiled twice: as is for Vertex meshes and with PACKED for PackedVertex meshes
+#ifdef PACKED
+layout (location = 0) in vec4 inPosition;
+layout (location = 1) in vec4 inColor;
+
+layout (push_constant) uniform Dequantization {
+	vec4 scale;
+	vec4 offset;
+} dequantization;
+#else
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+#endif
+
+// per-instance 3x4 transform, one row per binding
+layout (location = 3) in vec4 inTransform0;
+layout (location = 4) in vec4 inTransform1;
+layout (location = 5) in vec4 inTransform2;
+
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec3 fragPosition;
+
+invariant gl_Position;
+
+void main() {
+#ifdef PACKED
+	vec4 position = vec4(dequantization.offset.xyz + inPosition.xyz * dequantization.scale.xyz, 1.0);
+#else
+	vec4 position = vec4(inPosition, 1.0);
+#endif
+
+	gl_Position = vec4(dot(inTransform0, position), dot(inTransform1, position), dot(inTransform2, position), 1.0);
+#ifdef PACKED
+	fragColor = inColor;
+#else
+	fragColor = vec4(inColor, 1.0);
+#endif
+	fragPosition = gl_Position.xyz;
+}
\ No newline at end of file
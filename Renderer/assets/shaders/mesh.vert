@@ -0,0 +1,16 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec3 fragPosition;
+
+invariant gl_Position;
+
+void main() {
+	gl_Position = vec4(inPosition, 1.0);
+	fragColor = vec4(inColor, 1.0);
+	fragPosition = gl_Position.xyz;
+}
\ No newline at end of file
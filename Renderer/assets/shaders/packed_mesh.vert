@@ -0,0 +1,33 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (location = 0) in vec4 inPosition;
+layout (location = 1) in vec4 inColor;
+layout (location = 2) in vec2 inNormal;
+
+layout (push_constant) uniform Dequantization {
+	vec4 scale;
+	vec4 offset;
+} dequantization;
+
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec3 fragPosition;
+
+invariant gl_Position;
+
+vec3 decodeOctahedral(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
+void main() {
+	vec3 position = dequantization.offset.xyz + inPosition.xyz * dequantization.scale.xyz;
+	gl_Position = vec4(position, 1.0);
+
+	vec3 normal = decodeOctahedral(inNormal);
+	float lighting = 0.5 + 0.5 * max(dot(normal, normalize(vec3(0.3, -0.6, 0.7))), 0.0);
+	fragColor = vec4(inColor.rgb * lighting, inColor.a);
+	fragPosition = position;
+}
\ No newline at end of file
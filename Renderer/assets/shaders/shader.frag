@@ -1,11 +1,28 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout (location = 0) in vec3 fragColor;
+layout (location = 0) in vec4 fragColor;
+layout (location = 1) in vec3 fragPosition;
 layout (location = 0) out vec4 outColor;
 
+// permutations, see Renderer::ShaderPermutation; the branches a pipeline does not take
+// are compiled out
+layout (constant_id = 0) const uint LIGHTING = 0;
+layout (constant_id = 1) const bool ALPHA_TEST = false;
+layout (constant_id = 2) const float ALPHA_CUTOFF = 0.5;
+
+const uint LIGHTING_FLAT = 1;
+
 void main() {
-	
-	outColor = vec4(fragColor, 1.0);
+	if (ALPHA_TEST && fragColor.a < ALPHA_CUTOFF)
+		discard;
+
+	vec3 color = fragColor.rgb;
+	if (LIGHTING == LIGHTING_FLAT)
+	{
+		vec3 normal = normalize(cross(dFdx(fragPosition), dFdy(fragPosition)));
+		color *= 0.5 + 0.5 * abs(dot(normal, normalize(vec3(0.3, -0.6, 0.7))));
+	}
 
+	outColor = vec4(color, 1.0);
 }
\ No newline at end of file
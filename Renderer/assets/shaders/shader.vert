@@ -1,7 +1,11 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout (location = 0) out vec3 fragColor;
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec3 fragPosition;
+
+// the depth pre-pass runs this in a separate pipeline, depth has to match bit for bit
+invariant gl_Position;
 
 
 vec2 positions[3] = vec2[](
@@ -17,5 +21,6 @@ vec3 colors[3] = vec3[](
 
 void main() {
 	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+	fragColor = vec4(colors[gl_VertexIndex], 1.0);
+	fragPosition = gl_Position.xyz;
 }
\ No newline at end of file
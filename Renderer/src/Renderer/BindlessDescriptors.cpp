@@ -0,0 +1,188 @@
+#include "BindlessDescriptors.h"
+#include <stdexcept>
+
+void BindlessDescriptors::init(VkDevice device, LayoutCache& layouts, bool descriptorIndexing, Capacity capacity,
+	uint32_t framesInFlight, const VkDescriptorBufferInfo& defaultBuffer, const VkDescriptorImageInfo& defaultTexture)
+{
+	this->device = device;
+	this->descriptorIndexing = descriptorIndexing;
+	this->capacity = capacity;
+	this->framesInFlight = framesInFlight;
+
+	setLayoutDesc.bindings.resize(2);
+	setLayoutDesc.bindings[0].binding = bufferBinding;
+	setLayoutDesc.bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	setLayoutDesc.bindings[0].descriptorCount = capacity.buffers;
+	setLayoutDesc.bindings[0].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+	setLayoutDesc.bindings[1].binding = textureBinding;
+	setLayoutDesc.bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	setLayoutDesc.bindings[1].descriptorCount = capacity.textures;
+	setLayoutDesc.bindings[1].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+	// slots may be written while the set is bound by frames that do not read them
+	if (descriptorIndexing)
+	{
+		setLayoutDesc.bindingFlags.assign(2, VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+		setLayoutDesc.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	}
+
+	setLayout = layouts.getSetLayout(setLayoutDesc);
+
+	buffers.assign(capacity.buffers, defaultBuffer);
+	textures.assign(capacity.textures, defaultTexture);
+	bufferSlots.capacity = capacity.buffers;
+	textureSlots.capacity = capacity.textures;
+
+	if (descriptorIndexing)
+	{
+		VkDescriptorPoolSize poolSizes[] = {
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, capacity.buffers },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity.textures },
+		};
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 2;
+		poolInfo.pPoolSizes = poolSizes;
+
+		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+			throw std::runtime_error("cannot create bindless descriptor pool");
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &setLayout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+			throw std::runtime_error("cannot allocate bindless descriptor set");
+	}
+	else
+	{
+		frameAllocators.resize(framesInFlight);
+		for (auto& allocator : frameAllocators)
+			allocator.init(device, { { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, float(capacity.buffers) },
+				{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, float(capacity.textures) } }, 4);
+	}
+
+	// index 0 of both arrays
+	addBuffer(defaultBuffer.buffer, defaultBuffer.offset, defaultBuffer.range);
+	addTexture(defaultTexture.imageView, defaultTexture.sampler, defaultTexture.imageLayout);
+}
+
+void BindlessDescriptors::destroy()
+{
+	for (auto& allocator : frameAllocators)
+		allocator.destroy();
+	frameAllocators.clear();
+
+	if (pool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(device, pool, nullptr);
+}
+
+uint32_t BindlessDescriptors::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	uint32_t index = allocateSlot(bufferSlots);
+	buffers[index] = { buffer, offset, range };
+	if (descriptorIndexing)
+		writeBuffer(set, index, 1);
+	return index;
+}
+
+uint32_t BindlessDescriptors::addTexture(VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+{
+	uint32_t index = allocateSlot(textureSlots);
+	textures[index] = { sampler, imageView, layout };
+	if (descriptorIndexing)
+		writeTexture(set, index, 1);
+	return index;
+}
+
+void BindlessDescriptors::removeBuffer(uint32_t index)
+{
+	// partially bound slots may keep a dangling descriptor as long as nothing reads it
+	buffers[index] = buffers[0];
+	retireSlot(bufferSlots, index);
+}
+
+void BindlessDescriptors::removeTexture(uint32_t index)
+{
+	textures[index] = textures[0];
+	retireSlot(textureSlots, index);
+}
+
+VkDescriptorSet BindlessDescriptors::beginFrame(uint32_t frameIndex, uint64_t frameNumber, uint64_t completedFrames)
+{
+	this->frameNumber = frameNumber;
+	reclaimSlots(bufferSlots, completedFrames);
+	reclaimSlots(textureSlots, completedFrames);
+
+	if (descriptorIndexing)
+		return set;
+
+	DescriptorAllocator& allocator = frameAllocators[frameIndex];
+	allocator.reset();
+	VkDescriptorSet frameSet = allocator.allocate(setLayout);
+	writeBuffer(frameSet, 0, capacity.buffers);
+	writeTexture(frameSet, 0, capacity.textures);
+	return frameSet;
+}
+
+uint32_t BindlessDescriptors::allocateSlot(Slots& slots)
+{
+	if (!slots.free.empty())
+	{
+		uint32_t slot = slots.free.back();
+		slots.free.pop_back();
+		return slot;
+	}
+
+	if (slots.next == slots.capacity)
+		throw std::runtime_error("bindless descriptor array is full");
+
+	return slots.next++;
+}
+
+void BindlessDescriptors::retireSlot(Slots& slots, uint32_t slot)
+{
+	slots.retired.emplace_back(frameNumber, slot);
+}
+
+void BindlessDescriptors::reclaimSlots(Slots& slots, uint64_t completedFrames)
+{
+	// a slot removed during frame n may be read up to that frame
+	while (!slots.retired.empty() && slots.retired.front().first < completedFrames)
+	{
+		slots.free.push_back(slots.retired.front().second);
+		slots.retired.pop_front();
+	}
+}
+
+void BindlessDescriptors::writeBuffer(VkDescriptorSet set, uint32_t index, uint32_t count)
+{
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = bufferBinding;
+	write.dstArrayElement = index;
+	write.descriptorCount = count;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = buffers.data() + index;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void BindlessDescriptors::writeTexture(VkDescriptorSet set, uint32_t index, uint32_t count)
+{
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = textureBinding;
+	write.dstArrayElement = index;
+	write.descriptorCount = count;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = textures.data() + index;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "DescriptorAllocator.h"
+#include "LayoutCache.h"
+#include <vector>
+#include <deque>
+#include <utility>
+
+// Buffers and textures that shaders select by index, so draws switch materials with a
+// push constant instead of binding descriptor sets. With descriptor indexing it is one
+// set of large update-after-bind, partially bound arrays that is written as resources
+// come and go and stays bound. Without it the same bindings with small arrays are
+// rewritten into a new set from a per-frame DescriptorAllocator every frame.
+//
+//   layout (set = 0, binding = 0) buffer Buffers { ... } buffers[];
+//   layout (set = 0, binding = 1) uniform sampler2D textures[];
+//
+// Index 0 of both arrays is the default resource and every unused slot reads it in the
+// fallback, so shaders written against the fallback capacity work in both modes.
+class BindlessDescriptors
+{
+public:
+	struct Capacity
+	{
+		uint32_t buffers;
+		uint32_t textures;
+	};
+
+	// the set layout comes from and stays owned by the cache
+	void init(VkDevice device, LayoutCache& layouts, bool descriptorIndexing, Capacity capacity, uint32_t framesInFlight,
+		const VkDescriptorBufferInfo& defaultBuffer, const VkDescriptorImageInfo& defaultTexture);
+	void destroy();
+
+	// storage buffers; throws when the array is full
+	uint32_t addBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	uint32_t addTexture(VkImageView imageView, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	// the index is handed out again once every frame that may still read it has retired
+	void removeBuffer(uint32_t index);
+	void removeTexture(uint32_t index);
+
+	// once the frame slot's previous frame completed; completedFrames is the frame timeline's
+	// value. Returns the set to bind for the frame
+	VkDescriptorSet beginFrame(uint32_t frameIndex, uint64_t frameNumber, uint64_t completedFrames);
+
+	VkDescriptorSetLayout getSetLayout() const { return setLayout; }
+	const LayoutCache::SetLayoutDesc& getSetLayoutDesc() const { return setLayoutDesc; }
+	bool usesDescriptorIndexing() const { return descriptorIndexing; }
+	Capacity getCapacity() const { return capacity; }
+
+	static const uint32_t bufferBinding = 0;
+	static const uint32_t textureBinding = 1;
+
+private:
+	struct Slots
+	{
+		uint32_t capacity = 0;
+		// never used slots start here
+		uint32_t next = 0;
+		std::vector<uint32_t> free;
+		// removed slots with the frame that removed them, oldest first
+		std::deque<std::pair<uint64_t, uint32_t>> retired;
+	};
+
+	uint32_t allocateSlot(Slots& slots);
+	void retireSlot(Slots& slots, uint32_t slot);
+	void reclaimSlots(Slots& slots, uint64_t completedFrames);
+	void writeBuffer(VkDescriptorSet set, uint32_t index, uint32_t count);
+	void writeTexture(VkDescriptorSet set, uint32_t index, uint32_t count);
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	bool descriptorIndexing = false;
+	Capacity capacity{};
+	uint32_t framesInFlight = 0;
+	uint64_t frameNumber = 0;
+
+	LayoutCache::SetLayoutDesc setLayoutDesc;
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	// the one set of the descriptor indexing path
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	// the fallback's sets, one allocator per frame in flight
+	std::vector<DescriptorAllocator> frameAllocators;
+
+	// current contents, unused slots hold the defaults
+	std::vector<VkDescriptorBufferInfo> buffers;
+	std::vector<VkDescriptorImageInfo> textures;
+	Slots bufferSlots;
+	Slots textureSlots;
+};
\ No newline at end of file
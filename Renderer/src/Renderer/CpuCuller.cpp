@@ -0,0 +1,92 @@
+#include "CpuCuller.h"
+#include "core/JobSystem.h"
+#include <cstring>
+#include <algorithm>
+
+CpuCuller::CpuCuller()
+	: kernel(Culling::getBestKernel())
+{
+	// everything inside the clip volume of a w = 1 position
+	const float clipVolume[6][4] = {
+		{ 1.0f, 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f, 1.0f },
+		{ 0.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, -1.0f, 0.0f, 1.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f, 1.0f },
+	};
+	setFrustum(clipVolume);
+}
+
+void CpuCuller::setFrustum(const float planes[6][4])
+{
+	memcpy(frustum, planes, sizeof(frustum));
+}
+
+CullingStats CpuCuller::cull(const InstanceBatch& instances, const float sphere[4], const OcclusionBuffer* occlusion,
+	InstanceBatch& visible)
+{
+	CullingStats stats;
+	stats.objects = instances.size();
+	if (stats.objects == 0)
+	{
+		visible.resize(0);
+		return stats;
+	}
+
+	if (centerX.size() < stats.objects)
+	{
+		for (auto* array : { &centerX, &centerY, &centerZ, &radius })
+			array->resize(stats.objects);
+		visibleIndices.resize(stats.objects);
+	}
+
+	if (occlusion && !occlusion->hasOccluders())
+		occlusion = nullptr;
+
+	uint32_t count = stats.objects;
+	uint32_t jobCount = (count + instancesPerJob - 1) / instancesPerJob;
+	jobVisible.assign(jobCount, 0);
+	jobOccluded.assign(jobCount, 0);
+
+	TransformArrays transforms = instances.getArrays();
+	SphereArrays spheres = { centerX.data(), centerY.data(), centerZ.data(), radius.data() };
+	JobSystem::parallelFor(jobCount, JobSystem::getThreadCount() + 1, [&](uint32_t job) {
+		uint32_t first = job * instancesPerJob;
+		uint32_t jobSize = std::min(count - first, uint32_t(instancesPerJob));
+		uint32_t* indices = visibleIndices.data() + first;
+
+		// the job's spheres are still in cache when the kernel reads them back
+		Culling::transformSpheres(transforms, first, jobSize, sphere, centerX.data(), centerY.data(), centerZ.data(), radius.data());
+		uint32_t survivors = Culling::cullSpheres(kernel, spheres, first, jobSize, frustum, indices);
+
+		if (occlusion)
+		{
+			uint32_t kept = 0;
+			for (uint32_t k = 0; k < survivors; k++)
+			{
+				uint32_t i = indices[k];
+				indices[kept] = i;
+				kept += occlusion->isVisible(centerX[i], centerY[i], centerZ[i], radius[i]) ? 1 : 0;
+			}
+			jobOccluded[job] = survivors - kept;
+			survivors = kept;
+		}
+
+		jobVisible[job] = survivors;
+	});
+
+	jobOutput.resize(jobCount);
+	for (uint32_t job = 0; job < jobCount; job++)
+	{
+		jobOutput[job] = stats.visible;
+		stats.visible += jobVisible[job];
+		stats.occluded += jobOccluded[job];
+	}
+
+	visible.resize(stats.visible);
+	JobSystem::parallelFor(jobCount, JobSystem::getThreadCount() + 1, [&](uint32_t job) {
+		const uint32_t* indices = visibleIndices.data() + job * instancesPerJob;
+		for (uint32_t k = 0; k < jobVisible[job]; k++)
+			visible.copy(jobOutput[job] + k, instances, indices[k]);
+	});
+
+	return stats;
+}
\ No newline at end of file
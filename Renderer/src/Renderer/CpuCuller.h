@@ -0,0 +1,38 @@
+#pragma once
+#include "InstanceBatch.h"
+#include "core/Culling.h"
+#include "core/OcclusionBuffer.h"
+#include <vector>
+
+// Culls instance batches on the job system, the fallback for devices without GPU culling.
+// Every job transforms the bounding spheres of a range of instances, tests them against
+// the frustum with the widest SIMD kernel compiled in and, given an occlusion buffer,
+// tests the survivors against it. The visible instances are gathered into a compacted
+// batch in their original order.
+class CpuCuller
+{
+public:
+	CpuCuller();
+
+	// planes as (normal, distance) with the normal pointing inside
+	void setFrustum(const float planes[6][4]);
+	void setKernel(Culling::Kernel kernel) { this->kernel = kernel; }
+	Culling::Kernel getKernel() const { return kernel; }
+
+	// sphere is the mesh's bounding sphere; occlusion may be null; not reentrant
+	CullingStats cull(const InstanceBatch& instances, const float sphere[4], const OcclusionBuffer* occlusion,
+		InstanceBatch& visible);
+
+	static const uint32_t instancesPerJob = 4096;
+
+private:
+	Culling::Kernel kernel;
+	float frustum[6][4];
+
+	// scratch reused between calls, indexed like the instances
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<uint32_t> visibleIndices;
+	std::vector<uint32_t> jobVisible;
+	std::vector<uint32_t> jobOccluded;
+	std::vector<uint32_t> jobOutput;
+};
\ No newline at end of file
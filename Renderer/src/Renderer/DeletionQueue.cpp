@@ -0,0 +1,105 @@
+#include "DeletionQueue.h"
+#include <stdexcept>
+
+void DeletionQueue::init(VkDevice device, MemoryAllocator& allocator)
+{
+	this->device = device;
+	this->allocator = &allocator;
+}
+
+void DeletionQueue::destroy()
+{
+	collect(UINT64_MAX);
+}
+
+void DeletionQueue::retireBuffer(uint64_t lastUse, const Buffer& buffer)
+{
+	if (buffer.buffer == VK_NULL_HANDLE)
+		return;
+	push(buffers, lastUse, buffer);
+	pendingBytes += buffer.allocation->size;
+}
+
+void DeletionQueue::retireImage(uint64_t lastUse, const Image& image)
+{
+	if (image.image == VK_NULL_HANDLE)
+		return;
+	push(images, lastUse, image);
+	pendingBytes += image.allocation->size;
+}
+
+void DeletionQueue::retireImageView(uint64_t lastUse, VkImageView view)
+{
+	push(imageViews, lastUse, view);
+}
+
+void DeletionQueue::retireFramebuffer(uint64_t lastUse, VkFramebuffer framebuffer)
+{
+	push(framebuffers, lastUse, framebuffer);
+}
+
+void DeletionQueue::retirePipeline(uint64_t lastUse, VkPipeline pipeline)
+{
+	push(pipelines, lastUse, pipeline);
+}
+
+void DeletionQueue::retireDescriptorPool(uint64_t lastUse, VkDescriptorPool pool)
+{
+	push(descriptorPools, lastUse, pool);
+}
+
+void DeletionQueue::retireSwapChain(uint64_t lastUse, VkSwapchainKHR swapChain)
+{
+	push(swapChains, lastUse, swapChain);
+}
+
+template<typename T>
+void DeletionQueue::push(std::deque<Retired<T>>& queue, uint64_t lastUse, const T& object)
+{
+	if (!queue.empty() && lastUse < queue.back().lastUse)
+		throw std::runtime_error("resources have to be retired in timeline order");
+	queue.push_back({ lastUse, object });
+}
+
+template<typename T, typename Destroy>
+void DeletionQueue::collect(std::deque<Retired<T>>& queue, uint64_t completedValue, Destroy destroy)
+{
+	while (!queue.empty() && queue.front().lastUse <= completedValue)
+	{
+		destroy(queue.front().object);
+		queue.pop_front();
+	}
+}
+
+void DeletionQueue::collect(uint64_t completedValue)
+{
+	collect(framebuffers, completedValue, [this](VkFramebuffer framebuffer) {
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	});
+	collect(imageViews, completedValue, [this](VkImageView view) {
+		vkDestroyImageView(device, view, nullptr);
+	});
+	collect(pipelines, completedValue, [this](VkPipeline pipeline) {
+		vkDestroyPipeline(device, pipeline, nullptr);
+	});
+	collect(descriptorPools, completedValue, [this](VkDescriptorPool pool) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	});
+	collect(images, completedValue, [this](Image& image) {
+		pendingBytes -= image.allocation->size;
+		allocator->destroyImage(image);
+	});
+	collect(buffers, completedValue, [this](Buffer& buffer) {
+		pendingBytes -= buffer.allocation->size;
+		allocator->destroyBuffer(buffer);
+	});
+	collect(swapChains, completedValue, [this](VkSwapchainKHR swapChain) {
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
+	});
+}
+
+size_t DeletionQueue::getPendingCount() const
+{
+	return framebuffers.size() + imageViews.size() + pipelines.size() + descriptorPools.size() +
+		images.size() + buffers.size() + swapChains.size();
+}
\ No newline at end of file
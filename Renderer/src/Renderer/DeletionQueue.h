@@ -0,0 +1,57 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "MemoryAllocator.h"
+#include <deque>
+
+// GPU objects released while frames are in flight. Each is retired with the frame
+// timeline value of the last submission that may use it and destroyed by collect() once
+// the timeline completed that value. Values only grow, so every kind of object is kept in
+// retirement order and collect() stops at the first one still in use. Render thread only.
+class DeletionQueue
+{
+public:
+	void init(VkDevice device, MemoryAllocator& allocator);
+	// destroys everything still queued; the device has to be idle
+	void destroy();
+
+	void retireBuffer(uint64_t lastUse, const Buffer& buffer);
+	void retireImage(uint64_t lastUse, const Image& image);
+	void retireImageView(uint64_t lastUse, VkImageView view);
+	void retireFramebuffer(uint64_t lastUse, VkFramebuffer framebuffer);
+	void retirePipeline(uint64_t lastUse, VkPipeline pipeline);
+	void retireDescriptorPool(uint64_t lastUse, VkDescriptorPool pool);
+	void retireSwapChain(uint64_t lastUse, VkSwapchainKHR swapChain);
+
+	void collect(uint64_t completedValue);
+
+	size_t getPendingCount() const;
+	// memory of the queued buffers and images
+	VkDeviceSize getPendingBytes() const { return pendingBytes; }
+
+private:
+	template<typename T>
+	struct Retired
+	{
+		uint64_t lastUse;
+		T object;
+	};
+
+	template<typename T>
+	static void push(std::deque<Retired<T>>& queue, uint64_t lastUse, const T& object);
+	template<typename T, typename Destroy>
+	static void collect(std::deque<Retired<T>>& queue, uint64_t completedValue, Destroy destroy);
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+
+	// destroyed in this order, users before what they use
+	std::deque<Retired<VkFramebuffer>> framebuffers;
+	std::deque<Retired<VkImageView>> imageViews;
+	std::deque<Retired<VkPipeline>> pipelines;
+	std::deque<Retired<VkDescriptorPool>> descriptorPools;
+	std::deque<Retired<Image>> images;
+	std::deque<Retired<Buffer>> buffers;
+	std::deque<Retired<VkSwapchainKHR>> swapChains;
+	VkDeviceSize pendingBytes = 0;
+};
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "DescriptorAllocator.h"
+#include <stdexcept>
+#include <cmath>
+
+void DescriptorAllocator::init(VkDevice device, const std::vector<PoolSize>& poolSizes, uint32_t setsPerPool)
+{
+	this->device = device;
+	this->poolSizes = poolSizes;
+	this->setsPerPool = setsPerPool;
+}
+
+void DescriptorAllocator::destroy()
+{
+	reset();
+	for (VkDescriptorPool pool : freePools)
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	freePools.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::grabPool()
+{
+	if (!freePools.empty())
+	{
+		VkDescriptorPool pool = freePools.back();
+		freePools.pop_back();
+		return pool;
+	}
+
+	std::vector<VkDescriptorPoolSize> sizes;
+	for (const PoolSize& size : poolSizes)
+		sizes.push_back({ size.type, uint32_t(std::ceil(size.perSet * setsPerPool)) });
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = setsPerPool;
+	poolInfo.poolSizeCount = uint32_t(sizes.size());
+	poolInfo.pPoolSizes = sizes.data();
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("cannot create descriptor pool");
+
+	return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+	if (currentPool == VK_NULL_HANDLE)
+		currentPool = grabPool();
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = currentPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set;
+	VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &set);
+	if (result == VK_SUCCESS)
+		return set;
+
+	if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+		throw std::runtime_error("cannot allocate descriptor set");
+
+	// one retry with an empty pool, failing again means the set can never fit
+	usedPools.push_back(currentPool);
+	currentPool = grabPool();
+	allocInfo.descriptorPool = currentPool;
+	if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+		throw std::runtime_error("descriptor set does not fit an empty pool");
+
+	return set;
+}
+
+void DescriptorAllocator::reset()
+{
+	if (currentPool != VK_NULL_HANDLE)
+		usedPools.push_back(currentPool);
+	currentPool = VK_NULL_HANDLE;
+
+	for (VkDescriptorPool pool : usedPools)
+	{
+		vkResetDescriptorPool(device, pool, 0);
+		freePools.push_back(pool);
+	}
+	usedPools.clear();
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vector>
+
+// Hands out descriptor sets from a growing list of pools. Sets are never freed one by
+// one: reset() recycles every pool at once, typically when the frame that used them
+// has retired. A pool that runs out is set aside and a recycled or new one takes over.
+class DescriptorAllocator
+{
+public:
+	struct PoolSize
+	{
+		VkDescriptorType type;
+		// descriptors of this type per set the pool is sized for
+		float perSet;
+	};
+
+	void init(VkDevice device, const std::vector<PoolSize>& poolSizes, uint32_t setsPerPool = 64);
+	void destroy();
+
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+	void reset();
+
+	uint32_t getPoolCount() const { return uint32_t(usedPools.size() + freePools.size() + (currentPool ? 1 : 0)); }
+
+private:
+	VkDescriptorPool grabPool();
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	std::vector<PoolSize> poolSizes;
+	uint32_t setsPerPool = 0;
+
+	VkDescriptorPool currentPool = VK_NULL_HANDLE;
+	// full pools waiting for reset(), and reset ones ready for reuse
+	std::vector<VkDescriptorPool> usedPools;
+	std::vector<VkDescriptorPool> freePools;
+};
\ No newline at end of file
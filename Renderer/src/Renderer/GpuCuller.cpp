@@ -0,0 +1,435 @@
+#include "GpuCuller.h"
+#include "PipelineCompiler.h"
+#include "ShaderReflection.h"
+#include "Renderer.h"
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+namespace
+{
+	struct CullPushConstants
+	{
+		float sphere[4];
+		uint32_t objectCount;
+		uint32_t transformBase;
+		uint32_t visibleBase;
+		uint32_t visibleCapacity;
+		uint32_t indexCount;
+		uint32_t batchIndex;
+		uint32_t firstInstance;
+	};
+
+	// cull.comp's specialization constants
+	struct CullSpecialization
+	{
+		VkBool32 compactCommands;
+		uint32_t maxBatches;
+	};
+
+	// the frustum lives at the start of the readback buffer, the copied commands after it
+	const VkDeviceSize commandsReadbackOffset = 256;
+	const uint32_t workgroupSize = 64;
+	// survivors the visible transforms hold before the first frame grows them
+	const uint32_t initialVisibleCapacity = 1024;
+}
+
+void GpuCuller::init(VkDevice device, VkPipelineCache cache, MemoryAllocator& allocator, LayoutCache& layouts,
+	const Features& features, VkBuffer transformBuffer, uint32_t framesInFlight)
+{
+	this->device = device;
+	this->pipelineCache = cache;
+	this->allocator = &allocator;
+	this->layouts = &layouts;
+	this->features = features;
+	this->transformBuffer = transformBuffer;
+	// the compacted commands of a run read different batches' survivors, firstInstance
+	// tells them apart
+	indirectCount = features.drawIndexedIndirectCount != nullptr && features.multiDrawIndirect &&
+		features.drawIndirectFirstInstance;
+
+	// everything inside the clip volume of a w = 1 position
+	const float clipVolume[6][4] = {
+		{ 1.0f, 0.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 0.0f, 1.0f },
+		{ 0.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, -1.0f, 0.0f, 1.0f },
+		{ 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f, 1.0f },
+	};
+	setFrustum(clipVolume);
+
+	// the layout is whatever the shader declares; the descriptor writes below and the push
+	// constant struct still have to agree with it
+	std::vector<char> code = Renderer::readFile(shaderPath);
+	ShaderReflection reflection = ShaderReflection::reflect(code);
+	if (reflection.pushConstantSize != sizeof(CullPushConstants))
+		throw std::runtime_error("cull_comp.spv push constants do not match CullPushConstants");
+
+	LayoutCache::PipelineLayoutDesc layoutDesc = LayoutCache::describe({ &reflection });
+	if (layoutDesc.sets.size() != 1 || layoutDesc.sets[0].bindings.size() != 5)
+		throw std::runtime_error("cull_comp.spv does not declare the five culling bindings of set 0");
+	descriptorSetLayout = layouts.getSetLayout(layoutDesc.sets[0]);
+	pipelineLayout = layouts.getPipelineLayout(layoutDesc);
+
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto& binding : layoutDesc.sets[0].bindings)
+	{
+		auto sameType = [&binding](const VkDescriptorPoolSize& size) { return size.type == binding.descriptorType; };
+		auto size = std::find_if(poolSizes.begin(), poolSizes.end(), sameType);
+		if (size == poolSizes.end())
+			poolSizes.push_back({ binding.descriptorType, binding.descriptorCount * framesInFlight });
+		else
+			size->descriptorCount += binding.descriptorCount * framesInFlight;
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = framesInFlight;
+	poolInfo.poolSizeCount = uint32_t(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("cannot create culling descriptor pool");
+
+	VkShaderModule module = PipelineCompiler::createShaderModule(device, code);
+	pipeline = createPipeline(module, false);
+	if (indirectCount && pipeline != VK_NULL_HANDLE)
+		compactPipeline = createPipeline(module, true);
+	vkDestroyShaderModule(device, module, nullptr);
+	if (pipeline == VK_NULL_HANDLE || (indirectCount && compactPipeline == VK_NULL_HANDLE))
+		throw std::runtime_error("cannot create culling pipeline");
+
+	frames.resize(framesInFlight);
+	for (auto& frame : frames)
+	{
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		bufferInfo.size = 2 * maxBatches * sizeof(VkDrawIndexedIndirectCommand);
+		bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		frame.commands = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		bufferInfo.size = maxBatches * sizeof(uint32_t);
+		bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		frame.counts = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		bufferInfo.size = commandsReadbackOffset + maxBatches * sizeof(VkDrawIndexedIndirectCommand);
+		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		frame.readback = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &descriptorSetLayout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &frame.descriptorSet) != VK_SUCCESS)
+			throw std::runtime_error("cannot allocate culling descriptor set");
+
+		// writes the descriptor set
+		ensureVisibleCapacity(frame, initialVisibleCapacity);
+	}
+}
+
+void GpuCuller::destroy()
+{
+	for (auto& frame : frames)
+	{
+		allocator->destroyBuffer(frame.commands);
+		allocator->destroyBuffer(frame.counts);
+		allocator->destroyBuffer(frame.visible);
+		allocator->destroyBuffer(frame.readback);
+	}
+	frames.clear();
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipeline(device, compactPipeline, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+}
+
+void GpuCuller::setFrustum(const float planes[6][4])
+{
+	memcpy(frustum, planes, sizeof(frustum));
+}
+
+std::vector<VkPipeline> GpuCuller::reloadPipelines()
+{
+	std::vector<char> code = Renderer::readFile(shaderPath);
+	ShaderReflection reflection = ShaderReflection::reflect(code);
+	// the cache hands out the same layout for the same description
+	if (reflection.pushConstantSize != sizeof(CullPushConstants) ||
+		layouts->getPipelineLayout(LayoutCache::describe({ &reflection })) != pipelineLayout)
+		throw std::runtime_error("cull_comp.spv no longer matches the culling layout");
+
+	VkShaderModule module = PipelineCompiler::createShaderModule(device, code);
+	VkPipeline newPipeline = createPipeline(module, false);
+	VkPipeline newCompactPipeline = VK_NULL_HANDLE;
+	if (indirectCount && newPipeline != VK_NULL_HANDLE)
+		newCompactPipeline = createPipeline(module, true);
+	vkDestroyShaderModule(device, module, nullptr);
+
+	if (newPipeline == VK_NULL_HANDLE || (indirectCount && newCompactPipeline == VK_NULL_HANDLE))
+	{
+		vkDestroyPipeline(device, newPipeline, nullptr);
+		throw std::runtime_error("cannot create culling pipeline");
+	}
+
+	std::vector<VkPipeline> replaced = { pipeline };
+	if (compactPipeline != VK_NULL_HANDLE)
+		replaced.push_back(compactPipeline);
+
+	pipeline = newPipeline;
+	compactPipeline = newCompactPipeline;
+	return replaced;
+}
+
+VkPipeline GpuCuller::createPipeline(VkShaderModule module, bool compactCommands) const
+{
+	CullSpecialization specialization = { compactCommands ? VK_TRUE : VK_FALSE, maxBatches };
+	const VkSpecializationMapEntry entries[] = {
+		{ 0, offsetof(CullSpecialization, compactCommands), sizeof(VkBool32) },
+		{ 1, offsetof(CullSpecialization, maxBatches), sizeof(uint32_t) },
+	};
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = 2;
+	specializationInfo.pMapEntries = entries;
+	specializationInfo.dataSize = sizeof(specialization);
+	specializationInfo.pData = &specialization;
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = module;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+	pipelineInfo.layout = pipelineLayout;
+
+	VkPipeline result = VK_NULL_HANDLE;
+	if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &result) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+	return result;
+}
+
+uint32_t GpuCuller::addBatch(VkDeviceSize transformOffset, uint32_t objectCount, uint32_t indexCount,
+	const float sphere[4], bool continueRun)
+{
+	if (batches.size() == maxBatches)
+		throw std::runtime_error("too many culled batches in one frame");
+
+	Batch batch;
+	memcpy(batch.sphere, sphere, sizeof(batch.sphere));
+	batch.objectCount = objectCount;
+	batch.transformBase = uint32_t(transformOffset / (4 * sizeof(float)));
+	// the survivors of all batches share one set of arrays, each batch gets a range
+	batch.visibleBase = this->objectCount;
+	batch.indexCount = indexCount;
+	batch.index = uint32_t(batches.size());
+	batch.runStart = batch.index;
+	batch.runLength = 1;
+	if (continueRun && !batches.empty())
+	{
+		batch.runStart = batches.back().runStart;
+		batches[batch.runStart].runLength++;
+	}
+
+	batches.push_back(batch);
+	this->objectCount += objectCount;
+	return batch.index;
+}
+
+void GpuCuller::ensureVisibleCapacity(FrameResources& frame, uint32_t objectCount)
+{
+	if (objectCount <= frame.visibleCapacity)
+		return;
+
+	// the frame slot's fence has been waited on, so nothing still reads the old buffer
+	if (frame.visible.buffer != VK_NULL_HANDLE)
+		allocator->destroyBuffer(frame.visible);
+
+	frame.visibleCapacity = std::max(objectCount, frame.visibleCapacity * 2);
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = 3 * VkDeviceSize(frame.visibleCapacity) * 4 * sizeof(float);
+	bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	frame.visible = allocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	writeDescriptorSet(frame);
+}
+
+void GpuCuller::writeDescriptorSet(FrameResources& frame)
+{
+	VkDescriptorBufferInfo bufferInfos[] = {
+		{ transformBuffer, 0, VK_WHOLE_SIZE },
+		{ frame.commands.buffer, 0, VK_WHOLE_SIZE },
+		{ frame.visible.buffer, 0, VK_WHOLE_SIZE },
+		{ frame.readback.buffer, 0, sizeof(frustum) },
+		{ frame.counts.buffer, 0, VK_WHOLE_SIZE },
+	};
+
+	VkWriteDescriptorSet writes[5]{};
+	for (uint32_t i = 0; i < 5; i++)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = frame.descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = i == 3 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(device, 5, writes, 0, nullptr);
+}
+
+void GpuCuller::recordCulling(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	FrameResources& frame = frames[frameIndex];
+	frame.recordedBatches = uint32_t(batches.size());
+	frame.recordedObjects = objectCount;
+
+	if (batches.empty())
+		return;
+
+	memcpy(frame.readback.allocation->mapped, frustum, sizeof(frustum));
+	allocator->flush(frame.readback.allocation, 0, sizeof(frustum));
+	ensureVisibleCapacity(frame, objectCount);
+
+	// the instance counts start at 0, the shader fills in the rest
+	VkDeviceSize commandsSize = batches.size() * sizeof(VkDrawIndexedIndirectCommand);
+	vkCmdFillBuffer(commandBuffer, frame.commands.buffer, 0, commandsSize, 0);
+	if (indirectCount)
+		vkCmdFillBuffer(commandBuffer, frame.counts.buffer, 0, batches.size() * sizeof(uint32_t), 0);
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+
+	for (const Batch& batch : batches)
+	{
+		CullPushConstants constants;
+		memcpy(constants.sphere, batch.sphere, sizeof(constants.sphere));
+		constants.objectCount = batch.objectCount;
+		constants.transformBase = batch.transformBase;
+		constants.visibleBase = batch.visibleBase;
+		constants.visibleCapacity = frame.visibleCapacity;
+		constants.indexCount = batch.indexCount;
+		constants.batchIndex = batch.index;
+		// without firstInstance each batch's draw binds its own range instead
+		constants.firstInstance = indirectCount ? batch.visibleBase : 0;
+
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, (batch.objectCount + workgroupSize - 1) / workgroupSize, 1, 1);
+	}
+
+	if (indirectCount)
+	{
+		// the compaction reads the final instance counts
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compactPipeline);
+		for (const Batch& batch : batches)
+		{
+			if (batch.runStart != batch.index)
+				continue;
+
+			CullPushConstants constants{};
+			constants.objectCount = batch.runLength;
+			constants.batchIndex = batch.index;
+
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+			vkCmdDispatch(commandBuffer, (batch.runLength + workgroupSize - 1) / workgroupSize, 1, 1);
+		}
+	}
+
+	// only for the readback, the frame graph orders the indirect reads of the draws
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	VkBufferCopy region = { 0, commandsReadbackOffset, commandsSize };
+	vkCmdCopyBuffer(commandBuffer, frame.commands.buffer, frame.readback.buffer, 1, &region);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCuller::recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t firstBatch, uint32_t batchCount) const
+{
+	const FrameResources& frame = frames[frameIndex];
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	const uint32_t endBatch = firstBatch + batchCount;
+
+	if (!indirectCount)
+	{
+		for (uint32_t i = firstBatch; i < endBatch; i++)
+		{
+			bindVisibleTransforms(commandBuffer, frame, batches[i].visibleBase);
+			vkCmdDrawIndexedIndirect(commandBuffer, frame.commands.buffer, VkDeviceSize(i) * stride, 1, stride);
+		}
+		return;
+	}
+
+	// the commands' firstInstance points each batch at its survivors
+	bindVisibleTransforms(commandBuffer, frame, 0);
+	for (uint32_t i = firstBatch; i < endBatch;)
+	{
+		const Batch& batch = batches[i];
+		if (batch.runStart == i && i + batch.runLength <= endBatch)
+		{
+			features.drawIndexedIndirectCount(commandBuffer, frame.commands.buffer, VkDeviceSize(maxBatches + i) * stride,
+				frame.counts.buffer, VkDeviceSize(i) * sizeof(uint32_t), batch.runLength, stride);
+			i += batch.runLength;
+			continue;
+		}
+
+		// a run split between command buffers falls back to its batches' own commands
+		vkCmdDrawIndexedIndirect(commandBuffer, frame.commands.buffer, VkDeviceSize(i) * stride, 1, stride);
+		i++;
+	}
+}
+
+void GpuCuller::bindVisibleTransforms(VkCommandBuffer commandBuffer, const FrameResources& frame, uint32_t firstObject) const
+{
+	VkDeviceSize rowSize = VkDeviceSize(frame.visibleCapacity) * 4 * sizeof(float);
+	VkDeviceSize offset = VkDeviceSize(firstObject) * 4 * sizeof(float);
+	VkBuffer buffers[] = { frame.visible.buffer, frame.visible.buffer, frame.visible.buffer };
+	VkDeviceSize offsets[] = { offset, rowSize + offset, 2 * rowSize + offset };
+	vkCmdBindVertexBuffers(commandBuffer, 1, 3, buffers, offsets);
+}
+
+bool GpuCuller::readStats(uint32_t frameIndex, CullingStats& stats)
+{
+	FrameResources& frame = frames[frameIndex];
+	if (frame.recordedBatches == 0)
+		return false;
+
+	allocator->invalidate(frame.readback.allocation, commandsReadbackOffset,
+		frame.recordedBatches * sizeof(VkDrawIndexedIndirectCommand));
+
+	const VkDrawIndexedIndirectCommand* commands = reinterpret_cast<const VkDrawIndexedIndirectCommand*>(
+		static_cast<const char*>(frame.readback.allocation->mapped) + commandsReadbackOffset);
+	stats.objects = frame.recordedObjects;
+	stats.visible = 0;
+	for (uint32_t i = 0; i < frame.recordedBatches; i++)
+		stats.visible += commands[i].instanceCount;
+
+	return true;
+}
\ No newline at end of file
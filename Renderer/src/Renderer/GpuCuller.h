@@ -0,0 +1,121 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "MemoryAllocator.h"
+#include "LayoutCache.h"
+#include "core/Culling.h"
+#include <vector>
+#include <string>
+
+// Frustum culls instance batches in a compute pass ahead of the render pass. The
+// survivors' transforms are packed into a per-frame set of transform arrays, and one
+// VkDrawIndexedIndirectCommand per batch draws them with the surviving instance count.
+// Consecutive batches drawn with the same state form a run. With VK_KHR_draw_indirect_count
+// a second pass compacts each run's non-empty commands and one indirect count draw covers
+// the whole run; otherwise every batch is its own indirect draw.
+class GpuCuller
+{
+public:
+	struct Features
+	{
+		bool multiDrawIndirect;
+		bool drawIndirectFirstInstance;
+		PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount;
+	};
+
+	// the layouts are reflected from cull_comp.spv and owned by the cache
+	void init(VkDevice device, VkPipelineCache cache, MemoryAllocator& allocator, LayoutCache& layouts,
+		const Features& features, VkBuffer transformBuffer, uint32_t framesInFlight);
+	void destroy();
+	// Rebuilds the pipelines from a recompiled cull_comp.spv and returns the replaced ones
+	// for the caller to retire. Throws, keeping the old pipelines, on a module that no
+	// longer fits the layout.
+	std::vector<VkPipeline> reloadPipelines();
+
+	// planes as (normal, distance) with the normal pointing inside
+	void setFrustum(const float planes[6][4]);
+
+	// Transforms are three arrays of objectCount vec4 rows starting at transformOffset in
+	// the transform buffer; sphere is the mesh's bounding sphere. continueRun puts the batch
+	// in the previous batch's run, the caller promises both draw with the same state.
+	// Returns the batch index.
+	uint32_t addBatch(VkDeviceSize transformOffset, uint32_t objectCount, uint32_t indexCount,
+		const float sphere[4], bool continueRun);
+
+	// records the culling dispatches of this frame's batches; outside a render pass
+	void recordCulling(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	// Draws batchCount consecutive batches with the state bound for the first one and binds
+	// the survivors as instance bindings 1 to 3. Runs wholly inside the range go out as one
+	// indirect count draw, the batches of runs it splits one by one.
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t firstBatch, uint32_t batchCount) const;
+	// forgets this frame's batches once they have been recorded
+	void endFrame()
+	{
+		batches.clear();
+		objectCount = 0;
+	}
+
+	bool drawsWithIndirectCount() const { return indirectCount; }
+
+	// counts of an earlier use of the frame slot; call once its fence signalled
+	bool readStats(uint32_t frameIndex, CullingStats& stats);
+
+	static const uint32_t maxBatches = 256;
+	static constexpr const char* shaderPath = "assets/shaders/cull_comp.spv";
+
+private:
+	struct Batch
+	{
+		float sphere[4];
+		uint32_t objectCount;
+		uint32_t transformBase;
+		uint32_t visibleBase;
+		uint32_t indexCount;
+		uint32_t index;
+		// the first batch of the run, which alone keeps the run's length
+		uint32_t runStart;
+		uint32_t runLength;
+	};
+
+	struct FrameResources
+	{
+		// maxBatches commands, one per batch, then as many for the compacted runs
+		Buffer commands;
+		// maxBatches draw counts, each run's at its first batch
+		Buffer counts;
+		// three arrays of visibleCapacity transform rows
+		Buffer visible;
+		uint32_t visibleCapacity = 0;
+		// host visible frustum and commands copied back for statistics
+		Buffer readback;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		uint32_t recordedBatches = 0;
+		uint32_t recordedObjects = 0;
+	};
+
+	VkPipeline createPipeline(VkShaderModule module, bool compactCommands) const;
+	void ensureVisibleCapacity(FrameResources& frame, uint32_t objectCount);
+	void writeDescriptorSet(FrameResources& frame);
+	void bindVisibleTransforms(VkCommandBuffer commandBuffer, const FrameResources& frame, uint32_t firstObject) const;
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+	LayoutCache* layouts = nullptr;
+	Features features{};
+	// indirect count draws with firstInstance selecting each batch's survivors
+	bool indirectCount = false;
+	VkBuffer transformBuffer = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	// the same shader with COMPACT_COMMANDS, indirect count only
+	VkPipeline compactPipeline = VK_NULL_HANDLE;
+
+	std::vector<FrameResources> frames;
+	std::vector<Batch> batches;
+	uint32_t objectCount = 0;
+	float frustum[6][4];
+};
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "GpuTimeline.h"
+#include <stdexcept>
+
+void GpuTimeline::init(VkDevice device, bool timelineSemaphore)
+{
+	this->device = device;
+	submittedValue = 0;
+	completedValue = 0;
+
+	if (!timelineSemaphore)
+		return;
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+		throw std::runtime_error("cannot create timeline semaphore");
+}
+
+void GpuTimeline::destroy()
+{
+	if (semaphore != VK_NULL_HANDLE)
+		vkDestroySemaphore(device, semaphore, nullptr);
+	semaphore = VK_NULL_HANDLE;
+
+	std::lock_guard<std::mutex> lock(fenceMutex);
+	for (const PendingFence& pending : pendingFences)
+		vkDestroyFence(device, pending.fence, nullptr);
+	for (VkFence fence : signalledFences)
+		vkDestroyFence(device, fence, nullptr);
+	for (VkFence fence : freeFences)
+		vkDestroyFence(device, fence, nullptr);
+	pendingFences.clear();
+	signalledFences.clear();
+	freeFences.clear();
+}
+
+VkResult GpuTimeline::submit(VkQueue queue, const VkSubmitInfo& submitInfo)
+{
+	uint64_t value = submittedValue + 1;
+
+	if (semaphore != VK_NULL_HANDLE)
+	{
+		// values for the binary semaphores among the signals are ignored
+		signalSemaphores.assign(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+		signalSemaphores.push_back(semaphore);
+		signalValues.assign(signalSemaphores.size(), 0);
+		signalValues.back() = value;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.pNext = submitInfo.pNext;
+		timelineInfo.signalSemaphoreValueCount = signalValues.size();
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+		VkSubmitInfo timelineSubmit = submitInfo;
+		timelineSubmit.pNext = &timelineInfo;
+		timelineSubmit.signalSemaphoreCount = signalSemaphores.size();
+		timelineSubmit.pSignalSemaphores = signalSemaphores.data();
+
+		VkResult result = vkQueueSubmit(queue, 1, &timelineSubmit, VK_NULL_HANDLE);
+		if (result == VK_SUCCESS)
+			submittedValue = value;
+		return result;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(fenceMutex);
+		freeFences.insert(freeFences.end(), signalledFences.begin(), signalledFences.end());
+		signalledFences.clear();
+	}
+
+	VkFence fence;
+	if (!freeFences.empty())
+	{
+		fence = freeFences.back();
+		freeFences.pop_back();
+		vkResetFences(device, 1, &fence);
+	}
+	else
+	{
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+			throw std::runtime_error("cannot create submission fence");
+	}
+
+	VkResult result = vkQueueSubmit(queue, 1, &submitInfo, fence);
+	if (result != VK_SUCCESS)
+	{
+		freeFences.push_back(fence);
+		return result;
+	}
+
+	std::lock_guard<std::mutex> lock(fenceMutex);
+	pendingFences.push_back({ value, fence });
+	submittedValue = value;
+	return result;
+}
+
+void GpuTimeline::wait(uint64_t value)
+{
+	if (value > submittedValue)
+		throw std::runtime_error("cannot wait for a submission that was never made");
+
+	if (semaphore != VK_NULL_HANDLE)
+	{
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+
+		if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+			throw std::runtime_error("cannot wait for timeline semaphore");
+		return;
+	}
+
+	VkFence fence;
+	{
+		std::lock_guard<std::mutex> lock(fenceMutex);
+		if (value <= completedValue)
+			return;
+		// one fence per value, in order from completedValue + 1
+		fence = pendingFences[value - completedValue - 1].fence;
+	}
+
+	// readers may retire the fence meanwhile, but only submit() on this thread resets it
+	vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+	getCompletedValue();
+}
+
+uint64_t GpuTimeline::getCompletedValue() const
+{
+	if (semaphore != VK_NULL_HANDLE)
+	{
+		uint64_t value;
+		if (vkGetSemaphoreCounterValue(device, semaphore, &value) != VK_SUCCESS)
+			throw std::runtime_error("cannot read timeline semaphore");
+		return value;
+	}
+
+	std::lock_guard<std::mutex> lock(fenceMutex);
+	while (!pendingFences.empty() && vkGetFenceStatus(device, pendingFences.front().fence) == VK_SUCCESS)
+	{
+		completedValue = pendingFences.front().value;
+		signalledFences.push_back(pendingFences.front().fence);
+		pendingFences.pop_front();
+	}
+	return completedValue;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vector>
+#include <deque>
+#include <mutex>
+
+// Progress of the submissions to one queue as a counter: the n-th submission signals n
+// when it completes, 0 means nothing completed yet. Backed by a timeline semaphore where
+// the device supports them; otherwise every submission gets a fence, and the fences are
+// polled in submission order.
+//
+// submit() and wait() belong to the thread that owns the queue, the completed value can
+// be read from any thread and never blocks.
+class GpuTimeline
+{
+public:
+	void init(VkDevice device, bool timelineSemaphore);
+	void destroy();
+
+	// appends the signal of the next value to the submission, which must not chain
+	// timeline values of its own
+	VkResult submit(VkQueue queue, const VkSubmitInfo& submitInfo);
+	void wait(uint64_t value);
+
+	uint64_t getCompletedValue() const;
+	bool isComplete(uint64_t value) const { return value <= getCompletedValue(); }
+	// the value of the latest submission
+	uint64_t getSubmittedValue() const { return submittedValue; }
+	bool usesTimelineSemaphore() const { return semaphore != VK_NULL_HANDLE; }
+
+private:
+	struct PendingFence
+	{
+		uint64_t value;
+		VkFence fence;
+	};
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	uint64_t submittedValue = 0;
+	std::vector<VkSemaphore> signalSemaphores;
+	std::vector<uint64_t> signalValues;
+
+	// the fence path; signalled fences are recycled by submit(), never by readers
+	mutable std::mutex fenceMutex;
+	mutable std::deque<PendingFence> pendingFences;
+	mutable std::vector<VkFence> signalledFences;
+	mutable uint64_t completedValue = 0;
+	std::vector<VkFence> freeFences;
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#include "core/Math.h"
+#include <vector>
+#include <cstdint>
+
+// Per-instance transforms of one mesh kept as structure of arrays, so composing the
+// matrices streams through memory and vectorizes.
+class InstanceBatch
+{
+public:
+	uint32_t add(Vec3 position, Quat rotation = { 0.0f, 0.0f, 0.0f, 1.0f }, float scale = 1.0f)
+	{
+		positionX.push_back(position.x);
+		positionY.push_back(position.y);
+		positionZ.push_back(position.z);
+		rotationX.push_back(rotation.x);
+		rotationY.push_back(rotation.y);
+		rotationZ.push_back(rotation.z);
+		rotationW.push_back(rotation.w);
+		scales.push_back(scale);
+		return uint32_t(scales.size() - 1);
+	}
+
+	void setPosition(uint32_t index, Vec3 position)
+	{
+		positionX[index] = position.x;
+		positionY[index] = position.y;
+		positionZ[index] = position.z;
+	}
+
+	void setRotation(uint32_t index, Quat rotation)
+	{
+		rotationX[index] = rotation.x;
+		rotationY[index] = rotation.y;
+		rotationZ[index] = rotation.z;
+		rotationW[index] = rotation.w;
+	}
+
+	void setScale(uint32_t index, float scale) { scales[index] = scale; }
+
+	void clear()
+	{
+		for (auto* array : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scales })
+			array->clear();
+	}
+
+	void resize(uint32_t count)
+	{
+		for (auto* array : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scales })
+			array->resize(count);
+	}
+
+	// overwrites one instance, e.g. to gather a subset of another batch
+	void copy(uint32_t index, const InstanceBatch& source, uint32_t sourceIndex)
+	{
+		positionX[index] = source.positionX[sourceIndex];
+		positionY[index] = source.positionY[sourceIndex];
+		positionZ[index] = source.positionZ[sourceIndex];
+		rotationX[index] = source.rotationX[sourceIndex];
+		rotationY[index] = source.rotationY[sourceIndex];
+		rotationZ[index] = source.rotationZ[sourceIndex];
+		rotationW[index] = source.rotationW[sourceIndex];
+		scales[index] = source.scales[sourceIndex];
+	}
+
+	uint32_t size() const { return uint32_t(scales.size()); }
+
+	TransformArrays getArrays() const
+	{
+		return { positionX.data(), positionY.data(), positionZ.data(),
+			rotationX.data(), rotationY.data(), rotationZ.data(), rotationW.data(), scales.data() };
+	}
+
+private:
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scales;
+};
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "LayoutCache.h"
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+
+void LayoutCache::init(VkDevice device)
+{
+	this->device = device;
+}
+
+void LayoutCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const auto& entry : pipelineLayouts)
+		vkDestroyPipelineLayout(device, entry.second, nullptr);
+	for (const auto& entry : setLayouts)
+		vkDestroyDescriptorSetLayout(device, entry.second, nullptr);
+	pipelineLayouts.clear();
+	setLayouts.clear();
+}
+
+size_t LayoutCache::KeyHash::operator()(const Key& key) const
+{
+	// FNV-1a over the words
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t word : key)
+	{
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+	return size_t(hash);
+}
+
+LayoutCache::Key LayoutCache::getKey(const SetLayoutDesc& desc)
+{
+	// in binding order, so the order bindings were declared in does not matter
+	std::vector<uint32_t> order(desc.bindings.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&desc](uint32_t a, uint32_t b) {
+		return desc.bindings[a].binding < desc.bindings[b].binding;
+	});
+
+	Key key = { desc.flags, uint32_t(desc.bindings.size()) };
+	for (uint32_t i : order)
+	{
+		const VkDescriptorSetLayoutBinding& binding = desc.bindings[i];
+		key.insert(key.end(), { binding.binding, uint32_t(binding.descriptorType), binding.descriptorCount,
+			binding.stageFlags, desc.bindingFlags.empty() ? 0 : desc.bindingFlags[i] });
+	}
+	return key;
+}
+
+VkDescriptorSetLayout LayoutCache::getSetLayout(const SetLayoutDesc& desc)
+{
+	if (!desc.bindingFlags.empty() && desc.bindingFlags.size() != desc.bindings.size())
+		throw std::runtime_error("descriptor set layout needs binding flags for every binding");
+
+	Key key = getKey(desc);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = setLayouts.find(key);
+	if (it != setLayouts.end())
+		return it->second;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = uint32_t(desc.bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = desc.bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = desc.bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+	layoutInfo.flags = desc.flags;
+	layoutInfo.bindingCount = uint32_t(desc.bindings.size());
+	layoutInfo.pBindings = desc.bindings.data();
+
+	VkDescriptorSetLayout setLayout;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+		throw std::runtime_error("cannot create descriptor set layout");
+
+	setLayouts.emplace(std::move(key), setLayout);
+	return setLayout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const PipelineLayoutDesc& desc)
+{
+	// equal set descriptions already map to equal handles, so the handles make the key
+	std::vector<VkDescriptorSetLayout> sets;
+	Key key = { uint32_t(desc.sets.size()) };
+	for (const SetLayoutDesc& set : desc.sets)
+	{
+		sets.push_back(getSetLayout(set));
+		uint64_t handle = uint64_t(sets.back());
+		key.insert(key.end(), { uint32_t(handle), uint32_t(handle >> 32) });
+	}
+	for (const VkPushConstantRange& range : desc.pushConstantRanges)
+		key.insert(key.end(), { range.stageFlags, range.offset, range.size });
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = pipelineLayouts.find(key);
+	if (it != pipelineLayouts.end())
+		return it->second;
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = uint32_t(sets.size());
+	layoutInfo.pSetLayouts = sets.data();
+	layoutInfo.pushConstantRangeCount = uint32_t(desc.pushConstantRanges.size());
+	layoutInfo.pPushConstantRanges = desc.pushConstantRanges.data();
+
+	VkPipelineLayout pipelineLayout;
+	if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("cannot create pipeline layout");
+
+	pipelineLayouts.emplace(std::move(key), pipelineLayout);
+	return pipelineLayout;
+}
+
+namespace
+{
+	bool isCompatible(VkDescriptorType declared, VkDescriptorType reflected)
+	{
+		if (declared == reflected)
+			return true;
+		return (declared == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC && reflected == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) ||
+			(declared == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC && reflected == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	}
+
+	std::string getName(const ShaderReflection::Binding& binding)
+	{
+		return "set " + std::to_string(binding.set) + ", binding " + std::to_string(binding.binding);
+	}
+}
+
+LayoutCache::PipelineLayoutDesc LayoutCache::describe(const std::vector<const ShaderReflection*>& stages,
+	const PipelineLayoutDesc& shared)
+{
+	PipelineLayoutDesc desc = shared;
+	uint32_t sharedSets = uint32_t(shared.sets.size());
+
+	uint32_t pushConstantSize = 0;
+	VkShaderStageFlags pushConstantStages = 0;
+	for (const ShaderReflection* stage : stages)
+	{
+		for (const ShaderReflection::Binding& binding : stage->bindings)
+		{
+			if (binding.set >= desc.sets.size())
+				desc.sets.resize(binding.set + 1);
+			SetLayoutDesc& set = desc.sets[binding.set];
+
+			auto declared = std::find_if(set.bindings.begin(), set.bindings.end(), [&binding](const VkDescriptorSetLayoutBinding& b) {
+				return b.binding == binding.binding;
+			});
+
+			if (binding.set < sharedSets)
+			{
+				// the owner of a shared set binds it as declared, shaders have to fit it
+				if (declared == set.bindings.end())
+					throw std::runtime_error(getName(binding) + " is not part of the shared layout");
+				if (!isCompatible(declared->descriptorType, binding.type))
+					throw std::runtime_error(getName(binding) + " has a different descriptor type in the shared layout");
+				if (binding.count > declared->descriptorCount)
+					throw std::runtime_error(getName(binding) + " has more descriptors than the shared layout");
+				if (!(declared->stageFlags & stage->stage))
+					throw std::runtime_error(getName(binding) + " is not visible to the stage in the shared layout");
+				continue;
+			}
+
+			if (declared == set.bindings.end())
+			{
+				// runtime-sized arrays get one descriptor, enough to declare them
+				VkDescriptorSetLayoutBinding layoutBinding{};
+				layoutBinding.binding = binding.binding;
+				layoutBinding.descriptorType = binding.type;
+				layoutBinding.descriptorCount = std::max(binding.count, 1u);
+				layoutBinding.stageFlags = stage->stage;
+				set.bindings.push_back(layoutBinding);
+			}
+			else if (declared->descriptorType != binding.type || declared->descriptorCount != std::max(binding.count, 1u))
+				throw std::runtime_error(getName(binding) + " is declared differently by two stages");
+			else
+				declared->stageFlags |= stage->stage;
+		}
+
+		if (stage->pushConstantSize > 0)
+		{
+			pushConstantSize = std::max(pushConstantSize, stage->pushConstantSize);
+			pushConstantStages |= stage->stage;
+		}
+	}
+
+	if (pushConstantSize == 0)
+		return desc;
+
+	if (shared.pushConstantRanges.empty())
+	{
+		desc.pushConstantRanges.push_back({ pushConstantStages, 0, pushConstantSize });
+		return desc;
+	}
+
+	for (const VkPushConstantRange& range : shared.pushConstantRanges)
+	{
+		if (range.offset == 0 && range.size >= pushConstantSize && (range.stageFlags & pushConstantStages) == pushConstantStages)
+			return desc;
+	}
+	throw std::runtime_error("push constants of " + std::to_string(pushConstantSize) + " bytes do not fit the shared range");
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "ShaderReflection.h"
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+// Descriptor set and pipeline layouts, hash-consed: equal descriptions return the same
+// handle, so pipelines with the same interface share one layout and descriptor sets stay
+// bound across pipeline switches. The cache owns every layout it returns.
+class LayoutCache
+{
+public:
+	// immutable samplers are not supported; bindingFlags is empty or one per binding
+	struct SetLayoutDesc
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		std::vector<VkDescriptorBindingFlags> bindingFlags;
+		VkDescriptorSetLayoutCreateFlags flags = 0;
+	};
+
+	// sets by index, gaps are empty sets
+	struct PipelineLayoutDesc
+	{
+		std::vector<SetLayoutDesc> sets;
+		std::vector<VkPushConstantRange> pushConstantRanges;
+	};
+
+	void init(VkDevice device);
+	void destroy();
+
+	// any thread
+	VkDescriptorSetLayout getSetLayout(const SetLayoutDesc& desc);
+	VkPipelineLayout getPipelineLayout(const PipelineLayoutDesc& desc);
+
+	// the layout the stages need on top of a shared one: shared sets must already declare
+	// what the stages use with a compatible type, other sets are built from the
+	// reflection, and the shared push constant range must cover the stages' blocks.
+	// Throws naming the first mismatch.
+	static PipelineLayoutDesc describe(const std::vector<const ShaderReflection*>& stages,
+		const PipelineLayoutDesc& shared = PipelineLayoutDesc());
+
+private:
+	typedef std::vector<uint32_t> Key;
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	static Key getKey(const SetLayoutDesc& desc);
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+
+	mutable std::mutex mutex;
+	std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> setLayouts;
+	std::unordered_map<Key, VkPipelineLayout, KeyHash> pipelineLayouts;
+};
\ No newline at end of file
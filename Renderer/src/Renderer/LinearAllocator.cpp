@@ -0,0 +1,54 @@
+#include "LinearAllocator.h"
+#include <algorithm>
+
+void LinearAllocator::create(MemoryAllocator& allocator, VkDeviceSize sizePerFrame, uint32_t frameCount, VkBufferUsageFlags usage,
+	VkDeviceSize tail)
+{
+	this->allocator = &allocator;
+	this->sizePerFrame = sizePerFrame;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = sizePerFrame * frameCount + tail;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	buffer = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	frameBegin = head = 0;
+}
+
+void LinearAllocator::destroy()
+{
+	if (allocator)
+		allocator->destroyBuffer(buffer);
+
+	allocator = nullptr;
+}
+
+void LinearAllocator::beginFrame(uint32_t frameIndex)
+{
+	frameBegin = head = frameIndex * sizePerFrame;
+}
+
+bool LinearAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, Suballocation& result)
+{
+	// 0 asks for no particular alignment
+	alignment = std::max<VkDeviceSize>(alignment, 1);
+	VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+	if (offset + size > frameBegin + sizePerFrame)
+		return false;
+
+	head = offset + size;
+	peakUsage = std::max(peakUsage, head - frameBegin);
+
+	result.buffer = buffer.buffer;
+	result.offset = offset;
+	result.mapped = static_cast<char*>(buffer.allocation->mapped) + offset;
+	return true;
+}
+
+void LinearAllocator::flush()
+{
+	if (head > frameBegin)
+		allocator->flush(buffer.allocation, frameBegin, head - frameBegin);
+}
\ No newline at end of file
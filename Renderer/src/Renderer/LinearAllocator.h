@@ -0,0 +1,42 @@
+#pragma once
+#include "MemoryAllocator.h"
+#include <vector>
+
+// Bump allocator for data that only lives for one frame (uniforms, dynamic vertices,
+// staging). One persistently mapped buffer is split into a region per frame in flight;
+// beginFrame() rewinds the region whose previous frame the fence has already retired.
+class LinearAllocator
+{
+public:
+	struct Suballocation
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		void* mapped = nullptr;
+	};
+
+	// tail pads the buffer past the last region, so descriptors with a fixed range stay
+	// inside the buffer at any offset a region hands out
+	void create(MemoryAllocator& allocator, VkDeviceSize sizePerFrame, uint32_t frameCount, VkBufferUsageFlags usage,
+		VkDeviceSize tail = 0);
+	void destroy();
+
+	void beginFrame(uint32_t frameIndex);
+	// returns false when the frame's region is exhausted
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, Suballocation& result);
+	// makes this frame's writes visible to the device on non-coherent memory
+	void flush();
+
+	VkBuffer getBuffer() const { return buffer.buffer; }
+	VkDeviceSize getSizePerFrame() const { return sizePerFrame; }
+	VkDeviceSize getUsed() const { return head - frameBegin; }
+	VkDeviceSize getPeakUsage() const { return peakUsage; }
+
+private:
+	MemoryAllocator* allocator = nullptr;
+	Buffer buffer;
+	VkDeviceSize sizePerFrame = 0;
+	VkDeviceSize frameBegin = 0;
+	VkDeviceSize head = 0;
+	VkDeviceSize peakUsage = 0;
+};
\ No newline at end of file
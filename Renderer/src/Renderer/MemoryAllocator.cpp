@@ -0,0 +1,508 @@
+#include "MemoryAllocator.h"
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+static uint32_t ceilLog2(VkDeviceSize value)
+{
+	uint32_t result = 0;
+	while ((VkDeviceSize(1) << result) < value)
+		result++;
+	return result;
+}
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void BuddyAllocator::init(VkDeviceSize size, VkDeviceSize minNodeSize)
+{
+	this->size = size;
+	this->minNodeSize = minNodeSize;
+	maxOrder = ceilLog2(size / minNodeSize);
+	used = 0;
+
+	freeLists.assign(maxOrder + 1, {});
+	freeLists[maxOrder].insert(0);
+}
+
+bool BuddyAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& order)
+{
+	VkDeviceSize nodeSize = std::max({ size, alignment, minNodeSize });
+	uint32_t wanted = ceilLog2(nodeSize) - ceilLog2(minNodeSize);
+	if (wanted > maxOrder)
+		return false;
+
+	uint32_t found = wanted;
+	while (found <= maxOrder && freeLists[found].empty())
+		found++;
+	if (found > maxOrder)
+		return false;
+
+	offset = *freeLists[found].begin();
+	freeLists[found].erase(freeLists[found].begin());
+
+	// split down to the wanted order, keeping the lower half each time
+	while (found > wanted)
+	{
+		found--;
+		freeLists[found].insert(offset + getNodeSize(found));
+	}
+
+	order = wanted;
+	used += getNodeSize(order);
+	return true;
+}
+
+void BuddyAllocator::free(VkDeviceSize offset, uint32_t order)
+{
+	used -= getNodeSize(order);
+
+	while (order < maxOrder)
+	{
+		VkDeviceSize buddy = offset ^ getNodeSize(order);
+		auto it = freeLists[order].find(buddy);
+		if (it == freeLists[order].end())
+			break;
+
+		freeLists[order].erase(it);
+		offset = std::min(offset, buddy);
+		order++;
+	}
+
+	freeLists[order].insert(offset);
+}
+
+VkDeviceSize BuddyAllocator::getLargestFree() const
+{
+	for (uint32_t order = maxOrder + 1; order-- > 0;)
+		if (!freeLists[order].empty())
+			return getNodeSize(order);
+
+	return 0;
+}
+
+void MemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+	this->device = device;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+	maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	// the buddy allocator needs a power of two
+	this->blockSize = VkDeviceSize(1) << ceilLog2(blockSize);
+
+	pools.resize(memoryProperties.memoryTypeCount * 2);
+	for (uint32_t i = 0; i < pools.size(); i++)
+	{
+		pools[i].memoryType = i / 2;
+		pools[i].optimalImages = i % 2 == 1;
+	}
+}
+
+void MemoryAllocator::destroy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& pool : pools)
+	{
+		for (auto& block : pool.blocks)
+		{
+			if (block->allocationCount > 0)
+				std::cout << "memory allocator: " << block->allocationCount << " allocations leaked in memory type " << pool.memoryType << std::endl;
+
+			for (auto allocation : block->allocations)
+				delete allocation;
+
+			vkFreeMemory(device, block->memory, nullptr);
+		}
+		pool.blocks.clear();
+	}
+
+	pools.clear();
+	deviceAllocationCount = 0;
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags flags) const
+{
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+			return i;
+	}
+
+	return UINT32_MAX;
+}
+
+MemoryBlock* MemoryAllocator::createBlock(Pool& pool, VkDeviceSize size, bool dedicated)
+{
+	if (deviceAllocationCount >= maxAllocationCount)
+		throw std::runtime_error("memory allocator: maxMemoryAllocationCount reached");
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = pool.memoryType;
+
+	auto block = std::make_unique<MemoryBlock>();
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+		return nullptr;
+
+	deviceAllocationCount++;
+
+	if (memoryProperties.memoryTypes[pool.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped);
+
+	block->pool = uint32_t(&pool - pools.data());
+	block->dedicated = dedicated;
+	block->buddy.init(dedicated ? size : blockSize, dedicated ? size : minNodeSize);
+
+	pool.blocks.push_back(std::move(block));
+	return pool.blocks.back().get();
+}
+
+void MemoryAllocator::destroyBlock(MemoryBlock* block)
+{
+	auto& blocks = pools[block->pool].blocks;
+	auto it = std::find_if(blocks.begin(), blocks.end(), [block](const auto& b) { return b.get() == block; });
+
+	vkFreeMemory(device, block->memory, nullptr);
+	deviceAllocationCount--;
+	blocks.erase(it);
+}
+
+bool MemoryAllocator::allocateFromPool(Pool& pool, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation)
+{
+	// large resources get their own VkDeviceMemory instead of fragmenting a shared block
+	if (size > blockSize / 2)
+	{
+		MemoryBlock* block = createBlock(pool, size, true);
+		if (!block)
+			return false;
+
+		allocation.block = block;
+		allocation.offset = 0;
+		allocation.order = 0;
+		block->buddy.allocate(size, 1, allocation.offset, allocation.order);
+		return true;
+	}
+
+	for (auto& block : pool.blocks)
+	{
+		if (!block->dedicated && block->buddy.allocate(size, alignment, allocation.offset, allocation.order))
+		{
+			allocation.block = block.get();
+			return true;
+		}
+	}
+
+	MemoryBlock* block = createBlock(pool, blockSize, false);
+	if (!block || !block->buddy.allocate(size, alignment, allocation.offset, allocation.order))
+		return false;
+
+	allocation.block = block;
+	return true;
+}
+
+Allocation* MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required,
+	VkMemoryPropertyFlags preferred, bool optimalImage, bool movable)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto allocation = std::make_unique<Allocation>();
+	allocation->size = requirements.size;
+	allocation->movable = movable;
+
+	// try every matching type, preferred ones first, so a full heap falls back to the next type
+	std::vector<uint32_t> candidates;
+	for (VkMemoryPropertyFlags flags : { required | preferred, required })
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			bool matches = (requirements.memoryTypeBits & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & flags) == flags;
+			if (matches && std::find(candidates.begin(), candidates.end(), i) == candidates.end())
+				candidates.push_back(i);
+		}
+	}
+
+	if (candidates.empty())
+		throw std::runtime_error("memory allocator: no suitable memory type");
+
+	for (uint32_t memoryType : candidates)
+	{
+		Pool& pool = pools[memoryType * 2 + (optimalImage ? 1 : 0)];
+		if (!allocateFromPool(pool, requirements.size, requirements.alignment, *allocation))
+			continue;
+
+		MemoryBlock* block = allocation->block;
+		allocation->memory = block->memory;
+		allocation->memoryType = memoryType;
+		allocation->pool = block->pool;
+		allocation->mapped = block->mapped ? static_cast<char*>(block->mapped) + allocation->offset : nullptr;
+
+		block->allocationCount++;
+		block->allocations.push_back(allocation.get());
+		return allocation.release();
+	}
+
+	throw std::runtime_error("memory allocator: out of device memory");
+}
+
+void MemoryAllocator::freeLocked(Allocation* allocation)
+{
+	MemoryBlock* block = allocation->block;
+	block->buddy.free(allocation->offset, allocation->order);
+	block->allocationCount--;
+	block->allocations.erase(std::find(block->allocations.begin(), block->allocations.end(), allocation));
+
+	if (block->dedicated)
+		destroyBlock(block);
+}
+
+void MemoryAllocator::free(Allocation* allocation)
+{
+	if (!allocation)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	freeLocked(allocation);
+	delete allocation;
+}
+
+Buffer MemoryAllocator::createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags required,
+	VkMemoryPropertyFlags preferred, bool movable)
+{
+	Buffer buffer;
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS)
+		throw std::runtime_error("cannot create buffer");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, buffer.buffer, &memoryRequirements);
+
+	try
+	{
+		buffer.allocation = allocate(memoryRequirements, required, preferred, false, movable);
+	}
+	catch (...)
+	{
+		vkDestroyBuffer(device, buffer.buffer, nullptr);
+		throw;
+	}
+
+	vkBindBufferMemory(device, buffer.buffer, buffer.allocation->memory, buffer.allocation->offset);
+	return buffer;
+}
+
+void MemoryAllocator::destroyBuffer(Buffer& buffer)
+{
+	vkDestroyBuffer(device, buffer.buffer, nullptr);
+	free(buffer.allocation);
+	buffer = Buffer();
+}
+
+Image MemoryAllocator::createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags required,
+	VkMemoryPropertyFlags preferred)
+{
+	Image image;
+	if (vkCreateImage(device, &imageInfo, nullptr, &image.image) != VK_SUCCESS)
+		throw std::runtime_error("cannot create image");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, image.image, &memoryRequirements);
+
+	try
+	{
+		image.allocation = allocate(memoryRequirements, required, preferred, imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL);
+	}
+	catch (...)
+	{
+		vkDestroyImage(device, image.image, nullptr);
+		throw;
+	}
+
+	vkBindImageMemory(device, image.image, image.allocation->memory, image.allocation->offset);
+	return image;
+}
+
+void MemoryAllocator::destroyImage(Image& image)
+{
+	vkDestroyImage(device, image.image, nullptr);
+	free(image.allocation);
+	image = Image();
+}
+
+bool MemoryAllocator::getNonCoherentRange(const Allocation* allocation, VkDeviceSize offset, VkDeviceSize size, VkMappedMemoryRange& range) const
+{
+	if (memoryProperties.memoryTypes[allocation->memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+		return false;
+
+	// ranges must be multiples of nonCoherentAtomSize; buddy nodes are aligned well beyond that
+	VkDeviceSize begin = (allocation->offset + offset) / nonCoherentAtomSize * nonCoherentAtomSize;
+	VkDeviceSize end = alignUp(allocation->offset + offset + size, nonCoherentAtomSize);
+
+	range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = allocation->memory;
+	range.offset = begin;
+	range.size = std::min(end, allocation->block->buddy.getSize()) - begin;
+	return true;
+}
+
+void MemoryAllocator::flush(const Allocation* allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+	VkMappedMemoryRange range;
+	if (getNonCoherentRange(allocation, offset, size, range))
+		vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+void MemoryAllocator::invalidate(const Allocation* allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+	VkMappedMemoryRange range;
+	if (getNonCoherentRange(allocation, offset, size, range))
+		vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+std::vector<DefragmentationMove> MemoryAllocator::planDefragmentation(VkDeviceSize maxBytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<DefragmentationMove> moves;
+	VkDeviceSize planned = 0;
+
+	for (auto& pool : pools)
+	{
+		std::vector<MemoryBlock*> blocks;
+		for (auto& block : pool.blocks)
+			if (!block->dedicated)
+				blocks.push_back(block.get());
+
+		if (blocks.size() < 2)
+			continue;
+
+		// empty the least used blocks into the most used ones
+		std::sort(blocks.begin(), blocks.end(), [](MemoryBlock* a, MemoryBlock* b) { return a->buddy.getUsed() > b->buddy.getUsed(); });
+
+		for (size_t src = blocks.size() - 1; src > 0; src--)
+		{
+			for (Allocation* allocation : blocks[src]->allocations)
+			{
+				if (!allocation->movable)
+					continue;
+
+				VkDeviceSize nodeSize = blocks[src]->buddy.getNodeSize(allocation->order);
+				if (planned + nodeSize > maxBytes)
+					return moves;
+
+				for (size_t dst = 0; dst < src; dst++)
+				{
+					DefragmentationMove move;
+					if (!blocks[dst]->buddy.allocate(nodeSize, 1, move.dstOffset, move.dstOrder))
+						continue;
+
+					move.allocation = allocation;
+					move.dstMemory = blocks[dst]->memory;
+					move.dstBlock = blocks[dst];
+					moves.push_back(move);
+					planned += nodeSize;
+					break;
+				}
+			}
+		}
+	}
+
+	return moves;
+}
+
+void MemoryAllocator::commitDefragmentation(const std::vector<DefragmentationMove>& moves)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (const auto& move : moves)
+	{
+		Allocation* allocation = move.allocation;
+		freeLocked(allocation);
+
+		allocation->block = move.dstBlock;
+		allocation->memory = move.dstMemory;
+		allocation->offset = move.dstOffset;
+		allocation->order = move.dstOrder;
+		allocation->mapped = move.dstBlock->mapped ? static_cast<char*>(move.dstBlock->mapped) + move.dstOffset : nullptr;
+
+		move.dstBlock->allocationCount++;
+		move.dstBlock->allocations.push_back(allocation);
+	}
+}
+
+void MemoryAllocator::cancelDefragmentation(const std::vector<DefragmentationMove>& moves)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (const auto& move : moves)
+		move.dstBlock->buddy.free(move.dstOffset, move.dstOrder);
+}
+
+void MemoryAllocator::releaseEmptyBlocks()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& pool : pools)
+	{
+		for (size_t i = pool.blocks.size(); i-- > 0;)
+		{
+			if (pool.blocks[i]->buddy.isEmpty())
+				destroyBlock(pool.blocks[i].get());
+		}
+	}
+}
+
+void MemoryAllocator::dumpStats(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const double mb = 1024.0 * 1024.0;
+	out << "memory: " << deviceAllocationCount << " device allocations (limit " << maxAllocationCount << ")" << std::endl;
+
+	for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++)
+	{
+		uint32_t blockCount = 0, allocationCount = 0;
+		VkDeviceSize reserved = 0, requested = 0, used = 0, largestFree = 0;
+
+		for (auto& pool : pools)
+		{
+			if (memoryProperties.memoryTypes[pool.memoryType].heapIndex != heap)
+				continue;
+
+			for (auto& block : pool.blocks)
+			{
+				blockCount++;
+				allocationCount += block->allocationCount;
+				reserved += block->buddy.getSize();
+				used += block->buddy.getUsed();
+				largestFree = std::max(largestFree, block->buddy.getLargestFree());
+				for (auto allocation : block->allocations)
+					requested += allocation->size;
+			}
+		}
+
+		VkDeviceSize free = reserved - used;
+		// 0 when all free space is one contiguous range, approaching 1 as it scatters
+		double fragmentation = free > 0 ? 1.0 - double(largestFree) / double(free) : 0.0;
+
+		out << "  heap " << heap << (memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ? " (device local)" : "")
+			<< std::fixed << std::setprecision(2)
+			<< ": size " << memoryProperties.memoryHeaps[heap].size / mb << " MB"
+			<< ", blocks " << blockCount
+			<< ", allocations " << allocationCount
+			<< ", reserved " << reserved / mb << " MB"
+			<< ", used " << used / mb << " MB"
+			<< " (requested " << requested / mb << " MB)"
+			<< ", free " << free / mb << " MB"
+			<< ", fragmentation " << fragmentation
+			<< std::endl;
+	}
+}
\ No newline at end of file
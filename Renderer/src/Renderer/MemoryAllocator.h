@@ -0,0 +1,160 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+// Power-of-two buddy allocator over an abstract range. Every node is aligned to its own
+// size, which makes alignment requirements up to the node size free.
+class BuddyAllocator
+{
+public:
+	void init(VkDeviceSize size, VkDeviceSize minNodeSize);
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& order);
+	void free(VkDeviceSize offset, uint32_t order);
+
+	VkDeviceSize getSize() const { return size; }
+	VkDeviceSize getUsed() const { return used; }
+	VkDeviceSize getLargestFree() const;
+	VkDeviceSize getNodeSize(uint32_t order) const { return minNodeSize << order; }
+	bool isEmpty() const { return used == 0; }
+
+private:
+	VkDeviceSize size = 0;
+	VkDeviceSize minNodeSize = 0;
+	uint32_t maxOrder = 0;
+	VkDeviceSize used = 0;
+	// free node offsets per order, ordered so allocations pack towards the start
+	std::vector<std::set<VkDeviceSize>> freeLists;
+};
+
+struct Allocation;
+
+// one VkDeviceMemory, either shared through its buddy allocator or dedicated to a single resource
+struct MemoryBlock
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	void* mapped = nullptr;
+	uint32_t pool = 0;
+	bool dedicated = false;
+	uint32_t allocationCount = 0;
+	BuddyAllocator buddy;
+	std::vector<Allocation*> allocations;
+};
+
+struct Allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// null unless the memory type is host visible
+	void* mapped = nullptr;
+	uint32_t memoryType = 0;
+
+private:
+	friend class MemoryAllocator;
+	MemoryBlock* block = nullptr;
+	uint32_t pool = 0;
+	uint32_t order = 0;
+	// defragmentation may only relocate allocations whose owner can rebind them
+	bool movable = false;
+};
+
+struct Buffer
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	Allocation* allocation = nullptr;
+};
+
+struct Image
+{
+	VkImage image = VK_NULL_HANDLE;
+	Allocation* allocation = nullptr;
+};
+
+// A relocation proposed by planDefragmentation(). The destination range is reserved
+// until the plan is committed or cancelled.
+struct DefragmentationMove
+{
+	Allocation* allocation;
+	VkDeviceMemory dstMemory;
+	VkDeviceSize dstOffset;
+
+private:
+	friend class MemoryAllocator;
+	MemoryBlock* dstBlock;
+	uint32_t dstOrder;
+};
+
+// Sub-allocates resources out of large VkDeviceMemory blocks, one set of blocks per
+// memory type, so the number of vkAllocateMemory calls stays far below
+// maxMemoryAllocationCount. Linear and optimally tiled resources never share a block,
+// which keeps bufferImageGranularity out of the picture. Thread-safe.
+class MemoryAllocator
+{
+public:
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = 64ull * 1024 * 1024);
+	void destroy();
+
+	// the preferred flags are dropped when no memory type has them in addition to the required ones
+	Allocation* allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required,
+		VkMemoryPropertyFlags preferred = 0, bool optimalImage = false, bool movable = false);
+	void free(Allocation* allocation);
+
+	Buffer createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags required,
+		VkMemoryPropertyFlags preferred = 0, bool movable = false);
+	void destroyBuffer(Buffer& buffer);
+	Image createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags required,
+		VkMemoryPropertyFlags preferred = 0);
+	void destroyImage(Image& image);
+
+	// flushes host writes for memory types that are not host coherent
+	void flush(const Allocation* allocation, VkDeviceSize offset, VkDeviceSize size);
+	// makes device writes visible to the host for memory types that are not host coherent
+	void invalidate(const Allocation* allocation, VkDeviceSize offset, VkDeviceSize size);
+
+	// Proposes moving movable allocations out of sparsely used blocks into fuller ones, up
+	// to maxBytes. The caller copies the data to each destination and rebinds its resource,
+	// then commits once the GPU is done with the old location.
+	std::vector<DefragmentationMove> planDefragmentation(VkDeviceSize maxBytes);
+	void commitDefragmentation(const std::vector<DefragmentationMove>& moves);
+	void cancelDefragmentation(const std::vector<DefragmentationMove>& moves);
+
+	// frees blocks that hold no allocations
+	void releaseEmptyBlocks();
+	void dumpStats(std::ostream& out);
+
+	uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags flags) const;
+	const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const { return memoryProperties; }
+
+private:
+	struct Pool
+	{
+		uint32_t memoryType;
+		bool optimalImages;
+		std::vector<std::unique_ptr<MemoryBlock>> blocks;
+	};
+
+	MemoryBlock* createBlock(Pool& pool, VkDeviceSize size, bool dedicated);
+	void destroyBlock(MemoryBlock* block);
+	void freeLocked(Allocation* allocation);
+	bool allocateFromPool(Pool& pool, VkDeviceSize size, VkDeviceSize alignment, Allocation& allocation);
+	bool getNonCoherentRange(const Allocation* allocation, VkDeviceSize offset, VkDeviceSize size, VkMappedMemoryRange& range) const;
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	VkDeviceSize nonCoherentAtomSize = 1;
+	uint32_t maxAllocationCount = 0;
+	uint32_t deviceAllocationCount = 0;
+	VkDeviceSize blockSize = 0;
+
+	// indexed by memoryType * 2 + optimalImage
+	std::vector<Pool> pools;
+	std::mutex mutex;
+
+	static const VkDeviceSize minNodeSize = 256;
+};
\ No newline at end of file
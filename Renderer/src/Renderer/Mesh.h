@@ -0,0 +1,51 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "MemoryAllocator.h"
+#include <array>
+#include <cstddef>
+
+struct Vertex
+{
+	float position[3];
+	float color[3];
+
+	static VkVertexInputBindingDescription getBindingDescription()
+	{
+		VkVertexInputBindingDescription binding{};
+		binding.binding = 0;
+		binding.stride = sizeof(Vertex);
+		binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return binding;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions()
+	{
+		std::array<VkVertexInputAttributeDescription, 2> attributes{};
+		attributes[0] = { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) };
+		attributes[1] = { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) };
+		return attributes;
+	}
+};
+
+// push constants of packed meshes: position = offset + unorm position * scale
+struct MeshDequantization
+{
+	float scale[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+	float offset[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+// vertex and index data in device-local memory
+struct Mesh
+{
+	enum class VertexFormat { Float, Packed };
+
+	Buffer vertexBuffer;
+	Buffer indexBuffer;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	VertexFormat vertexFormat = VertexFormat::Float;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	MeshDequantization dequantization;
+	// center and radius in model space, for culling
+	float boundingSphere[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
\ No newline at end of file
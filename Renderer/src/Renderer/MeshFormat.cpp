@@ -0,0 +1,257 @@
+#include "MeshFormat.h"
+#include <stdexcept>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+static const char meshMagic[4] = { 'V', 'R', 'M', 'S' };
+static const uint64_t sectionAlignment = 64;
+
+static bool sectionValid(const MeshFileSection& section, uint64_t expectedSize, size_t fileSize)
+{
+	return section.offset % sectionAlignment == 0 && section.size == expectedSize &&
+		section.offset <= fileSize && section.size <= fileSize - section.offset;
+}
+
+MeshFileView MeshFormat::view(const char* data, size_t size)
+{
+	if (size < sizeof(MeshFileHeader))
+		throw std::runtime_error("mesh file is truncated");
+
+	MeshFileView view;
+	view.header = reinterpret_cast<const MeshFileHeader*>(data);
+	const MeshFileHeader& header = *view.header;
+
+	if (memcmp(header.magic, meshMagic, sizeof(meshMagic)) != 0)
+		throw std::runtime_error("not a mesh file");
+	if (header.version != version)
+		throw std::runtime_error("unsupported mesh file version " + std::to_string(header.version));
+	if (header.indexSize != 2 && header.indexSize != 4)
+		throw std::runtime_error("invalid mesh index size");
+
+	// only the layout is checked; index values are trusted to come from the converter
+	bool valid = sectionValid(header.vertices, uint64_t(header.vertexCount) * sizeof(PackedVertex), size) &&
+		sectionValid(header.indices, uint64_t(header.indexCount) * header.indexSize, size) &&
+		sectionValid(header.meshlets, uint64_t(header.meshletCount) * sizeof(Meshlet), size) &&
+		header.meshletVertices.offset % sectionAlignment == 0 && header.meshletVertices.size % sizeof(uint32_t) == 0 &&
+		header.meshletVertices.offset <= size && header.meshletVertices.size <= size - header.meshletVertices.offset &&
+		header.meshletTriangles.offset % sectionAlignment == 0 &&
+		header.meshletTriangles.offset <= size && header.meshletTriangles.size <= size - header.meshletTriangles.offset;
+
+	if (!valid)
+		throw std::runtime_error("mesh file sections are out of bounds");
+
+	view.vertices = reinterpret_cast<const PackedVertex*>(data + header.vertices.offset);
+	view.indices = data + header.indices.offset;
+	view.meshlets = reinterpret_cast<const Meshlet*>(data + header.meshlets.offset);
+	view.meshletVertices = reinterpret_cast<const uint32_t*>(data + header.meshletVertices.offset);
+	view.meshletTriangles = reinterpret_cast<const uint8_t*>(data + header.meshletTriangles.offset);
+	return view;
+}
+
+void MeshFormat::encodeOctahedral(const float normal[3], int16_t encoded[2])
+{
+	float length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+	float x = length > 0.0f ? normal[0] / length : 0.0f;
+	float y = length > 0.0f ? normal[1] / length : 0.0f;
+
+	// fold the lower hemisphere over the diagonals
+	if (length > 0.0f && normal[2] < 0.0f)
+	{
+		float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = int16_t(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+	encoded[1] = int16_t(std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+}
+
+static void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	std::vector<Meshlet>& meshlets, std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles)
+{
+	// -1 when the vertex is not part of the meshlet being built
+	std::vector<int32_t> localIndex(vertices.size(), -1);
+
+	auto close = [&](Meshlet& meshlet) {
+		float minimum[3] = { INFINITY, INFINITY, INFINITY }, maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			const float* position = vertices[meshletVertices[meshlet.vertexOffset + i]].position;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				minimum[axis] = std::min(minimum[axis], position[axis]);
+				maximum[axis] = std::max(maximum[axis], position[axis]);
+			}
+		}
+
+		float radiusSquared = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+			meshlet.center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			uint32_t vertex = meshletVertices[meshlet.vertexOffset + i];
+			const float* position = vertices[vertex].position;
+			float dx = position[0] - meshlet.center[0], dy = position[1] - meshlet.center[1], dz = position[2] - meshlet.center[2];
+			radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+			localIndex[vertex] = -1;
+		}
+
+		meshlet.radius = std::sqrt(radiusSquared);
+		meshlets.push_back(meshlet);
+	};
+
+	Meshlet meshlet{};
+	for (size_t triangle = 0; triangle * 3 + 2 < indices.size(); triangle++)
+	{
+		const uint32_t* corners = &indices[triangle * 3];
+		uint32_t newVertices = 0;
+		for (int i = 0; i < 3; i++)
+			newVertices += localIndex[corners[i]] < 0 ? 1 : 0;
+
+		if (meshlet.vertexCount + newVertices > MeshFormat::maxMeshletVertices || meshlet.triangleCount == MeshFormat::maxMeshletTriangles)
+		{
+			close(meshlet);
+			meshlet = {};
+			meshlet.vertexOffset = uint32_t(meshletVertices.size());
+			meshlet.triangleOffset = uint32_t(meshletTriangles.size() / 3);
+			meshlet.firstIndex = uint32_t(triangle * 3);
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (localIndex[corners[i]] < 0)
+			{
+				localIndex[corners[i]] = meshlet.vertexCount++;
+				meshletVertices.push_back(corners[i]);
+			}
+			meshletTriangles.push_back(uint8_t(localIndex[corners[i]]));
+		}
+		meshlet.triangleCount++;
+	}
+
+	if (meshlet.triangleCount > 0)
+		close(meshlet);
+}
+
+size_t MeshFormat::write(const std::string& path, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	MeshFileHeader header{};
+	memcpy(header.magic, meshMagic, sizeof(meshMagic));
+	header.version = version;
+	header.vertexCount = uint32_t(vertices.size());
+	header.indexCount = uint32_t(indices.size());
+	header.indexSize = vertices.size() <= 65536 ? 2 : 4;
+
+	float minimum[3] = { INFINITY, INFINITY, INFINITY }, maximum[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (const auto& vertex : vertices)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = std::min(minimum[axis], vertex.position[axis]);
+			maximum[axis] = std::max(maximum[axis], vertex.position[axis]);
+		}
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = maximum[axis] - minimum[axis];
+		header.dequantization.offset[axis] = vertices.empty() ? 0.0f : minimum[axis];
+		// flat axes still need a non-zero scale to stay finite
+		header.dequantization.scale[axis] = extent > 0.0f ? extent : 1.0f;
+	}
+
+	// area weighted vertex normals, the cross product length is twice the triangle area
+	std::vector<float> normals(vertices.size() * 3, 0.0f);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const float* a = vertices[indices[i]].position;
+		const float* b = vertices[indices[i + 1]].position;
+		const float* c = vertices[indices[i + 2]].position;
+		float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+
+		for (size_t corner = i; corner < i + 3; corner++)
+			for (int axis = 0; axis < 3; axis++)
+				normals[indices[corner] * 3 + axis] += normal[axis];
+	}
+
+	std::vector<PackedVertex> packed(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float normalized = (vertices[i].position[axis] - header.dequantization.offset[axis]) / header.dequantization.scale[axis];
+			packed[i].position[axis] = uint16_t(std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+			packed[i].color[axis] = uint8_t(std::lround(std::clamp(vertices[i].color[axis], 0.0f, 1.0f) * 255.0f));
+		}
+		packed[i].position[3] = 0;
+		packed[i].color[3] = 255;
+
+		float* normal = &normals[i * 3];
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float unit[3] = { 0.0f, 0.0f, 1.0f };
+		if (length > 0.0f)
+			for (int axis = 0; axis < 3; axis++)
+				unit[axis] = normal[axis] / length;
+		encodeOctahedral(unit, packed[i].normal);
+	}
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	buildMeshlets(vertices, indices, meshlets, meshletVertices, meshletTriangles);
+	header.meshletCount = uint32_t(meshlets.size());
+
+	std::vector<uint16_t> shortIndices;
+	if (header.indexSize == 2)
+		shortIndices.assign(indices.begin(), indices.end());
+
+	const void* indexData = header.indexSize == 2 ? static_cast<const void*>(shortIndices.data()) : indices.data();
+
+	// lay the sections out back to back, each aligned for direct use from a mapping
+	uint64_t end = sizeof(MeshFileHeader);
+	auto place = [&end](MeshFileSection& section, uint64_t size) {
+		section.offset = (end + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+		section.size = size;
+		end = section.offset + size;
+	};
+	place(header.vertices, packed.size() * sizeof(PackedVertex));
+	place(header.indices, uint64_t(indices.size()) * header.indexSize);
+	place(header.meshlets, meshlets.size() * sizeof(Meshlet));
+	place(header.meshletVertices, meshletVertices.size() * sizeof(uint32_t));
+	place(header.meshletTriangles, meshletTriangles.size());
+
+	std::vector<char> file(end, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	auto copy = [&file](const MeshFileSection& section, const void* data) {
+		if (section.size > 0)
+			memcpy(file.data() + section.offset, data, section.size);
+	};
+	copy(header.vertices, packed.data());
+	copy(header.indices, indexData);
+	copy(header.meshlets, meshlets.data());
+	copy(header.meshletVertices, meshletVertices.data());
+	copy(header.meshletTriangles, meshletTriangles.data());
+
+	// write next to the target and rename over it so a crash never leaves a torn file
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!stream.is_open())
+			throw std::runtime_error("cannot write mesh file " + temporaryPath);
+
+		stream.write(file.data(), file.size());
+		stream.flush();
+		if (!stream.good())
+			throw std::runtime_error("cannot write mesh file " + temporaryPath);
+	}
+
+	std::filesystem::rename(temporaryPath, path);
+	return file.size();
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "Mesh.h"
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// 16 byte vertex of the binary format, laid out to be bound without conversion
+struct PackedVertex
+{
+	// unorm16 within the mesh bounds, w unused
+	uint16_t position[4];
+	// octahedral unit normal, snorm16
+	int16_t normal[2];
+	uint8_t color[4];
+
+	static VkVertexInputBindingDescription getBindingDescription()
+	{
+		VkVertexInputBindingDescription binding{};
+		binding.binding = 0;
+		binding.stride = sizeof(PackedVertex);
+		binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return binding;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions()
+	{
+		std::array<VkVertexInputAttributeDescription, 3> attributes{};
+		attributes[0] = { 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) };
+		attributes[1] = { 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) };
+		attributes[2] = { 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) };
+		return attributes;
+	}
+};
+
+// Up to 64 vertices and 124 triangles. The index buffer is ordered meshlet by meshlet,
+// so firstIndex/triangleCount also address the meshlet in the regular index buffer.
+struct Meshlet
+{
+	uint32_t vertexOffset;
+	uint32_t triangleOffset;
+	uint32_t firstIndex;
+	uint16_t vertexCount;
+	uint16_t triangleCount;
+	// bounding sphere in object space
+	float center[3];
+	float radius;
+};
+
+struct MeshFileSection
+{
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct MeshFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t meshletCount;
+	// 2 or 4
+	uint32_t indexSize;
+	MeshDequantization dequantization;
+
+	MeshFileSection vertices;
+	MeshFileSection indices;
+	MeshFileSection meshlets;
+	// global vertex index per meshlet vertex
+	MeshFileSection meshletVertices;
+	// three meshlet-local uint8 indices per meshlet triangle
+	MeshFileSection meshletTriangles;
+};
+
+// Pointers into a mapped mesh file; nothing is copied.
+struct MeshFileView
+{
+	const MeshFileHeader* header = nullptr;
+	const PackedVertex* vertices = nullptr;
+	const void* indices = nullptr;
+	const Meshlet* meshlets = nullptr;
+	const uint32_t* meshletVertices = nullptr;
+	const uint8_t* meshletTriangles = nullptr;
+};
+
+// Renderer-native mesh files. Every section starts 64-byte aligned so it can be handed
+// to the staging ring straight out of a memory mapping.
+class MeshFormat
+{
+public:
+	static const uint32_t version = 1;
+	static const uint32_t maxMeshletVertices = 64;
+	static const uint32_t maxMeshletTriangles = 124;
+
+	// validates the header and section bounds, throws on a malformed file
+	static MeshFileView view(const char* data, size_t size);
+	// quantizes, derives normals, builds meshlets and writes the file; returns its size
+	static size_t write(const std::string& path, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+	static void encodeOctahedral(const float normal[3], int16_t encoded[2]);
+};
\ No newline at end of file
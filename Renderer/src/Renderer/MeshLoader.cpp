@@ -0,0 +1,240 @@
+#include "MeshLoader.h"
+#include "Renderer.h"
+#include "ObjParser.h"
+#include "core/JobSystem.h"
+#include <stdexcept>
+#include <filesystem>
+#include <algorithm>
+
+static bool isBinaryMesh(const std::string& path)
+{
+	return std::filesystem::path(path).extension() == ".vmesh";
+}
+
+void MeshLoader::init(size_t inFlightBudget, size_t uploadBytesPerFrame)
+{
+	this->inFlightBudget = inFlightBudget;
+	this->uploadBytesPerFrame = uploadBytesPerFrame;
+}
+
+void MeshLoader::destroy()
+{
+	for (uint32_t id : parsing)
+		requests[id]->parse.wait();
+
+	for (auto& request : requests)
+	{
+		// uploading meshes may have their buffers already
+		if (request->mesh.vertexBuffer.buffer != VK_NULL_HANDLE)
+			Renderer::destroyMesh(request->mesh);
+	}
+
+	requests.clear();
+	queued.clear();
+	parsing.clear();
+	uploading.clear();
+	inFlightBytes = 0;
+	pendingCount = 0;
+}
+
+uint32_t MeshLoader::load(const std::string& path, ProgressCallback callback)
+{
+	uint32_t id = uint32_t(requests.size());
+
+	auto request = std::make_unique<Request>();
+	request->path = path;
+	request->callback = std::move(callback);
+
+	std::error_code error;
+	request->totalBytes = size_t(std::filesystem::file_size(path, error));
+	requests.push_back(std::move(request));
+	pendingCount++;
+
+	if (error)
+		finish(id, "cannot open file " + path);
+	else
+	{
+		queued.push_back(id);
+		report(id);
+	}
+
+	return id;
+}
+
+void MeshLoader::update()
+{
+	// always admit one load so files larger than the budget still go through
+	while (!queued.empty())
+	{
+		Request& request = *requests[queued.front()];
+		if (inFlightBytes > 0 && inFlightBytes + request.totalBytes > inFlightBudget)
+			break;
+
+		inFlightBytes += request.totalBytes;
+		request.state = MeshLoadProgress::State::Parsing;
+		request.parse = JobSystem::submit([&request]() {
+			if (isBinaryMesh(request.path))
+			{
+				request.file.open(request.path);
+				request.view = MeshFormat::view(request.file.data(), request.file.size());
+				request.bytesParsed = request.totalBytes;
+				return;
+			}
+
+			MappedFile file(request.path);
+			ObjParser::parse(file, request.vertices, request.indices, &request.bytesParsed);
+		});
+
+		parsing.push_back(queued.front());
+		queued.pop_front();
+		report(parsing.back());
+	}
+
+	for (auto it = parsing.begin(); it != parsing.end();)
+	{
+		uint32_t id = *it;
+		Request& request = *requests[id];
+
+		if (request.parse.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			if (request.bytesParsed.load(std::memory_order_relaxed) != request.reportedBytes)
+				report(id);
+			++it;
+			continue;
+		}
+
+		it = parsing.erase(it);
+		try
+		{
+			request.parse.get();
+			request.state = MeshLoadProgress::State::Uploading;
+			uploading.push_back(id);
+			report(id);
+		}
+		catch (std::exception& e)
+		{
+			inFlightBytes -= request.totalBytes;
+			request.file.close();
+			finish(id, e.what());
+		}
+	}
+
+	// the frame's budget is spent in chunks, a mesh that does not finish resumes next frame
+	size_t budget = uploadBytesPerFrame;
+	while (!uploading.empty())
+	{
+		uint32_t id = uploading.front();
+		Request& request = *requests[id];
+
+		if (request.mesh.vertexBuffer.buffer == VK_NULL_HANDLE)
+		{
+			bool binary = request.view.header != nullptr;
+			uint32_t indexCount = binary ? request.view.header->indexCount : uint32_t(request.indices.size());
+			if (indexCount == 0)
+			{
+				uploading.pop_front();
+				inFlightBytes -= request.totalBytes;
+				request.file.close();
+				finish(id, "mesh has no faces");
+				continue;
+			}
+
+			if (binary)
+				request.mesh = Renderer::createMesh(request.view, false);
+			else
+				request.mesh = Renderer::createMesh(request.vertices, request.indices, false);
+		}
+
+		if (!upload(request, budget))
+			break;
+
+		uploading.pop_front();
+
+		// the staging ring holds a copy now
+		request.vertices = {};
+		request.indices = {};
+		request.file.close();
+		request.view = {};
+
+		inFlightBytes -= request.totalBytes;
+		finish(id, "");
+	}
+}
+
+bool MeshLoader::upload(Request& request, size_t& budget)
+{
+	bool binary = request.view.header != nullptr;
+	const char* vertices = binary ? reinterpret_cast<const char*>(request.view.vertices) :
+		reinterpret_cast<const char*>(request.vertices.data());
+	const char* indices = binary ? static_cast<const char*>(request.view.indices) :
+		reinterpret_cast<const char*>(request.indices.data());
+	size_t vertexBytes = binary ? size_t(request.view.header->vertices.size) : request.vertices.size() * sizeof(Vertex);
+	size_t indexBytes = binary ? size_t(request.view.header->indices.size) : request.indices.size() * sizeof(uint32_t);
+
+	while (request.uploadedBytes < vertexBytes + indexBytes)
+	{
+		if (budget == 0)
+			return false;
+
+		bool vertexData = request.uploadedBytes < vertexBytes;
+		size_t offset = vertexData ? request.uploadedBytes : request.uploadedBytes - vertexBytes;
+		size_t size = std::min({ (vertexData ? vertexBytes : indexBytes) - offset, budget,
+			size_t(Renderer::getUploadChunkSize()) });
+
+		const Buffer& buffer = vertexData ? request.mesh.vertexBuffer : request.mesh.indexBuffer;
+		if (!Renderer::streamUpload(buffer, offset, (vertexData ? vertices : indices) + offset, size))
+			return false;
+
+		request.uploadedBytes += size;
+		budget -= size;
+	}
+
+	return true;
+}
+
+const Mesh* MeshLoader::getMesh(uint32_t id) const
+{
+	if (id >= requests.size() || requests[id]->state != MeshLoadProgress::State::Done)
+		return nullptr;
+
+	return &requests[id]->mesh;
+}
+
+void MeshLoader::unload(uint32_t id)
+{
+	Request& request = *requests[id];
+	if (request.state != MeshLoadProgress::State::Done)
+		throw std::runtime_error("only loaded meshes can be unloaded: " + request.path);
+
+	Renderer::destroyMesh(request.mesh);
+	request.state = MeshLoadProgress::State::Unloaded;
+	report(id);
+}
+
+void MeshLoader::report(uint32_t id)
+{
+	Request& request = *requests[id];
+	request.reportedBytes = request.bytesParsed.load(std::memory_order_relaxed);
+
+	if (!request.callback)
+		return;
+
+	MeshLoadProgress progress;
+	progress.id = id;
+	progress.path = &request.path;
+	progress.state = request.state;
+	progress.bytesParsed = request.reportedBytes;
+	progress.totalBytes = request.totalBytes;
+	progress.mesh = request.state == MeshLoadProgress::State::Done ? &request.mesh : nullptr;
+	progress.error = request.state == MeshLoadProgress::State::Failed ? &request.error : nullptr;
+	request.callback(progress);
+}
+
+void MeshLoader::finish(uint32_t id, const std::string& error)
+{
+	Request& request = *requests[id];
+	request.error = error;
+	request.state = error.empty() ? MeshLoadProgress::State::Done : MeshLoadProgress::State::Failed;
+	pendingCount--;
+	report(id);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+#include "Mesh.h"
+#include "MeshFormat.h"
+#include "core/MappedFile.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <future>
+#include <atomic>
+
+struct MeshLoadProgress
+{
+	enum class State { Queued, Parsing, Uploading, Done, Failed, Unloaded };
+
+	uint32_t id;
+	const std::string* path;
+	State state;
+	size_t bytesParsed;
+	size_t totalBytes;
+	// set once Done
+	const Mesh* mesh;
+	// set once Failed
+	const std::string* error;
+};
+
+// Loads meshes without blocking the render thread. OBJ files are memory mapped and parsed
+// in parallel on the job system; .vmesh files (see MeshFormat) stay mapped and their
+// sections are uploaded as they are. Either way the data goes through the frame's
+// transfer batch. Parsing only starts while the bytes of all
+// loads in flight fit the budget. Uploads go out in chunks, at most the per-frame budget
+// of bytes each frame and never waiting for staging ring space; a mesh picks up where
+// the last frame stopped and is Done after its last chunk. All calls, callbacks included,
+// happen on the render thread.
+class MeshLoader
+{
+public:
+	using ProgressCallback = std::function<void(const MeshLoadProgress&)>;
+
+	void init(size_t inFlightBudget = 512ull * 1024 * 1024, size_t uploadBytesPerFrame = 16ull * 1024 * 1024);
+	// waits for running parses and unloads the meshes
+	void destroy();
+
+	uint32_t load(const std::string& path, ProgressCallback callback = nullptr);
+	// advances loads and reports progress; call once per frame before Renderer::draw
+	void update();
+
+	// null until the load is Done
+	const Mesh* getMesh(uint32_t id) const;
+	// frees a Done mesh without waiting for the GPU, its buffers go once the frames that
+	// drew it completed; getMesh returns null from here on
+	void unload(uint32_t id);
+	bool isIdle() const { return pendingCount == 0; }
+	size_t getInFlightBytes() const { return inFlightBytes; }
+
+private:
+	struct Request
+	{
+		std::string path;
+		ProgressCallback callback;
+		MeshLoadProgress::State state = MeshLoadProgress::State::Queued;
+		size_t totalBytes = 0;
+		std::atomic<size_t> bytesParsed{ 0 };
+		size_t reportedBytes = 0;
+
+		std::future<void> parse;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		// binary meshes are uploaded from the mapping
+		MappedFile file;
+		MeshFileView view;
+
+		// buffers are created on the first upload frame, then filled vertices first,
+		// indices after, up to this many bytes so far
+		Mesh mesh;
+		size_t uploadedBytes = 0;
+		std::string error;
+	};
+
+	// false if the staging ring or the frame's budget ran out before the mesh did
+	bool upload(Request& request, size_t& budget);
+	void report(uint32_t id);
+	void finish(uint32_t id, const std::string& error);
+
+private:
+	std::vector<std::unique_ptr<Request>> requests;
+	std::deque<uint32_t> queued;
+	std::deque<uint32_t> parsing;
+	std::deque<uint32_t> uploading;
+
+	size_t inFlightBudget = 0;
+	size_t uploadBytesPerFrame = 0;
+	size_t inFlightBytes = 0;
+	uint32_t pendingCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "ObjParser.h"
+#include "core/JobSystem.h"
+#include <stdexcept>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	// 4 MB keeps chunks large enough to amortise scheduling and small enough to balance
+	const size_t objChunkSize = 4 * 1024 * 1024;
+
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+		std::vector<Vertex> vertices;
+		// positive OBJ indices are absolute, negative ones are relative to the vertices
+		// before them and are stored relative to this chunk until its base is known
+		std::vector<int64_t> indices;
+		std::vector<uint32_t> relativeSlots;
+		std::string error;
+	};
+
+	const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		return p;
+	}
+
+	const char* nextLine(const char* p, const char* end)
+	{
+		const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+		return newline ? newline + 1 : end;
+	}
+
+	void parseChunk(ObjChunk& chunk)
+	{
+		struct Corner
+		{
+			int64_t index;
+			bool relative;
+		};
+		std::vector<Corner> polygon;
+
+		for (const char* line = chunk.begin; line < chunk.end; line = nextLine(line, chunk.end))
+		{
+			const char* lineEnd = static_cast<const char*>(memchr(line, '\n', chunk.end - line));
+			if (!lineEnd)
+				lineEnd = chunk.end;
+
+			const char* p = skipSpaces(line, lineEnd);
+			if (lineEnd - p < 2 || (p[1] != ' ' && p[1] != '\t'))
+				continue;
+
+			if (p[0] == 'v')
+			{
+				// x y z with an optional r g b
+				float values[6] = { 0.0f, 0.0f, 0.0f, 0.8f, 0.8f, 0.8f };
+				p += 2;
+				for (int i = 0; i < 6; i++)
+				{
+					p = skipSpaces(p, lineEnd);
+					auto result = std::from_chars(p, lineEnd, values[i]);
+					if (result.ec != std::errc())
+						break;
+					p = result.ptr;
+				}
+
+				chunk.vertices.push_back({ { values[0], values[1], values[2] }, { values[3], values[4], values[5] } });
+			}
+			else if (p[0] == 'f')
+			{
+				polygon.clear();
+				p += 2;
+				while (true)
+				{
+					p = skipSpaces(p, lineEnd);
+					int64_t index;
+					auto result = std::from_chars(p, lineEnd, index);
+					if (result.ec != std::errc())
+						break;
+
+					// only the position index matters, skip /texcoord/normal
+					p = result.ptr;
+					while (p < lineEnd && *p != ' ' && *p != '\t')
+						p++;
+
+					if (index == 0)
+					{
+						chunk.error = "invalid face index 0";
+						return;
+					}
+
+					if (index > 0)
+						polygon.push_back({ index - 1, false });
+					else
+						polygon.push_back({ int64_t(chunk.vertices.size()) + index, true });
+				}
+
+				if (polygon.size() < 3)
+				{
+					chunk.error = "face with fewer than 3 vertices";
+					return;
+				}
+
+				// fan triangulation
+				for (size_t i = 1; i + 1 < polygon.size(); i++)
+				{
+					for (const Corner& corner : { polygon[0], polygon[i], polygon[i + 1] })
+					{
+						if (corner.relative)
+							chunk.relativeSlots.push_back(uint32_t(chunk.indices.size()));
+						chunk.indices.push_back(corner.index);
+					}
+				}
+			}
+		}
+	}
+}
+
+void ObjParser::parse(const MappedFile& file, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+	std::atomic<size_t>* bytesParsed)
+{
+	const char* data = file.data();
+	const char* end = data + file.size();
+
+	// chunks start right after a newline so no line is split
+	std::vector<ObjChunk> chunks;
+	for (const char* begin = data; begin < end;)
+	{
+		const char* chunkEnd = begin + std::min<size_t>(objChunkSize, end - begin);
+		if (chunkEnd < end)
+			chunkEnd = nextLine(chunkEnd, end);
+
+		ObjChunk chunk;
+		chunk.begin = begin;
+		chunk.end = chunkEnd;
+		chunks.push_back(std::move(chunk));
+		begin = chunkEnd;
+	}
+
+	uint32_t parallelism = JobSystem::getThreadCount() + 1;
+	JobSystem::parallelFor(uint32_t(chunks.size()), parallelism, [&](uint32_t i) {
+		// read the next chunk ahead while this one is parsed
+		if (i + 1 < chunks.size())
+			file.prefetch(chunks[i + 1].begin - data, chunks[i + 1].end - chunks[i + 1].begin);
+
+		try
+		{
+			parseChunk(chunks[i]);
+		}
+		catch (std::exception& e)
+		{
+			chunks[i].error = e.what();
+		}
+
+		if (bytesParsed)
+			bytesParsed->fetch_add(chunks[i].end - chunks[i].begin, std::memory_order_relaxed);
+	});
+
+	std::vector<size_t> vertexBase(chunks.size() + 1, 0), indexBase(chunks.size() + 1, 0);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (!chunks[i].error.empty())
+			throw std::runtime_error(chunks[i].error);
+
+		vertexBase[i + 1] = vertexBase[i] + chunks[i].vertices.size();
+		indexBase[i + 1] = indexBase[i] + chunks[i].indices.size();
+	}
+
+	size_t vertexCount = vertexBase.back();
+	if (vertexCount > UINT32_MAX)
+		throw std::runtime_error("mesh has too many vertices");
+
+	vertices.resize(vertexCount);
+	indices.resize(indexBase.back());
+
+	// merging is bandwidth bound, so it is split the same way
+	std::vector<std::string> errors(chunks.size());
+	JobSystem::parallelFor(uint32_t(chunks.size()), parallelism, [&](uint32_t i) {
+		ObjChunk& chunk = chunks[i];
+		for (uint32_t slot : chunk.relativeSlots)
+			chunk.indices[slot] += vertexBase[i];
+
+		std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + vertexBase[i]);
+
+		uint32_t* out = indices.data() + indexBase[i];
+		for (int64_t index : chunk.indices)
+		{
+			if (index < 0 || size_t(index) >= vertexCount)
+			{
+				errors[i] = "face index out of range";
+				return;
+			}
+			*out++ = uint32_t(index);
+		}
+
+		chunk.vertices = {};
+		chunk.indices = {};
+	});
+
+	for (const auto& error : errors)
+		if (!error.empty())
+			throw std::runtime_error(error);
+}
\ No newline at end of file
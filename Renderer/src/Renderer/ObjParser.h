@@ -0,0 +1,14 @@
+#pragma once
+#include "Mesh.h"
+#include "core/MappedFile.h"
+#include <vector>
+#include <atomic>
+
+// Wavefront OBJ positions, optional vertex colours and faces. The file is split into
+// line-aligned chunks that are parsed in parallel on the job system.
+class ObjParser
+{
+public:
+	static void parse(const MappedFile& file, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+		std::atomic<size_t>* bytesParsed = nullptr);
+};
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "PipelineCache.h"
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+void PipelineCache::create(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path)
+{
+	this->device = device;
+	this->path = path;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	std::vector<char> data = loadValidatedData();
+	warm = !data.empty();
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS)
+	{
+		// a driver may still reject data that passed our checks, start cold instead
+		warm = false;
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+
+		if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS)
+			throw std::runtime_error("cannot create pipeline cache");
+	}
+
+	std::cout << "pipeline cache " << (warm ? "loaded from " : "is cold, will be written to ") << path << std::endl;
+}
+
+void PipelineCache::save()
+{
+	if (cache == VK_NULL_HANDLE)
+		return;
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+		return;
+
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS)
+		return;
+	data.resize(dataSize);
+
+	FileHeader header = makeHeader();
+	header.dataSize = dataSize;
+	header.dataHash = hash(data.data(), data.size());
+
+	// write next to the target and rename over it so a crash never leaves a torn file
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cout << "cannot write pipeline cache to " << temporaryPath << std::endl;
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), data.size());
+		file.flush();
+
+		if (!file.good())
+		{
+			std::cout << "cannot write pipeline cache to " << temporaryPath << std::endl;
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+		std::cout << "cannot replace pipeline cache " << path << ": " << error.message() << std::endl;
+}
+
+void PipelineCache::destroy()
+{
+	if (cache != VK_NULL_HANDLE)
+		vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+std::vector<char> PipelineCache::loadValidatedData() const
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open())
+		return {};
+
+	size_t fileSize = (size_t)file.tellg();
+	if (fileSize < sizeof(FileHeader))
+		return {};
+
+	FileHeader header;
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	FileHeader expected = makeHeader();
+	if (header.magic != expected.magic || header.version != expected.version ||
+		header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+		header.driverVersion != expected.driverVersion ||
+		memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		std::cout << "pipeline cache " << path << " belongs to another device or driver, ignoring it" << std::endl;
+		return {};
+	}
+
+	if (header.dataSize != fileSize - sizeof(FileHeader))
+		return {};
+
+	std::vector<char> data(header.dataSize);
+	file.read(data.data(), data.size());
+
+	if (!file.good() || hash(data.data(), data.size()) != header.dataHash)
+	{
+		std::cout << "pipeline cache " << path << " is corrupted, ignoring it" << std::endl;
+		return {};
+	}
+
+	// the driver's own header has to agree as well
+	VkPipelineCacheHeaderVersionOne driverHeader;
+	if (data.size() < sizeof(driverHeader))
+		return {};
+
+	memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+	if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		driverHeader.vendorID != properties.vendorID || driverHeader.deviceID != properties.deviceID ||
+		memcmp(driverHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		return {};
+
+	return data;
+}
+
+PipelineCache::FileHeader PipelineCache::makeHeader() const
+{
+	FileHeader header{};
+	header.magic = fileMagic;
+	header.version = fileVersion;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	return header;
+}
+
+uint64_t PipelineCache::hash(const char* data, size_t size)
+{
+	// FNV-1a
+	uint64_t value = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		value ^= uint8_t(data[i]);
+		value *= 1099511628211ull;
+	}
+	return value;
+}
\ No newline at end of file
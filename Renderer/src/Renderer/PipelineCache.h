@@ -0,0 +1,45 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <string>
+#include <vector>
+
+// VkPipelineCache persisted between runs. The blob is only reused when it was
+// produced by the same device and driver build, everything else starts cold.
+class PipelineCache
+{
+public:
+	void create(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+	void save();
+	void destroy();
+
+	VkPipelineCache get() const { return cache; }
+	bool isWarm() const { return warm; }
+
+private:
+	// prepended to the driver's data on disk
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	std::vector<char> loadValidatedData() const;
+	FileHeader makeHeader() const;
+	static uint64_t hash(const char* data, size_t size);
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties properties{};
+	std::string path;
+	bool warm = false;
+
+	static const uint32_t fileMagic = 0x43505256; // "VRPC"
+	static const uint32_t fileVersion = 1;
+};
\ No newline at end of file
@@ -0,0 +1,620 @@
+#include "PipelineCompiler.h"
+#include "Renderer.h"
+#include "ShaderReflection.h"
+#include "core/JobSystem.h"
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+VkPipeline PipelineHandle::get() const
+{
+	if (!state)
+		return VK_NULL_HANDLE;
+
+	VkPipeline pipeline = state->pipeline.load(std::memory_order_acquire);
+	if (pipeline != VK_NULL_HANDLE || !state->fallback)
+		return pipeline;
+
+	return state->fallback->pipeline.load(std::memory_order_acquire);
+}
+
+bool PipelineHandle::isReady() const
+{
+	return state && state->pipeline.load(std::memory_order_acquire) != VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineHandle::wait() const
+{
+	if (!state)
+		return VK_NULL_HANDLE;
+
+	state->future.get();
+	return state->pipeline.load(std::memory_order_acquire);
+}
+
+void PipelineCompiler::init(VkDevice device, VkPipelineCache cache, LayoutCache& layouts,
+	const LayoutCache::PipelineLayoutDesc& sharedLayout)
+{
+	this->device = device;
+	this->cache = cache;
+	this->layouts = &layouts;
+	this->sharedLayout = sharedLayout;
+}
+
+void PipelineCompiler::destroy()
+{
+	waitIdle();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const auto& entry : pipelines)
+	{
+		const auto& state = entry.second;
+		VkPipeline pipeline = state->pipeline.load();
+		if (pipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(device, pipeline, nullptr);
+		if (state->depthOnly != VK_NULL_HANDLE)
+			vkDestroyPipeline(device, state->depthOnly, nullptr);
+	}
+
+	// rebuilds that finished after the last swap
+	for (const Reloaded& result : reloaded)
+	{
+		vkDestroyPipeline(device, result.pipeline, nullptr);
+		if (result.depthOnly != VK_NULL_HANDLE)
+			vkDestroyPipeline(device, result.depthOnly, nullptr);
+	}
+
+	pipelines.clear();
+	depthOnlyVariants.clear();
+	reloads.clear();
+	reloaded.clear();
+}
+
+namespace
+{
+	template<typename T>
+	void append(std::string& key, const T& value)
+	{
+		key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void append(std::string& key, const std::string& value)
+	{
+		append(key, uint32_t(value.size()));
+		key += value;
+	}
+}
+
+std::string GraphicsPipelineDesc::getKey() const
+{
+	std::string key;
+	append(key, vertexShaderPath);
+	append(key, fragmentShaderPath);
+
+	append(key, uint32_t(vertexBindings.size()));
+	for (const auto& binding : vertexBindings)
+		append(key, binding);
+	append(key, uint32_t(vertexAttributes.size()));
+	for (const auto& attribute : vertexAttributes)
+		append(key, attribute);
+	append(key, topology);
+
+	append(key, polygonMode);
+	append(key, cullMode);
+	append(key, frontFace);
+	append(key, blendEnable);
+
+	append(key, depthTest);
+	append(key, depthWrite);
+	append(key, depthCompare);
+	append(key, depthOnly);
+
+	// the order constants were set in does not change the pipeline
+	std::vector<SpecializationConstant> constants = specialization;
+	std::sort(constants.begin(), constants.end(), [](const SpecializationConstant& a, const SpecializationConstant& b) {
+		return a.constantId < b.constantId;
+	});
+	append(key, uint32_t(constants.size()));
+	for (const auto& constant : constants)
+		append(key, constant);
+
+	// the handles stand in for compatibility: render passes come from the frame graph
+	// and layouts from the layout cache, which both hand out one object per description
+	append(key, layout);
+	append(key, renderPass);
+	append(key, subpass);
+	return key;
+}
+
+PipelineHandle PipelineCompiler::compile(const GraphicsPipelineDesc& desc, const PipelineHandle& fallback,
+	const GraphicsPipelineDesc* depthOnlyDesc)
+{
+	std::string key = desc.getKey();
+	if (depthOnlyDesc)
+		key += depthOnlyDesc->getKey();
+
+	// looked up and inserted under one lock, so concurrent requests for the same state
+	// still compile it once
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = pipelines.find(key);
+	if (it != pipelines.end())
+	{
+		stats.hits++;
+		PipelineHandle handle;
+		handle.state = it->second;
+		return handle;
+	}
+	stats.misses++;
+
+	auto state = std::make_shared<PipelineHandle::State>();
+	state->fallback = fallback.state;
+	state->desc = desc;
+	state->hasDepthOnly = depthOnlyDesc != nullptr;
+	if (depthOnlyDesc)
+		state->depthOnlyDesc = *depthOnlyDesc;
+
+	VkDevice device = this->device;
+
+	// the job holds the state alive even if every handle is dropped
+	state->future = JobSystem::submit([this, device, state]() {
+		const GraphicsPipelineDesc& desc = state->desc;
+		try
+		{
+			if (state->hasDepthOnly)
+				state->depthOnly = build(state->depthOnlyDesc);
+
+			VkPipeline pipeline;
+			try
+			{
+				pipeline = build(desc);
+			}
+			catch (...)
+			{
+				if (state->hasDepthOnly)
+					vkDestroyPipeline(device, state->depthOnly, nullptr);
+				state->depthOnly = VK_NULL_HANDLE;
+				throw;
+			}
+
+			if (state->hasDepthOnly)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				depthOnlyVariants[pipeline] = state->depthOnly;
+			}
+
+			state->pipeline.store(pipeline, std::memory_order_release);
+			return pipeline;
+		}
+		catch (std::exception& e)
+		{
+			std::cout << "pipeline compilation failed (" << desc.vertexShaderPath << ", "
+				<< desc.fragmentShaderPath << "): " << e.what() << std::endl;
+			throw;
+		}
+	}).share();
+
+	pipelines.emplace(std::move(key), state);
+
+	PipelineHandle handle;
+	handle.state = state;
+	return handle;
+}
+
+std::vector<PipelineHandle> PipelineCompiler::compile(const std::vector<GraphicsPipelineDesc>& descs, const PipelineHandle& fallback)
+{
+	std::vector<PipelineHandle> handles;
+	handles.reserve(descs.size());
+
+	for (const auto& desc : descs)
+		handles.push_back(compile(desc, fallback));
+
+	return handles;
+}
+
+VkPipeline PipelineCompiler::getDepthOnly(VkPipeline pipeline) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = depthOnlyVariants.find(pipeline);
+	return it != depthOnlyVariants.end() ? it->second : VK_NULL_HANDLE;
+}
+
+void PipelineCompiler::reload(const std::string& shaderPath)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const auto& entry : pipelines)
+	{
+		const auto& state = entry.second;
+		const GraphicsPipelineDesc& desc = state->desc;
+		if (desc.vertexShaderPath != shaderPath && desc.fragmentShaderPath != shaderPath)
+			continue;
+
+		// a first compile still running may or may not see the new file, either way it
+		// is left alone; one that failed is rebuilt like any other so a broken shader can
+		// be fixed without a restart
+		if (state->future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
+
+		VkDevice device = this->device;
+		uint32_t generation = ++state->reloadGeneration;
+		reloads.push_back(JobSystem::submit([this, device, state, generation]() {
+			Reloaded result = { state, VK_NULL_HANDLE, VK_NULL_HANDLE, generation };
+			try
+			{
+				result.pipeline = build(state->desc);
+				if (state->hasDepthOnly)
+					result.depthOnly = build(state->depthOnlyDesc);
+			}
+			catch (std::exception& e)
+			{
+				if (result.pipeline != VK_NULL_HANDLE)
+					vkDestroyPipeline(device, result.pipeline, nullptr);
+				std::cout << "pipeline reload failed (" << state->desc.vertexShaderPath << ", "
+					<< state->desc.fragmentShaderPath << "), keeping the previous one: " << e.what() << std::endl;
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			reloaded.push_back(result);
+		}).share());
+	}
+}
+
+std::vector<VkPipeline> PipelineCompiler::swapReloaded()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<VkPipeline> replaced;
+	for (const Reloaded& result : reloaded)
+	{
+		PipelineHandle::State& state = *result.state;
+		if (result.generation != state.reloadGeneration)
+		{
+			// never used, but freed the same way
+			replaced.push_back(result.pipeline);
+			if (result.depthOnly != VK_NULL_HANDLE)
+				replaced.push_back(result.depthOnly);
+			continue;
+		}
+
+		VkPipeline previous = state.pipeline.exchange(result.pipeline, std::memory_order_acq_rel);
+
+		// a pipeline whose first compile failed has nothing to replace
+		if (previous != VK_NULL_HANDLE)
+			replaced.push_back(previous);
+
+		if (state.hasDepthOnly)
+		{
+			depthOnlyVariants.erase(previous);
+			depthOnlyVariants[result.pipeline] = result.depthOnly;
+			if (state.depthOnly != VK_NULL_HANDLE)
+				replaced.push_back(state.depthOnly);
+			state.depthOnly = result.depthOnly;
+		}
+	}
+	reloaded.clear();
+
+	auto finished = [](const std::shared_future<void>& reload) {
+		return reload.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	};
+	reloads.erase(std::remove_if(reloads.begin(), reloads.end(), finished), reloads.end());
+
+	return replaced;
+}
+
+void PipelineCompiler::dumpStats(std::ostream& out) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t requests = stats.hits + stats.misses;
+	out << "pipelines: " << requests << " requests, " << stats.hits << " hits, " << stats.misses << " misses ("
+		<< (requests > 0 ? 100.0 * stats.hits / requests : 0.0) << "% hit rate)" << std::endl;
+	out << "pipelines: " << stats.builds << " builds in " << stats.buildMilliseconds << " ms, slowest "
+		<< stats.slowestBuildMilliseconds << " ms" << std::endl;
+}
+
+void PipelineCompiler::waitIdle()
+{
+	std::vector<std::shared_ptr<PipelineHandle::State>> states;
+	std::vector<std::shared_future<void>> reloadJobs;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const auto& entry : pipelines)
+			states.push_back(entry.second);
+		reloadJobs = reloads;
+	}
+
+	// failed compiles keep using their fallback, the error was already reported
+	for (const auto& state : states)
+		state->future.wait();
+	for (const auto& reload : reloadJobs)
+		reload.wait();
+}
+
+namespace
+{
+	// the constants of a description that one stage declares; ids the stage does not
+	// declare are left out, as Vulkan would ignore them anyway
+	class Specialization
+	{
+	public:
+		Specialization(const GraphicsPipelineDesc& desc, const ShaderReflection& reflection)
+		{
+			for (const auto& constant : desc.specialization)
+			{
+				auto declared = std::find_if(reflection.specializationConstants.begin(), reflection.specializationConstants.end(),
+					[&constant](const ShaderReflection::SpecializationConstant& c) { return c.id == constant.constantId; });
+				if (declared == reflection.specializationConstants.end())
+					continue;
+				if (declared->size != sizeof(uint32_t))
+					throw std::runtime_error("specialization constant " + std::to_string(constant.constantId) + " is not 32 bits wide");
+
+				entries.push_back({ constant.constantId, uint32_t(data.size() * sizeof(uint32_t)), sizeof(uint32_t) });
+				data.push_back(constant.value);
+			}
+
+			info.mapEntryCount = uint32_t(entries.size());
+			info.pMapEntries = entries.data();
+			info.dataSize = data.size() * sizeof(uint32_t);
+			info.pData = data.data();
+		}
+
+		Specialization(const Specialization&) = delete;
+		Specialization& operator=(const Specialization&) = delete;
+
+		const VkSpecializationInfo* get() const { return entries.empty() ? nullptr : &info; }
+
+	private:
+		std::vector<VkSpecializationMapEntry> entries;
+		std::vector<uint32_t> data;
+		VkSpecializationInfo info{};
+	};
+
+	ShaderReflection reflect(const std::string& path, const std::vector<char>& code)
+	{
+		try
+		{
+			return ShaderReflection::reflect(code);
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error(path + ": " + e.what());
+		}
+	}
+}
+
+VkPipeline PipelineCompiler::build(const GraphicsPipelineDesc& desc)
+{
+	std::vector<char> vertexCode = Renderer::readFile(desc.vertexShaderPath);
+	ShaderReflection vertexReflection = reflect(desc.vertexShaderPath, vertexCode);
+	std::vector<const ShaderReflection*> reflections = { &vertexReflection };
+
+	std::vector<char> fragmentCode;
+	ShaderReflection fragmentReflection;
+	bool hasFragmentShader = !desc.fragmentShaderPath.empty();
+	if (hasFragmentShader)
+	{
+		fragmentCode = Renderer::readFile(desc.fragmentShaderPath);
+		fragmentReflection = reflect(desc.fragmentShaderPath, fragmentCode);
+		reflections.push_back(&fragmentReflection);
+	}
+
+	// a constant no stage declares would quietly build the default permutation, which is
+	// what a module compiled before the constant was added does
+	for (const auto& constant : desc.specialization)
+	{
+		bool declared = false;
+		for (const ShaderReflection* reflection : reflections)
+		{
+			for (const auto& stageConstant : reflection->specializationConstants)
+				declared = declared || stageConstant.id == constant.constantId;
+		}
+		if (!declared)
+			throw std::runtime_error("specialization constant " + std::to_string(constant.constantId) + " is declared by neither " +
+				desc.vertexShaderPath + " nor " + desc.fragmentShaderPath + ", is a module out of date?");
+	}
+
+	// equal interfaces come back as the same layout, which keeps sets bound across draws
+	VkPipelineLayout layout = desc.layout;
+	if (layout == VK_NULL_HANDLE)
+	{
+		try
+		{
+			layout = layouts->getPipelineLayout(LayoutCache::describe(reflections, sharedLayout));
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error("layout of " + desc.vertexShaderPath + " and " + desc.fragmentShaderPath + ": " + e.what());
+		}
+	}
+
+	std::vector<VkVertexInputBindingDescription> vertexBindings = desc.vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	if (vertexBindings.empty())
+	{
+		// without a vertex format the inputs are read tightly packed from binding 0
+		uint32_t stride = 0;
+		for (const auto& input : vertexReflection.vertexInputs)
+		{
+			vertexAttributes.push_back({ input.location, 0, input.format, stride });
+			stride += input.size;
+		}
+		if (stride > 0)
+			vertexBindings.push_back({ 0, stride, VK_VERTEX_INPUT_RATE_VERTEX });
+	}
+	else
+	{
+		// attributes the shader never reads are not fetched
+		for (const auto& attribute : desc.vertexAttributes)
+		{
+			if (vertexReflection.readsLocation(attribute.location))
+				vertexAttributes.push_back(attribute);
+		}
+
+		for (const auto& input : vertexReflection.vertexInputs)
+		{
+			auto provided = [&input](const VkVertexInputAttributeDescription& attribute) { return attribute.location == input.location; };
+			if (std::none_of(vertexAttributes.begin(), vertexAttributes.end(), provided))
+				throw std::runtime_error(desc.vertexShaderPath + " reads location " + std::to_string(input.location) +
+					", which the vertex format does not provide");
+		}
+	}
+
+	VkShaderModule vertexShaderModule = createShaderModule(device, vertexCode);
+	VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
+	try
+	{
+		if (hasFragmentShader)
+			fragmentShaderModule = createShaderModule(device, fragmentCode);
+	}
+	catch (...)
+	{
+		vkDestroyShaderModule(device, vertexShaderModule, nullptr);
+		throw;
+	}
+
+	Specialization vertexSpecialization(desc, vertexReflection);
+	Specialization fragmentSpecialization(desc, fragmentReflection);
+
+	VkPipelineShaderStageCreateInfo vertexShaderStageInfo{};
+	vertexShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertexShaderStageInfo.module = vertexShaderModule;
+	vertexShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertexShaderStageInfo.pName = "main";
+	vertexShaderStageInfo.pSpecializationInfo = vertexSpecialization.get();
+
+	VkPipelineShaderStageCreateInfo fragmentShaderStageInfo{};
+	fragmentShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragmentShaderStageInfo.module = fragmentShaderModule;
+	fragmentShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fragmentShaderStageInfo.pName = "main";
+	fragmentShaderStageInfo.pSpecializationInfo = fragmentSpecialization.get();
+
+	VkPipelineShaderStageCreateInfo stages[] = { vertexShaderStageInfo, fragmentShaderStageInfo };
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = vertexBindings.size();
+	vertexInputInfo.pVertexBindingDescriptions = vertexBindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = vertexAttributes.size();
+	vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
+	inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyInfo.topology = desc.topology;
+	inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+
+	// set at record time so the pipeline survives swapchain resizes
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = desc.polygonMode;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = desc.cullMode;
+	rasterizer.frontFace = desc.frontFace;
+
+	rasterizer.depthBiasEnable = VK_FALSE;
+	rasterizer.depthBiasConstantFactor = 0.0f;
+	rasterizer.depthBiasClamp = 0.0f;
+	rasterizer.depthBiasSlopeFactor = 0.0f;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.minSampleShading = 1.0f;
+	multisampling.pSampleMask = nullptr;
+	multisampling.alphaToCoverageEnable = VK_FALSE;
+	multisampling.alphaToOneEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = desc.blendEnable ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = desc.blendEnable ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY; // optional
+	colorBlending.attachmentCount = desc.depthOnly ? 0 : 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = desc.depthCompare;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.layout = layout;
+	pipelineInfo.stageCount = hasFragmentShader ? 2 : 1;
+	pipelineInfo.pStages = stages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.renderPass = desc.renderPass;
+	pipelineInfo.subpass = desc.subpass;
+
+	auto start = std::chrono::steady_clock::now();
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline);
+	std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+
+	vkDestroyShaderModule(device, vertexShaderModule, nullptr);
+	vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("cannot create graphics pipeline");
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.builds++;
+	stats.buildMilliseconds += buildTime.count();
+	stats.slowestBuildMilliseconds = std::max(stats.slowestBuildMilliseconds, buildTime.count());
+	return pipeline;
+}
+
+VkShaderModule PipelineCompiler::createShaderModule(VkDevice device, const std::string& path)
+{
+	return createShaderModule(device, Renderer::readFile(path));
+}
+
+VkShaderModule PipelineCompiler::createShaderModule(VkDevice device, const std::vector<char>& code)
+{
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size();
+	createInfo.pCode = (uint32_t*)code.data();
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+		throw std::runtime_error("cannot create shader module");
+
+	return shaderModule;
+}
\ No newline at end of file
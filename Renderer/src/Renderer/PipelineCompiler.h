@@ -0,0 +1,163 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "LayoutCache.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <ostream>
+
+// Everything needed to build a graphics pipeline. Unlike VkGraphicsPipelineCreateInfo it
+// owns its state, so it can be handed to a worker thread and outlive the caller's stack.
+// Viewport and scissor are dynamic state and are not part of the description.
+struct GraphicsPipelineDesc
+{
+	std::string vertexShaderPath;
+	std::string fragmentShaderPath;
+
+	// the vertex buffer format; without bindings the vertex shader's inputs are read
+	// tightly packed from binding 0, attributes the shader does not read are dropped
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+	bool blendEnable = false;
+
+	// against the render pass's depth attachment; depthOnly drops the colour output, for
+	// depth pre-passes, which leave fragmentShaderPath empty unless the shader discards
+	bool depthTest = false;
+	bool depthWrite = false;
+	VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+	bool depthOnly = false;
+
+	// by constant_id for both stages, each gets the ones it declares; 32-bit values, bools
+	// as VkBool32 and floats by their bits. Every combination is its own pipeline, compiled
+	// without the branches it does not take.
+	struct SpecializationConstant
+	{
+		uint32_t constantId;
+		uint32_t value;
+	};
+	std::vector<SpecializationConstant> specialization;
+
+	// VK_NULL_HANDLE reflects it from the shaders
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+
+	// every field above packed into bytes; equal keys build the same pipeline
+	std::string getKey() const;
+};
+
+// Refers to a pipeline that may still be compiling. Until it is ready get() returns the
+// fallback, so draws can be recorded against it right away. A reload replaces the
+// pipeline behind the handle between frames.
+class PipelineHandle
+{
+public:
+	PipelineHandle() = default;
+
+	VkPipeline get() const;
+	bool isReady() const;
+	// blocks until the first compilation finished, rethrows compile errors
+	VkPipeline wait() const;
+
+private:
+	friend class PipelineCompiler;
+
+	struct State
+	{
+		std::atomic<VkPipeline> pipeline{ VK_NULL_HANDLE };
+		// followed rather than copied, so reloads of the fallback show through
+		std::shared_ptr<State> fallback;
+		std::shared_future<VkPipeline> future;
+
+		// kept to rebuild the pipeline when one of its shaders changes
+		GraphicsPipelineDesc desc;
+		bool hasDepthOnly = false;
+		GraphicsPipelineDesc depthOnlyDesc;
+		VkPipeline depthOnly = VK_NULL_HANDLE;
+		// the latest reload, builds that finish behind a newer one are dropped
+		uint32_t reloadGeneration = 0;
+	};
+
+	std::shared_ptr<State> state;
+};
+
+// Compiles pipelines on the job system. All workers share one VkPipelineCache, which is
+// internally synchronized for pipeline creation. Requests are deduplicated by the
+// description's key: a state that was requested before returns the same handle, with
+// the fallback of its first request, and never compiles twice.
+class PipelineCompiler
+{
+public:
+	// pipelines without a layout get one derived from their shaders on top of sharedLayout
+	void init(VkDevice device, VkPipelineCache cache, LayoutCache& layouts, const LayoutCache::PipelineLayoutDesc& sharedLayout);
+	// waits for outstanding compiles and destroys every pipeline it produced
+	void destroy();
+
+	// with a depth-only description the variant is built first and published together
+	// with the pipeline, so getDepthOnly() finds it for every pipeline a handle returned
+	PipelineHandle compile(const GraphicsPipelineDesc& desc, const PipelineHandle& fallback,
+		const GraphicsPipelineDesc* depthOnlyDesc = nullptr);
+	std::vector<PipelineHandle> compile(const std::vector<GraphicsPipelineDesc>& descs, const PipelineHandle& fallback);
+	// waits for compiles and reloads
+	void waitIdle();
+	// null for pipelines compiled without a variant; any thread
+	VkPipeline getDepthOnly(VkPipeline pipeline) const;
+
+	// rebuilds every pipeline that uses the SPIR-V file and has finished its first
+	// compile, including those whose first compile failed, on the job system; a failed
+	// rebuild keeps the previous pipeline. Any thread.
+	void reload(const std::string& shaderPath);
+	// publishes the finished rebuilds without waiting for the others; render thread,
+	// between frames. Returns the replaced pipelines, which frames in flight may still use.
+	std::vector<VkPipeline> swapReloaded();
+
+	// request and build counters; build time is the driver's, reflection and shader
+	// loading excluded. Depth-only variants and reloads count as builds.
+	void dumpStats(std::ostream& out) const;
+
+	// synchronous build on the calling thread, bypasses the deduplication
+	VkPipeline build(const GraphicsPipelineDesc& desc);
+	static VkShaderModule createShaderModule(VkDevice device, const std::string& path);
+	static VkShaderModule createShaderModule(VkDevice device, const std::vector<char>& code);
+
+private:
+	struct Stats
+	{
+		uint32_t hits = 0;
+		uint32_t misses = 0;
+		uint32_t builds = 0;
+		double buildMilliseconds = 0.0;
+		double slowestBuildMilliseconds = 0.0;
+	};
+
+	struct Reloaded
+	{
+		std::shared_ptr<PipelineHandle::State> state;
+		VkPipeline pipeline;
+		VkPipeline depthOnly;
+		uint32_t generation;
+	};
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	LayoutCache* layouts = nullptr;
+	LayoutCache::PipelineLayoutDesc sharedLayout;
+
+	mutable std::mutex mutex;
+	// keyed by GraphicsPipelineDesc::getKey(), with the depth-only variant's appended
+	std::unordered_map<std::string, std::shared_ptr<PipelineHandle::State>> pipelines;
+	std::unordered_map<VkPipeline, VkPipeline> depthOnlyVariants;
+	std::vector<std::shared_future<void>> reloads;
+	std::vector<Reloaded> reloaded;
+	Stats stats;
+};
\ No newline at end of file
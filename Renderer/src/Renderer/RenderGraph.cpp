@@ -0,0 +1,1217 @@
+#include "RenderGraph.h"
+#include <stdexcept>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	const char* getStageName(VkPipelineStageFlags stage)
+	{
+		switch (stage)
+		{
+		case VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT: return "TOP_OF_PIPE";
+		case VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT: return "DRAW_INDIRECT";
+		case VK_PIPELINE_STAGE_VERTEX_INPUT_BIT: return "VERTEX_INPUT";
+		case VK_PIPELINE_STAGE_VERTEX_SHADER_BIT: return "VERTEX_SHADER";
+		case VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT: return "FRAGMENT_SHADER";
+		case VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT: return "EARLY_FRAGMENT_TESTS";
+		case VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT: return "LATE_FRAGMENT_TESTS";
+		case VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT: return "COLOR_ATTACHMENT_OUTPUT";
+		case VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT: return "COMPUTE_SHADER";
+		case VK_PIPELINE_STAGE_TRANSFER_BIT: return "TRANSFER";
+		case VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT: return "BOTTOM_OF_PIPE";
+		case VK_PIPELINE_STAGE_ALL_COMMANDS_BIT: return "ALL_COMMANDS";
+		default: return "?";
+		}
+	}
+
+	std::string getStageNames(VkPipelineStageFlags stages)
+	{
+		std::string names;
+		for (uint32_t bit = 0; bit < 32; bit++)
+		{
+			if (!(stages & (1u << bit)))
+				continue;
+
+			if (!names.empty())
+				names += "|";
+			names += getStageName(1u << bit);
+		}
+
+		return names.empty() ? "NONE" : names;
+	}
+
+	const char* getLayoutName(VkImageLayout layout)
+	{
+		switch (layout)
+		{
+		case VK_IMAGE_LAYOUT_UNDEFINED: return "UNDEFINED";
+		case VK_IMAGE_LAYOUT_GENERAL: return "GENERAL";
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "COLOR_ATTACHMENT";
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "DEPTH_STENCIL_ATTACHMENT";
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "SHADER_READ_ONLY";
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "TRANSFER_SRC";
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "TRANSFER_DST";
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "PRESENT_SRC";
+		default: return "?";
+		}
+	}
+
+	const char* getUsageName(RenderGraph::Usage usage)
+	{
+		switch (usage)
+		{
+		case RenderGraph::Usage::ColorAttachment: return "color";
+		case RenderGraph::Usage::DepthAttachment: return "depth";
+		case RenderGraph::Usage::Sampled: return "sampled";
+		case RenderGraph::Usage::StorageRead: return "storage read";
+		case RenderGraph::Usage::StorageWrite: return "storage write";
+		case RenderGraph::Usage::IndirectRead: return "indirect";
+		case RenderGraph::Usage::VertexRead: return "vertex";
+		case RenderGraph::Usage::TransferRead: return "transfer read";
+		case RenderGraph::Usage::TransferWrite: return "transfer write";
+		}
+
+		return "?";
+	}
+
+	std::string formatBytes(VkDeviceSize bytes)
+	{
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB";
+		return out.str();
+	}
+
+	bool hasStencil(VkFormat format)
+	{
+		return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+}
+
+RenderGraph::Resource RenderGraph::createImage(const std::string& name, VkFormat format, VkExtent2D extent)
+{
+	ResourceNode resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.imported = false;
+	resource.format = format;
+	resource.extent = extent;
+	resources.push_back(resource);
+	return Resource(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importImage(const std::string& name, VkFormat format, VkExtent2D extent,
+	VkImageLayout initialLayout, VkImageLayout finalLayout)
+{
+	ResourceNode resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.imported = true;
+	resource.format = format;
+	resource.extent = extent;
+	resource.initialLayout = initialLayout;
+	resource.finalLayout = finalLayout;
+	resources.push_back(resource);
+	return Resource(resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const std::string& name)
+{
+	ResourceNode resource;
+	resource.name = name;
+	resource.isImage = false;
+	resource.imported = true;
+	resources.push_back(resource);
+	return Resource(resources.size() - 1);
+}
+
+RenderGraph::Pass RenderGraph::addPass(const std::string& name, PassType type, ExecuteFunction execute, bool secondaryContents)
+{
+	PassNode pass;
+	pass.name = name;
+	pass.type = type;
+	pass.execute = std::move(execute);
+	pass.secondaryContents = secondaryContents && type == PassType::Graphics;
+	passes.push_back(std::move(pass));
+	return Pass(passes.size() - 1);
+}
+
+void RenderGraph::use(Pass pass, Resource resource, Usage usage)
+{
+	PassNode& node = passes[pass];
+	if (isAttachment(usage) && (node.type != PassType::Graphics || !resources[resource].isImage))
+		throw std::runtime_error("render graph attachments need a graphics pass and an image");
+
+	for (const Access& access : node.accesses)
+	{
+		if (access.resource == resource)
+			throw std::runtime_error("render graph pass \"" + node.name + "\" uses \"" + resources[resource].name + "\" twice");
+	}
+
+	node.accesses.push_back({ resource, usage, false, {} });
+}
+
+void RenderGraph::useAttachment(Pass pass, Resource resource, Usage usage, const VkClearValue& clear)
+{
+	use(pass, resource, usage);
+	passes[pass].accesses.back().clear = true;
+	passes[pass].accesses.back().clearValue = clear;
+}
+
+void RenderGraph::compile()
+{
+	if (device != VK_NULL_HANDLE)
+		throw std::runtime_error("render graph compiled while realized");
+
+	cullPasses();
+	buildGroups();
+	computeLifetimes();
+	planAliasing();
+	computeSynchronization();
+
+	stats.passes = uint32_t(passes.size());
+	stats.culledPasses = uint32_t(passes.size() - order.size());
+	stats.renderPasses = 0;
+	stats.mergedSubpasses = 0;
+	for (const Group& group : groups)
+	{
+		if (!group.renderPass)
+			continue;
+
+		stats.renderPasses++;
+		stats.mergedSubpasses += uint32_t(group.passes.size() - 1);
+	}
+}
+
+void RenderGraph::realize(VkDevice device, MemoryAllocator& allocator)
+{
+	this->device = device;
+	this->allocator = &allocator;
+
+	for (ResourceNode& resource : resources)
+	{
+		if (resource.imported || !resource.isImage || resource.firstUse == UINT32_MAX)
+			continue;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = resource.format;
+		imageInfo.extent = { resource.extent.width, resource.extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = resource.imageUsage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+			throw std::runtime_error("cannot create render graph image " + resource.name);
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, resource.image, &requirements);
+		resource.size = requirements.size;
+		resource.alignment = requirements.alignment;
+		resource.memoryTypeBits = requirements.memoryTypeBits;
+	}
+
+	// the estimates may have grouped differently, and the slots decide the aliasing barriers
+	planAliasing();
+	computeSynchronization();
+
+	for (AliasSlot& slot : aliasSlots)
+	{
+		VkMemoryRequirements requirements = { slot.size, slot.alignment, slot.memoryTypeBits };
+		slot.allocation = allocator.allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, true);
+
+		for (Resource index : slot.resources)
+		{
+			ResourceNode& resource = resources[index];
+			if (vkBindImageMemory(device, resource.image, slot.allocation->memory, slot.allocation->offset) != VK_SUCCESS)
+				throw std::runtime_error("cannot bind render graph image " + resource.name);
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = resource.image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = resource.format;
+			viewInfo.subresourceRange = { getAspect(resource.format), 0, 1, 0, 1 };
+
+			if (vkCreateImageView(device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS)
+				throw std::runtime_error("cannot create render graph image view " + resource.name);
+		}
+	}
+
+	for (Group& group : groups)
+	{
+		if (group.renderPass)
+			createRenderPass(group);
+	}
+}
+
+void RenderGraph::destroy()
+{
+	if (device != VK_NULL_HANDLE)
+	{
+		for (auto& entry : framebuffers)
+			vkDestroyFramebuffer(device, entry.second, nullptr);
+
+		for (Group& group : groups)
+		{
+			if (group.handle != VK_NULL_HANDLE)
+				vkDestroyRenderPass(device, group.handle, nullptr);
+		}
+
+		for (ResourceNode& resource : resources)
+		{
+			if (resource.imported)
+				continue;
+
+			if (resource.view != VK_NULL_HANDLE)
+				vkDestroyImageView(device, resource.view, nullptr);
+			if (resource.image != VK_NULL_HANDLE)
+				vkDestroyImage(device, resource.image, nullptr);
+		}
+
+		for (AliasSlot& slot : aliasSlots)
+		{
+			if (slot.allocation)
+				allocator->free(slot.allocation);
+		}
+	}
+
+	for (ResourceNode& resource : resources)
+	{
+		if (resource.imported)
+			continue;
+
+		resource.image = VK_NULL_HANDLE;
+		resource.view = VK_NULL_HANDLE;
+	}
+
+	for (PassNode& pass : passes)
+		pass.kept = false;
+
+	framebuffers.clear();
+	groups.clear();
+	aliasSlots.clear();
+	order.clear();
+	after = Barrier();
+	stats = Stats();
+	device = VK_NULL_HANDLE;
+	allocator = nullptr;
+}
+
+void RenderGraph::reset()
+{
+	destroy();
+	passes.clear();
+	resources.clear();
+}
+
+void RenderGraph::setImage(Resource resource, VkImage image, VkImageView view, VkExtent2D extent)
+{
+	ResourceNode& node = resources[resource];
+	if (!node.imported || !node.isImage)
+		throw std::runtime_error("render graph resource " + node.name + " is not an imported image");
+
+	node.image = image;
+	node.view = view;
+	node.extent = extent;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+	for (Group& group : groups)
+	{
+		recordBarrier(commandBuffer, group.before);
+
+		if (!group.renderPass)
+		{
+			PassNode& pass = passes[group.passes[0]];
+			if (pass.execute)
+				pass.execute(commandBuffer);
+			continue;
+		}
+
+		group.framebuffer = getGroupFramebuffer(group);
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = group.handle;
+		renderPassInfo.framebuffer = group.framebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = resources[group.attachments[0]].extent;
+		renderPassInfo.clearValueCount = uint32_t(group.clearValues.size());
+		renderPassInfo.pClearValues = group.clearValues.data();
+
+		for (size_t i = 0; i < group.passes.size(); i++)
+		{
+			PassNode& pass = passes[group.passes[i]];
+			VkSubpassContents contents = pass.secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+
+			if (i == 0)
+				vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+			else
+				vkCmdNextSubpass(commandBuffer, contents);
+
+			if (pass.execute)
+				pass.execute(commandBuffer);
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	recordBarrier(commandBuffer, after);
+}
+
+VkRenderPass RenderGraph::getRenderPass(Pass pass) const
+{
+	return passes[pass].kept ? groups[passes[pass].group].handle : VK_NULL_HANDLE;
+}
+
+uint32_t RenderGraph::getSubpass(Pass pass) const
+{
+	return passes[pass].subpass;
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(Pass pass) const
+{
+	return passes[pass].kept ? groups[passes[pass].group].framebuffer : VK_NULL_HANDLE;
+}
+
+std::vector<VkFramebuffer> RenderGraph::releaseFramebuffers(VkImageView view)
+{
+	std::vector<VkFramebuffer> released;
+	uint64_t key = (uint64_t)view;
+
+	for (auto it = framebuffers.begin(); it != framebuffers.end();)
+	{
+		if (std::find(it->first.begin() + 1, it->first.end(), key) == it->first.end())
+		{
+			++it;
+			continue;
+		}
+
+		released.push_back(it->second);
+		it = framebuffers.erase(it);
+	}
+
+	return released;
+}
+
+bool RenderGraph::isWrite(const Access& access)
+{
+	switch (access.usage)
+	{
+	case Usage::ColorAttachment:
+	case Usage::DepthAttachment:
+	case Usage::StorageWrite:
+	case Usage::TransferWrite:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool RenderGraph::isRead(const Access& access)
+{
+	switch (access.usage)
+	{
+	case Usage::ColorAttachment:
+	case Usage::DepthAttachment:
+		return !access.clear;
+	case Usage::StorageWrite:
+	case Usage::TransferWrite:
+		return false;
+	default:
+		return true;
+	}
+}
+
+VkPipelineStageFlags RenderGraph::getStages(Usage usage, PassType type)
+{
+	switch (usage)
+	{
+	case Usage::ColorAttachment:
+		return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	case Usage::DepthAttachment:
+		return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	case Usage::Sampled:
+	case Usage::StorageRead:
+	case Usage::StorageWrite:
+		return type == PassType::Graphics ? VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT :
+			type == PassType::Compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	case Usage::IndirectRead:
+		return VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+	case Usage::VertexRead:
+		return VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+	case Usage::TransferRead:
+	case Usage::TransferWrite:
+		return VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+
+	return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+}
+
+VkAccessFlags RenderGraph::getReadAccess(Usage usage)
+{
+	switch (usage)
+	{
+	case Usage::ColorAttachment: return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+	case Usage::DepthAttachment: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+	case Usage::Sampled:
+	case Usage::StorageRead: return VK_ACCESS_SHADER_READ_BIT;
+	case Usage::IndirectRead: return VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	case Usage::VertexRead: return VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	case Usage::TransferRead: return VK_ACCESS_TRANSFER_READ_BIT;
+	default: return 0;
+	}
+}
+
+VkAccessFlags RenderGraph::getWriteAccess(Usage usage)
+{
+	switch (usage)
+	{
+	case Usage::ColorAttachment: return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	case Usage::DepthAttachment: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	case Usage::StorageWrite: return VK_ACCESS_SHADER_WRITE_BIT;
+	case Usage::TransferWrite: return VK_ACCESS_TRANSFER_WRITE_BIT;
+	default: return 0;
+	}
+}
+
+VkImageLayout RenderGraph::getLayout(Usage usage)
+{
+	switch (usage)
+	{
+	case Usage::ColorAttachment: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	case Usage::DepthAttachment: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	case Usage::Sampled: return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	case Usage::StorageRead:
+	case Usage::StorageWrite: return VK_IMAGE_LAYOUT_GENERAL;
+	case Usage::TransferRead: return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	case Usage::TransferWrite: return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	default: return VK_IMAGE_LAYOUT_GENERAL;
+	}
+}
+
+VkImageUsageFlags RenderGraph::getImageUsage(Usage usage)
+{
+	switch (usage)
+	{
+	case Usage::ColorAttachment: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case Usage::DepthAttachment: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case Usage::Sampled: return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case Usage::StorageRead:
+	case Usage::StorageWrite: return VK_IMAGE_USAGE_STORAGE_BIT;
+	case Usage::TransferRead: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	case Usage::TransferWrite: return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	default: return 0;
+	}
+}
+
+VkImageAspectFlags RenderGraph::getAspect(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+uint32_t RenderGraph::getFormatSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8_UNORM:
+		return 1;
+	case VK_FORMAT_R8G8_UNORM:
+	case VK_FORMAT_R16_SFLOAT:
+	case VK_FORMAT_D16_UNORM:
+		return 2;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R16G16B16A16_UNORM:
+	case VK_FORMAT_R32G32_SFLOAT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return 8;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return 16;
+	default:
+		// 8-bit RGBA, packed 10/11-bit, 32-bit single channel and 24/32-bit depth
+		return 4;
+	}
+}
+
+void RenderGraph::cullPasses()
+{
+	// walking backwards, a resource is needed when a kept pass further on reads it
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = passes.size(); i-- > 0;)
+	{
+		PassNode& pass = passes[i];
+		pass.kept = false;
+
+		for (const Access& access : pass.accesses)
+		{
+			if (isWrite(access) && (isPersistent(resources[access.resource]) || needed[access.resource]))
+				pass.kept = true;
+		}
+
+		if (!pass.kept)
+			continue;
+
+		// a full overwrite ends the need for whatever was there before
+		for (const Access& access : pass.accesses)
+		{
+			if (isWrite(access) && !isRead(access))
+				needed[access.resource] = false;
+		}
+
+		for (const Access& access : pass.accesses)
+		{
+			if (isRead(access))
+				needed[access.resource] = true;
+		}
+	}
+}
+
+VkExtent2D RenderGraph::getExtent(Pass pass) const
+{
+	for (const Access& access : passes[pass].accesses)
+	{
+		if (isAttachment(access.usage))
+			return resources[access.resource].extent;
+	}
+
+	throw std::runtime_error("render graph pass \"" + passes[pass].name + "\" has no attachments");
+}
+
+bool RenderGraph::canMerge(const Group& group, Pass pass) const
+{
+	VkExtent2D extent = getExtent(pass);
+	VkExtent2D groupExtent = getExtent(group.passes[0]);
+	if (extent.width != groupExtent.width || extent.height != groupExtent.height)
+		return false;
+
+	// only attachment to attachment hand-overs fit a subpass dependency; sampling what an
+	// earlier subpass rendered would need input attachments
+	for (const Access& access : passes[pass].accesses)
+	{
+		for (Pass member : group.passes)
+		{
+			for (const Access& other : passes[member].accesses)
+			{
+				if (other.resource == access.resource && (!isAttachment(access.usage) || other.usage != access.usage))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void RenderGraph::buildGroups()
+{
+	groups.clear();
+	order.clear();
+
+	for (Pass i = 0; i < passes.size(); i++)
+	{
+		PassNode& pass = passes[i];
+		if (!pass.kept)
+			continue;
+
+		pass.position = uint32_t(order.size());
+		order.push_back(i);
+
+		if (pass.type == PassType::Graphics && !groups.empty() && groups.back().renderPass && canMerge(groups.back(), i))
+		{
+			pass.group = uint32_t(groups.size() - 1);
+			pass.subpass = uint32_t(groups.back().passes.size());
+			groups.back().passes.push_back(i);
+			continue;
+		}
+
+		Group group;
+		group.passes.push_back(i);
+		group.renderPass = pass.type == PassType::Graphics;
+		if (group.renderPass)
+			getExtent(i);
+
+		pass.group = uint32_t(groups.size());
+		pass.subpass = 0;
+		groups.push_back(std::move(group));
+	}
+}
+
+void RenderGraph::computeLifetimes()
+{
+	for (ResourceNode& resource : resources)
+	{
+		resource.imageUsage = 0;
+		resource.firstUse = UINT32_MAX;
+		resource.lastUse = 0;
+		resource.lastStages = 0;
+		resource.lastWriteAccess = 0;
+	}
+
+	for (Pass index : order)
+	{
+		const PassNode& pass = passes[index];
+		const Group& group = groups[pass.group];
+		uint32_t first = group.renderPass ? passes[group.passes.front()].position : pass.position;
+		uint32_t last = group.renderPass ? passes[group.passes.back()].position : pass.position;
+
+		for (const Access& access : pass.accesses)
+		{
+			ResourceNode& resource = resources[access.resource];
+			resource.firstUse = std::min(resource.firstUse, first);
+			resource.lastUse = std::max(resource.lastUse, last);
+			resource.imageUsage |= getImageUsage(access.usage);
+
+			// reads since the last write all have to finish before the memory is reused
+			VkPipelineStageFlags stages = getStages(access.usage, pass.type);
+			if (isWrite(access))
+			{
+				resource.lastStages = stages;
+				resource.lastWriteAccess = getWriteAccess(access.usage);
+			}
+			else
+				resource.lastStages |= stages;
+		}
+	}
+}
+
+void RenderGraph::planAliasing()
+{
+	aliasSlots.clear();
+	stats.transientImages = 0;
+	stats.transientBytes = 0;
+	stats.aliasedBytes = 0;
+
+	std::vector<Resource> transients;
+	for (Resource i = 0; i < resources.size(); i++)
+	{
+		ResourceNode& resource = resources[i];
+		resource.aliasSlot = UINT32_MAX;
+		if (resource.imported || !resource.isImage || resource.firstUse == UINT32_MAX)
+			continue;
+
+		if (device == VK_NULL_HANDLE)
+		{
+			resource.size = VkDeviceSize(resource.extent.width) * resource.extent.height * getFormatSize(resource.format);
+			resource.alignment = 1;
+			resource.memoryTypeBits = ~0u;
+		}
+
+		transients.push_back(i);
+	}
+
+	// largest first, so that smaller images fill in behind the ones that set a slot's size
+	std::stable_sort(transients.begin(), transients.end(), [this](Resource a, Resource b) {
+		return resources[a].size > resources[b].size;
+	});
+
+	for (Resource index : transients)
+	{
+		ResourceNode& resource = resources[index];
+
+		for (uint32_t i = 0; i < aliasSlots.size() && resource.aliasSlot == UINT32_MAX; i++)
+		{
+			AliasSlot& slot = aliasSlots[i];
+			if (!(slot.memoryTypeBits & resource.memoryTypeBits))
+				continue;
+
+			bool overlaps = false;
+			for (Resource other : slot.resources)
+				overlaps |= resource.firstUse <= resources[other].lastUse && resources[other].firstUse <= resource.lastUse;
+
+			if (!overlaps)
+				resource.aliasSlot = i;
+		}
+
+		if (resource.aliasSlot == UINT32_MAX)
+		{
+			resource.aliasSlot = uint32_t(aliasSlots.size());
+			aliasSlots.emplace_back();
+		}
+
+		AliasSlot& slot = aliasSlots[resource.aliasSlot];
+		slot.resources.push_back(index);
+		slot.size = std::max(slot.size, resource.size);
+		slot.alignment = std::max(slot.alignment, resource.alignment);
+		slot.memoryTypeBits &= resource.memoryTypeBits;
+
+		stats.transientImages++;
+		stats.transientBytes += resource.size;
+	}
+
+	for (AliasSlot& slot : aliasSlots)
+	{
+		std::sort(slot.resources.begin(), slot.resources.end(), [this](Resource a, Resource b) {
+			return resources[a].firstUse < resources[b].firstUse;
+		});
+		stats.aliasedBytes += slot.size;
+	}
+}
+
+uint32_t RenderGraph::getAttachmentIndex(const Group& group, Resource resource) const
+{
+	for (uint32_t i = 0; i < group.attachments.size(); i++)
+	{
+		if (group.attachments[i] == resource)
+			return i;
+	}
+
+	return UINT32_MAX;
+}
+
+void RenderGraph::addDependency(Group& group, uint32_t srcSubpass, uint32_t dstSubpass, VkPipelineStageFlags srcStages,
+	VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+{
+	for (VkSubpassDependency& dependency : group.dependencies)
+	{
+		if (dependency.srcSubpass != srcSubpass || dependency.dstSubpass != dstSubpass)
+			continue;
+
+		dependency.srcStageMask |= srcStages;
+		dependency.srcAccessMask |= srcAccess;
+		dependency.dstStageMask |= dstStages;
+		dependency.dstAccessMask |= dstAccess;
+		return;
+	}
+
+	VkSubpassDependency dependency{};
+	dependency.srcSubpass = srcSubpass;
+	dependency.dstSubpass = dstSubpass;
+	dependency.srcStageMask = srcStages;
+	dependency.srcAccessMask = srcAccess;
+	dependency.dstStageMask = dstStages;
+	dependency.dstAccessMask = dstAccess;
+	// between subpasses every hazard is on attachments, which tilers resolve per tile
+	if (srcSubpass != VK_SUBPASS_EXTERNAL && dstSubpass != VK_SUBPASS_EXTERNAL)
+		dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+	group.dependencies.push_back(dependency);
+}
+
+void RenderGraph::computeSynchronization()
+{
+	after = Barrier();
+	for (Group& group : groups)
+	{
+		group.before = Barrier();
+		group.attachments.clear();
+		group.attachmentDescriptions.clear();
+		group.clearValues.clear();
+		group.dependencies.clear();
+	}
+
+	std::vector<State> states(resources.size());
+	for (Resource i = 0; i < resources.size(); i++)
+	{
+		const ResourceNode& resource = resources[i];
+		State& state = states[i];
+
+		if (resource.imported)
+		{
+			// whatever the caller did with the image before, which a write or a layout
+			// transition has to wait for; imported buffers arrive ready
+			state.layout = resource.initialLayout;
+			if (resource.isImage)
+				state.readStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		}
+		else if (resource.aliasSlot != UINT32_MAX)
+		{
+			// the memory's previous occupant, earlier in the frame or the last one of the
+			// previous frame, which may be the image itself
+			const std::vector<Resource>& occupants = aliasSlots[resource.aliasSlot].resources;
+			auto it = std::find(occupants.begin(), occupants.end(), i);
+			Resource previous = it == occupants.begin() ? occupants.back() : *(it - 1);
+			state.writeStages = resources[previous].lastStages;
+			state.writeAccess = resources[previous].lastWriteAccess;
+		}
+	}
+
+	for (Pass index : order)
+	{
+		const PassNode& pass = passes[index];
+		Group& group = groups[pass.group];
+
+		for (const Access& access : pass.accesses)
+		{
+			const ResourceNode& resource = resources[access.resource];
+			State& state = states[access.resource];
+
+			VkPipelineStageFlags stages = getStages(access.usage, pass.type);
+			VkAccessFlags accessMask = (isRead(access) ? getReadAccess(access.usage) : 0) | (isWrite(access) ? getWriteAccess(access.usage) : 0);
+			VkImageLayout layout = resource.isImage ? getLayout(access.usage) : VK_IMAGE_LAYOUT_UNDEFINED;
+			bool attachment = isAttachment(access.usage);
+			bool write = isWrite(access);
+			bool transition = resource.isImage && layout != state.layout;
+
+			if (attachment)
+			{
+				uint32_t attachmentIndex = getAttachmentIndex(group, access.resource);
+				if (attachmentIndex == UINT32_MAX)
+				{
+					VkAttachmentLoadOp loadOp = access.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR :
+						state.layout == VK_IMAGE_LAYOUT_UNDEFINED ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD;
+
+					VkAttachmentDescription description{};
+					description.format = resource.format;
+					description.samples = VK_SAMPLE_COUNT_1_BIT;
+					description.loadOp = loadOp;
+					description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+					description.stencilLoadOp = hasStencil(resource.format) ? loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					description.initialLayout = state.layout;
+					description.finalLayout = layout;
+
+					group.attachments.push_back(access.resource);
+					group.attachmentDescriptions.push_back(description);
+					group.clearValues.push_back(access.clearValue);
+				}
+				else
+					group.attachmentDescriptions[attachmentIndex].finalLayout = layout;
+			}
+
+			// read after read only needs the last write made visible to the new stages
+			VkPipelineStageFlags srcStages = 0;
+			VkAccessFlags srcAccess = 0;
+			bool needed = false;
+			if (write || transition)
+			{
+				srcStages = state.writeStages | state.readStages;
+				srcAccess = state.writeAccess;
+				needed = srcStages != 0 || transition;
+			}
+			else if (state.writeStages != 0 && ((stages & ~state.visibleStages) || (accessMask & ~state.visibleAccess)))
+			{
+				srcStages = state.writeStages;
+				srcAccess = state.writeAccess;
+				needed = true;
+			}
+
+			if (needed)
+			{
+				if (srcStages == 0)
+					srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+				const PassNode* source = state.pass != UINT32_MAX ? &passes[state.pass] : nullptr;
+				if (attachment)
+				{
+					// the render pass transitions attachments itself
+					uint32_t srcSubpass = source && source->group == pass.group ? source->subpass : VK_SUBPASS_EXTERNAL;
+					addDependency(group, srcSubpass, pass.subpass, srcStages, srcAccess, stages, accessMask);
+				}
+				else if (source && state.attachment)
+				{
+					// the render pass that rendered the image hands it over in the new layout
+					Group& sourceGroup = groups[source->group];
+					sourceGroup.attachmentDescriptions[getAttachmentIndex(sourceGroup, access.resource)].finalLayout = layout;
+					addDependency(sourceGroup, source->subpass, VK_SUBPASS_EXTERNAL, srcStages, srcAccess, stages, accessMask);
+				}
+				else
+				{
+					Barrier& barrier = group.before;
+					barrier.srcStages |= srcStages;
+					barrier.dstStages |= stages;
+
+					if (transition)
+					{
+						VkImageMemoryBarrier imageBarrier{};
+						imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+						imageBarrier.srcAccessMask = srcAccess;
+						imageBarrier.dstAccessMask = accessMask;
+						imageBarrier.oldLayout = state.layout;
+						imageBarrier.newLayout = layout;
+						imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						imageBarrier.subresourceRange = { getAspect(resource.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+						barrier.imageBarriers.push_back(imageBarrier);
+						barrier.imageResources.push_back(access.resource);
+					}
+					else
+					{
+						barrier.srcAccess |= srcAccess;
+						barrier.dstAccess |= accessMask;
+					}
+				}
+			}
+
+			if (write || transition)
+			{
+				// a transition is a write as well, later accesses wait for its stages
+				state.writeStages = stages;
+				state.writeAccess = write ? getWriteAccess(access.usage) : 0;
+				state.readStages = 0;
+				state.visibleStages = stages;
+				state.visibleAccess = accessMask;
+			}
+			else
+			{
+				state.readStages |= stages;
+				if (needed)
+				{
+					state.visibleStages |= stages;
+					state.visibleAccess |= accessMask;
+				}
+			}
+
+			state.layout = resource.isImage ? layout : state.layout;
+			state.pass = index;
+			state.attachment = attachment;
+		}
+	}
+
+	// imported images are left in their final layout for whatever the caller does next
+	for (Resource i = 0; i < resources.size(); i++)
+	{
+		const ResourceNode& resource = resources[i];
+		const State& state = states[i];
+		if (!resource.imported || !resource.isImage || resource.firstUse == UINT32_MAX)
+			continue;
+
+		if (resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.finalLayout == state.layout)
+			continue;
+
+		VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+		const PassNode& source = passes[state.pass];
+		if (state.attachment)
+		{
+			Group& sourceGroup = groups[source.group];
+			sourceGroup.attachmentDescriptions[getAttachmentIndex(sourceGroup, i)].finalLayout = resource.finalLayout;
+			addDependency(sourceGroup, source.subpass, VK_SUBPASS_EXTERNAL, srcStages, state.writeAccess,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+			continue;
+		}
+
+		VkImageMemoryBarrier imageBarrier{};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = state.writeAccess;
+		imageBarrier.oldLayout = state.layout;
+		imageBarrier.newLayout = resource.finalLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.subresourceRange = { getAspect(resource.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+		after.srcStages |= srcStages;
+		after.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		after.imageBarriers.push_back(imageBarrier);
+		after.imageResources.push_back(i);
+	}
+
+	// attachments nothing reads after their render pass are never written back
+	stats.barriers = after.srcStages != 0 ? 1 : 0;
+	stats.subpassDependencies = 0;
+	for (Group& group : groups)
+	{
+		stats.barriers += group.before.srcStages != 0 ? 1 : 0;
+		stats.subpassDependencies += uint32_t(group.dependencies.size());
+
+		uint32_t end = passes[group.passes.back()].position;
+		for (uint32_t i = 0; i < group.attachments.size(); i++)
+		{
+			const ResourceNode& resource = resources[group.attachments[i]];
+			VkAttachmentStoreOp storeOp = isPersistent(resource) || resource.lastUse > end ?
+				VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			group.attachmentDescriptions[i].storeOp = storeOp;
+			if (hasStencil(resource.format))
+				group.attachmentDescriptions[i].stencilStoreOp = storeOp;
+		}
+	}
+}
+
+void RenderGraph::createRenderPass(Group& group)
+{
+	size_t subpassCount = group.passes.size();
+	std::vector<std::vector<VkAttachmentReference>> colorReferences(subpassCount);
+	std::vector<VkAttachmentReference> depthReferences(subpassCount, { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+	std::vector<VkSubpassDescription> subpasses(subpassCount);
+
+	for (size_t i = 0; i < subpassCount; i++)
+	{
+		for (const Access& access : passes[group.passes[i]].accesses)
+		{
+			if (!isAttachment(access.usage))
+				continue;
+
+			VkAttachmentReference reference = { getAttachmentIndex(group, access.resource), getLayout(access.usage) };
+			if (access.usage == Usage::ColorAttachment)
+				colorReferences[i].push_back(reference);
+			else
+				depthReferences[i] = reference;
+		}
+
+		subpasses[i].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[i].colorAttachmentCount = uint32_t(colorReferences[i].size());
+		subpasses[i].pColorAttachments = colorReferences[i].data();
+		if (depthReferences[i].attachment != VK_ATTACHMENT_UNUSED)
+			subpasses[i].pDepthStencilAttachment = &depthReferences[i];
+	}
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = uint32_t(group.attachmentDescriptions.size());
+	renderPassInfo.pAttachments = group.attachmentDescriptions.data();
+	renderPassInfo.subpassCount = uint32_t(subpasses.size());
+	renderPassInfo.pSubpasses = subpasses.data();
+	renderPassInfo.dependencyCount = uint32_t(group.dependencies.size());
+	renderPassInfo.pDependencies = group.dependencies.data();
+
+	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &group.handle) != VK_SUCCESS)
+		throw std::runtime_error("cannot create render graph render pass for " + passes[group.passes[0]].name);
+}
+
+VkFramebuffer RenderGraph::getGroupFramebuffer(Group& group)
+{
+	std::vector<uint64_t> key;
+	key.push_back((uint64_t)group.handle);
+	for (Resource resource : group.attachments)
+		key.push_back((uint64_t)resources[resource].view);
+
+	auto it = framebuffers.find(key);
+	if (it != framebuffers.end())
+		return it->second;
+
+	std::vector<VkImageView> views;
+	for (Resource resource : group.attachments)
+		views.push_back(resources[resource].view);
+
+	VkExtent2D extent = resources[group.attachments[0]].extent;
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = group.handle;
+	framebufferInfo.attachmentCount = uint32_t(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = extent.width;
+	framebufferInfo.height = extent.height;
+	framebufferInfo.layers = 1;
+
+	VkFramebuffer framebuffer;
+	if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+		throw std::runtime_error("cannot create render graph framebuffer");
+
+	framebuffers[key] = framebuffer;
+	return framebuffer;
+}
+
+void RenderGraph::recordBarrier(VkCommandBuffer commandBuffer, Barrier& barrier)
+{
+	if (barrier.srcStages == 0)
+		return;
+
+	for (size_t i = 0; i < barrier.imageBarriers.size(); i++)
+		barrier.imageBarriers[i].image = resources[barrier.imageResources[i]].image;
+
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = barrier.srcAccess;
+	memoryBarrier.dstAccessMask = barrier.dstAccess;
+	uint32_t memoryBarrierCount = barrier.srcAccess != 0 || barrier.dstAccess != 0 ? 1 : 0;
+
+	vkCmdPipelineBarrier(commandBuffer, barrier.srcStages, barrier.dstStages, 0, memoryBarrierCount, &memoryBarrier,
+		0, nullptr, uint32_t(barrier.imageBarriers.size()), barrier.imageBarriers.data());
+}
+
+void RenderGraph::dumpBarrier(std::ostream& out, const Barrier& barrier) const
+{
+	if (barrier.srcStages == 0)
+		return;
+
+	out << "    barrier " << getStageNames(barrier.srcStages) << " -> " << getStageNames(barrier.dstStages) << "\n";
+	for (size_t i = 0; i < barrier.imageBarriers.size(); i++)
+	{
+		const VkImageMemoryBarrier& imageBarrier = barrier.imageBarriers[i];
+		out << "      \"" << resources[barrier.imageResources[i]].name << "\" " << getLayoutName(imageBarrier.oldLayout)
+			<< " -> " << getLayoutName(imageBarrier.newLayout) << "\n";
+	}
+}
+
+void RenderGraph::dump(std::ostream& out) const
+{
+	out << "render graph: " << stats.passes << " passes, " << stats.culledPasses << " culled, "
+		<< stats.renderPasses << " render passes with " << stats.mergedSubpasses << " merged subpasses, "
+		<< stats.barriers << " barriers, " << stats.subpassDependencies << " subpass dependencies\n";
+	out << "transient images: " << stats.transientImages << ", " << formatBytes(stats.transientBytes) << " unaliased, "
+		<< formatBytes(stats.aliasedBytes) << " aliased, " << formatBytes(stats.transientBytes - stats.aliasedBytes)
+		<< " saved" << (device == VK_NULL_HANDLE ? " (estimated)" : "") << "\n";
+
+	for (size_t g = 0; g < groups.size(); g++)
+	{
+		const Group& group = groups[g];
+		if (group.renderPass)
+		{
+			VkExtent2D extent = resources[group.attachments[0]].extent;
+			out << "[" << g << "] render pass " << extent.width << "x" << extent.height << "\n";
+		}
+		else
+			out << "[" << g << "] " << (passes[group.passes[0]].type == PassType::Compute ? "compute" : "transfer") << "\n";
+
+		dumpBarrier(out, group.before);
+
+		for (size_t i = 0; i < group.attachments.size(); i++)
+		{
+			const VkAttachmentDescription& description = group.attachmentDescriptions[i];
+			const char* load = description.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR ? "clear" :
+				description.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? "load" : "discard";
+			const char* store = description.storeOp == VK_ATTACHMENT_STORE_OP_STORE ? "store" : "discard";
+			out << "    attachment \"" << resources[group.attachments[i]].name << "\" " << load << "/" << store << ", "
+				<< getLayoutName(description.initialLayout) << " -> " << getLayoutName(description.finalLayout) << "\n";
+		}
+
+		for (Pass index : group.passes)
+		{
+			const PassNode& pass = passes[index];
+			out << "    " << (group.renderPass ? "subpass " + std::to_string(pass.subpass) + " " : "") << "\"" << pass.name << "\":";
+			for (const Access& access : pass.accesses)
+				out << " " << resources[access.resource].name << " (" << getUsageName(access.usage) << ")";
+			out << "\n";
+		}
+
+		for (const VkSubpassDependency& dependency : group.dependencies)
+		{
+			out << "    dependency ";
+			if (dependency.srcSubpass == VK_SUBPASS_EXTERNAL)
+				out << "external";
+			else
+				out << dependency.srcSubpass;
+			out << " -> ";
+			if (dependency.dstSubpass == VK_SUBPASS_EXTERNAL)
+				out << "external";
+			else
+				out << dependency.dstSubpass;
+			out << ": " << getStageNames(dependency.srcStageMask) << " -> " << getStageNames(dependency.dstStageMask) << "\n";
+		}
+	}
+
+	dumpBarrier(out, after);
+
+	for (const PassNode& pass : passes)
+	{
+		if (!pass.kept)
+			out << "culled \"" << pass.name << "\"\n";
+	}
+
+	for (size_t i = 0; i < aliasSlots.size(); i++)
+	{
+		const AliasSlot& slot = aliasSlots[i];
+		out << "memory " << i << ", " << formatBytes(slot.size) << ":";
+		for (Resource index : slot.resources)
+		{
+			const ResourceNode& resource = resources[index];
+			out << " \"" << resource.name << "\" [" << resource.firstUse << ", " << resource.lastUse << "]";
+		}
+		out << "\n";
+	}
+}
\ No newline at end of file
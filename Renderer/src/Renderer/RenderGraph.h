@@ -0,0 +1,251 @@
+#pragma once
+#include "MemoryAllocator.h"
+#include <vector>
+#include <string>
+#include <functional>
+#include <map>
+#include <ostream>
+
+// A frame described as passes that declare how they use images and buffers. compile()
+// derives everything a hand-written frame spells out:
+//  - passes whose results nobody consumes are culled; writes to imported resources
+//    always count as consumed, except for scratch images
+//  - consecutive graphics passes of one extent that only hand attachments to each
+//    other become subpasses of one VkRenderPass
+//  - hazards between passes become subpass dependencies for attachments and one batched
+//    vkCmdPipelineBarrier per pass for everything else; read after read needs neither
+//  - transient images whose lifetimes do not overlap share memory
+//
+// Passes run in the order they were added. The structure is built once and compiled
+// again only when it changes (resize); per frame the caller binds the imported
+// resources and calls execute(). Buffers are synchronized with global memory barriers,
+// so the graph never needs their handles.
+class RenderGraph
+{
+public:
+	enum class PassType
+	{
+		Graphics,
+		Compute,
+		Transfer,
+	};
+
+	enum class Usage
+	{
+		ColorAttachment,
+		DepthAttachment,
+		// sampled or input in shaders of any stage the pass runs
+		Sampled,
+		StorageRead,
+		StorageWrite,
+		IndirectRead,
+		VertexRead,
+		TransferRead,
+		TransferWrite,
+	};
+
+	typedef uint32_t Resource;
+	typedef uint32_t Pass;
+	typedef std::function<void(VkCommandBuffer)> ExecuteFunction;
+
+	struct Stats
+	{
+		uint32_t passes = 0;
+		uint32_t culledPasses = 0;
+		uint32_t renderPasses = 0;
+		uint32_t mergedSubpasses = 0;
+		uint32_t barriers = 0;
+		uint32_t subpassDependencies = 0;
+		uint32_t transientImages = 0;
+		// transient memory without and with aliasing; estimated from the formats until
+		// realize() replaces the figures with the device's requirements
+		VkDeviceSize transientBytes = 0;
+		VkDeviceSize aliasedBytes = 0;
+	};
+
+	// owned by the graph, contents do not survive the frame
+	Resource createImage(const std::string& name, VkFormat format, VkExtent2D extent);
+	// owned by the caller, who binds it every frame; it arrives in initialLayout and is
+	// left in finalLayout. UNDEFINED initially discards the previous contents, finally it
+	// makes the image scratch memory whose contents are dropped like a transient's
+	Resource importImage(const std::string& name, VkFormat format, VkExtent2D extent,
+		VkImageLayout initialLayout, VkImageLayout finalLayout);
+	Resource importBuffer(const std::string& name);
+
+	// secondaryContents records the pass with vkCmdExecuteCommands, graphics passes only
+	Pass addPass(const std::string& name, PassType type, ExecuteFunction execute, bool secondaryContents = false);
+	// attachments without a clear value are loaded, which makes them a read as well
+	void use(Pass pass, Resource resource, Usage usage);
+	void useAttachment(Pass pass, Resource resource, Usage usage, const VkClearValue& clear);
+
+	// CPU side only: culling, merging, barriers and the aliasing plan
+	void compile();
+	// creates the render passes, transient images and their aliased memory
+	void realize(VkDevice device, MemoryAllocator& allocator);
+	// drops the compiled state and every Vulkan object; the declared graph stays
+	void destroy();
+	// clears the declared graph as well, ready to be built again
+	void reset();
+
+	// imported images only; the extent may change as long as merged passes keep matching
+	void setImage(Resource resource, VkImage image, VkImageView view, VkExtent2D extent);
+	// switches a graphics pass between inline and secondary command buffers per frame
+	void setSecondaryContents(Pass pass, bool secondaryContents) { passes[pass].secondaryContents = secondaryContents; }
+	void execute(VkCommandBuffer commandBuffer);
+
+	VkRenderPass getRenderPass(Pass pass) const;
+	uint32_t getSubpass(Pass pass) const;
+	// the framebuffer execute() used for the pass this frame, valid while it records
+	VkFramebuffer getFramebuffer(Pass pass) const;
+	bool isCulled(Pass pass) const { return !passes[pass].kept; }
+	// framebuffers built against the view; the caller destroys them once unused
+	std::vector<VkFramebuffer> releaseFramebuffers(VkImageView view);
+
+	const Stats& getStats() const { return stats; }
+	void dump(std::ostream& out) const;
+
+private:
+	struct Access
+	{
+		Resource resource;
+		Usage usage;
+		bool clear;
+		VkClearValue clearValue;
+	};
+
+	struct PassNode
+	{
+		std::string name;
+		PassType type;
+		ExecuteFunction execute;
+		bool secondaryContents;
+		std::vector<Access> accesses;
+
+		bool kept = false;
+		// index in kept pass order
+		uint32_t position = 0;
+		uint32_t group = 0;
+		uint32_t subpass = 0;
+	};
+
+	struct ResourceNode
+	{
+		std::string name;
+		bool isImage;
+		bool imported;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = {};
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		// derived by compile(): lifetime in kept pass order, widened to whole render
+		// passes so attachments of one render pass never alias, and the last use
+		VkImageUsageFlags imageUsage = 0;
+		uint32_t firstUse = UINT32_MAX;
+		uint32_t lastUse = 0;
+		VkPipelineStageFlags lastStages = 0;
+		VkAccessFlags lastWriteAccess = 0;
+		uint32_t aliasSlot = UINT32_MAX;
+		VkDeviceSize size = 0;
+		VkDeviceSize alignment = 1;
+		uint32_t memoryTypeBits = ~0u;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+	};
+
+	// one vkCmdPipelineBarrier; image barriers get their image when executed
+	struct Barrier
+	{
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		VkAccessFlags srcAccess = 0;
+		VkAccessFlags dstAccess = 0;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+		std::vector<Resource> imageResources;
+	};
+
+	// consecutive kept passes recorded in one render pass, or a single other pass
+	struct Group
+	{
+		std::vector<Pass> passes;
+		bool renderPass = false;
+		Barrier before;
+		std::vector<Resource> attachments;
+		std::vector<VkAttachmentDescription> attachmentDescriptions;
+		std::vector<VkClearValue> clearValues;
+		std::vector<VkSubpassDependency> dependencies;
+
+		VkRenderPass handle = VK_NULL_HANDLE;
+		VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	};
+
+	struct AliasSlot
+	{
+		std::vector<Resource> resources;
+		VkDeviceSize size = 0;
+		VkDeviceSize alignment = 1;
+		uint32_t memoryTypeBits = ~0u;
+		Allocation* allocation = nullptr;
+	};
+
+	// what a resource was last used for, the source scope of the next hazard
+	struct State
+	{
+		VkPipelineStageFlags writeStages = 0;
+		VkAccessFlags writeAccess = 0;
+		VkPipelineStageFlags readStages = 0;
+		// reads the last write was made visible to
+		VkPipelineStageFlags visibleStages = 0;
+		VkAccessFlags visibleAccess = 0;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// last pass of this frame, UINT32_MAX for what happened before the frame
+		uint32_t pass = UINT32_MAX;
+		bool attachment = false;
+	};
+
+	static bool isAttachment(Usage usage) { return usage == Usage::ColorAttachment || usage == Usage::DepthAttachment; }
+	// contents the caller sees after the frame
+	static bool isPersistent(const ResourceNode& resource)
+	{
+		return resource.imported && (!resource.isImage || resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED);
+	}
+	static bool isWrite(const Access& access);
+	static bool isRead(const Access& access);
+	static VkPipelineStageFlags getStages(Usage usage, PassType type);
+	static VkAccessFlags getReadAccess(Usage usage);
+	static VkAccessFlags getWriteAccess(Usage usage);
+	static VkImageLayout getLayout(Usage usage);
+	static VkImageUsageFlags getImageUsage(Usage usage);
+	static VkImageAspectFlags getAspect(VkFormat format);
+	static uint32_t getFormatSize(VkFormat format);
+
+	void cullPasses();
+	void buildGroups();
+	bool canMerge(const Group& group, Pass pass) const;
+	VkExtent2D getExtent(Pass pass) const;
+	void computeLifetimes();
+	void planAliasing();
+	void computeSynchronization();
+	void addDependency(Group& group, uint32_t srcSubpass, uint32_t dstSubpass, VkPipelineStageFlags srcStages,
+		VkAccessFlags srcAccess, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess);
+	uint32_t getAttachmentIndex(const Group& group, Resource resource) const;
+	void createRenderPass(Group& group);
+	VkFramebuffer getGroupFramebuffer(Group& group);
+	void recordBarrier(VkCommandBuffer commandBuffer, Barrier& barrier);
+	void dumpBarrier(std::ostream& out, const Barrier& barrier) const;
+
+private:
+	std::vector<PassNode> passes;
+	std::vector<ResourceNode> resources;
+	std::vector<Group> groups;
+	std::vector<AliasSlot> aliasSlots;
+	std::vector<Pass> order;
+	Barrier after;
+	Stats stats;
+
+	VkDevice device = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+	// keyed by render pass and attachment views
+	std::map<std::vector<uint64_t>, VkFramebuffer> framebuffers;
+};
\ No newline at end of file
@@ -1,10 +1,18 @@
 #include "Renderer.h"
+#include "core/JobSystem.h"
+#include <filesystem>
 #include <stdexcept>
 #include <iostream>
 #include <set>
 #include <cstdint>
 #include <algorithm>
 #include <fstream>
+#include <cstring>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <sstream>
+#include <thread>
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugMessage(
 	VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -16,6 +24,20 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugMessage(
 	return VK_FALSE;
 }
 
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// sleep_until can overshoot by a scheduler tick, so the last stretch is spun
+static void sleepUntil(std::chrono::steady_clock::time_point deadline)
+{
+	const auto spinTime = std::chrono::milliseconds(2);
+	if (deadline - std::chrono::steady_clock::now() > spinTime)
+		std::this_thread::sleep_until(deadline - spinTime);
+	while (std::chrono::steady_clock::now() < deadline)
+		std::this_thread::yield();
+}
 
 
 void Renderer::init(GLFWwindow* windowPointer)
@@ -26,48 +48,184 @@ void Renderer::init(GLFWwindow* windowPointer)
 	createSurface(windowPointer);
 	pickPhysicalDevice();
 	createLogicalDevice();
+	memoryAllocator.init(physicalDevice, device);
+	deletionQueue.init(device, memoryAllocator);
+	layoutCache.init(device);
+	uploadManager.init(device, memoryAllocator, queueFamilies.transferFamily.value_or(queueFamilies.graphicsFamily.value()), transferQueue,
+		timelineSemaphoreSupported);
+	frameAllocator.create(memoryAllocator, frameMemorySize, maxFramesInFlight, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, uniformRange);
+	createUniformSet();
+	createBindlessDescriptors();
+	pipelineCache.create(device, physicalDevice, pipelineCachePath);
 	createSwapChain();
-	createRenderPass();
-	createFramebuffers();
+	createDepthTarget();
+	createCullers();
+	createFrameGraph();
+	createGraphicsPipeline();
+	createCommandPools();
+	createRecordingPools();
+	createQueryPool();
+	createStatisticsQueryPool();
+	createCommandBuffers();
+	createSyncObjects();
+}
+
+void Renderer::initHeadless(uint32_t width, uint32_t height)
+{
+	headless = true;
+	window = nullptr;
+	createInstance();
+	setupDebugOutput();
+	pickPhysicalDevice();
+	createLogicalDevice();
+	memoryAllocator.init(physicalDevice, device);
+	deletionQueue.init(device, memoryAllocator);
+	layoutCache.init(device);
+	uploadManager.init(device, memoryAllocator, queueFamilies.transferFamily.value_or(queueFamilies.graphicsFamily.value()), transferQueue,
+		timelineSemaphoreSupported);
+	frameAllocator.create(memoryAllocator, frameMemorySize, maxFramesInFlight, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, uniformRange);
+	createUniformSet();
+	createBindlessDescriptors();
+	pipelineCache.create(device, physicalDevice, pipelineCachePath);
+	createOffscreenTargets(width, height);
+	createDepthTarget();
+	createCullers();
+	createFrameGraph();
 	createGraphicsPipeline();
-	createCommandPool();
+	createCommandPools();
+	createRecordingPools();
+	createQueryPool();
+	createStatisticsQueryPool();
 	createCommandBuffers();
 	createSyncObjects();
 }
 
 void Renderer::draw()
 {
-	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	FrameTimings timings;
+
+	auto start = std::chrono::steady_clock::now();
+	waitForFrames(maxFramesInFlight - 1);
+	timings.fenceWait = millisecondsSince(start);
+
+	// the previous submission of this frame slot is complete, so its queries are too
+	if (frameNumber >= maxFramesInFlight)
+	{
+		timings.gpuValid = readGpuTimestamps(currentFrame, timings.gpu);
+		timings.overdrawValid = readOverdraw(currentFrame, timings.overdraw);
+	}
+
+	CullingStats cullingStats;
+	if (gpuCullingSupported && frameNumber >= maxFramesInFlight && gpuCuller.readStats(currentFrame, cullingStats))
+	{
+		timings.visibleObjects = cullingStats.visible;
+		timings.culledObjects = cullingStats.objects - cullingStats.visible;
+		timings.cullingValid = true;
+	}
+
+	deletionQueue.collect(frameTimeline.getCompletedValue());
+
+	// a minimized window has nothing to render to, try again next frame
+	if (!headless && swapChainOutdated && !recreateSwapChain())
+	{
+		clearDrawList();
+		return;
+	}
 
 	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX,
-		imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	VkResult result = VK_SUCCESS;
+	start = std::chrono::steady_clock::now();
+	if (headless)
+	{
+		imageIndex = offscreenImageIndex;
+		offscreenImageIndex = (offscreenImageIndex + 1) % offscreenImageCount;
+	}
+	else
+		result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX,
+			imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	timings.acquire = millisecondsSince(start);
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		swapChainOutdated = true;
+		clearDrawList();
+		return;
+	}
+	else if (result == VK_SUBOPTIMAL_KHR)
+		swapChainOutdated = true;
+	else if (result != VK_SUCCESS)
+		throw std::runtime_error("cannot acquire swapchain image");
+
+	if (!frameTimeline.isComplete(imageLastUse[imageIndex]))
+	{
+		start = std::chrono::steady_clock::now();
+		frameTimeline.wait(imageLastUse[imageIndex]);
+		timings.fenceWait += millisecondsSince(start);
+	}
 
-	if (imagesInFlight[imageIndex] != VK_NULL_HANDLE)
-		vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+	imageLastUse[imageIndex] = frameNumber + 1;
 
-	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+	start = std::chrono::steady_clock::now();
+	// keeps the pool's memory, so steady-state recording does not allocate
+	vkResetCommandPool(device, commandPools[currentFrame], 0);
+	resetRecordingPools();
+	recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+	timings.record = millisecondsSince(start);
+	timings.drawCount = drawList.size();
+	if (cpuCullingStats.objects != 0)
+	{
+		timings.visibleObjects = cpuCullingStats.visible;
+		timings.culledObjects = cpuCullingStats.objects - cpuCullingStats.visible;
+		timings.occludedObjects = cpuCullingStats.occluded;
+		timings.cullingValid = true;
+		timings.culling = cpuCullingTime;
+	}
+	clearDrawList();
 
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	submitWaitSemaphores.clear();
+	if (!headless)
+		submitWaitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+	uploadManager.flush(submitWaitSemaphores);
+	frameAllocator.flush();
+
+	// the image is only needed for colour output, uploads from vertex input on
+	submitWaitStages.assign(submitWaitSemaphores.size(), VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	if (!headless)
+		submitWaitStages[0] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+	submitInfo.waitSemaphoreCount = submitWaitSemaphores.size();
+	submitInfo.pWaitSemaphores = submitWaitSemaphores.data();
+	submitInfo.pWaitDstStageMask = submitWaitStages.data();
 
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
 	VkSemaphore signalSemaphores[] = { renderingFinishedSemaphores[currentFrame] };
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
-	vkResetFences(device, 1, &inFlightFences[currentFrame]);
-
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+	start = std::chrono::steady_clock::now();
+	if (frameTimeline.submit(graphicsQueue, submitInfo) != VK_SUCCESS)
 		throw std::runtime_error("failed to submit draw command buffer!");
+	timings.submit = millisecondsSince(start);
+	if (pendingInputTime)
+		frameInputs.emplace_back(frameTimeline.getSubmittedValue(), *pendingInputTime);
+	pendingInputTime.reset();
+	frameNumber++;
+
+	if (shaderHotReload)
+		updateShaderReload();
+
+	if (headless)
+	{
+		endFrame(timings);
+		return;
+	}
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -80,45 +238,163 @@ void Renderer::draw()
 	presentInfo.pSwapchains = swapChains;
 	presentInfo.pImageIndices = &imageIndex;
 
+	start = std::chrono::steady_clock::now();
 	result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	timings.present = millisecondsSince(start);
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		swapChainOutdated = true;
+	else if (result != VK_SUCCESS)
+		throw std::runtime_error("cannot present swapchain image");
 
+	endFrame(timings);
+}
+
+void Renderer::endFrame(FrameTimings& timings)
+{
 	currentFrame = (currentFrame + 1) % maxFramesInFlight;
 
+	// Waiting for the frame limit here rather than at the start of the next draw() keeps
+	// the wait between the caller's input sampling and the frame out of the latency.
+	auto start = std::chrono::steady_clock::now();
+	waitForFrames(framesInFlight - 1);
+	resolveInputLatency(timings);
+
+	if (targetFrameTime > 0.0)
+	{
+		auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double, std::milli>(targetFrameTime));
+		auto now = std::chrono::steady_clock::now();
+		// a frame that overran by a whole period starts the schedule over instead of
+		// rushing the next frames to catch up
+		if (now > nextFrameTime + period)
+			nextFrameTime = now;
+		else
+			sleepUntil(nextFrameTime);
+		nextFrameTime += period;
+	}
+	timings.pacing = millisecondsSince(start);
+
+	lastFrameTimings = timings;
+}
+
+void Renderer::resolveInputLatency(FrameTimings& timings)
+{
+	auto now = std::chrono::steady_clock::now();
+	uint64_t completed = frameTimeline.getCompletedValue();
+	while (!frameInputs.empty() && frameInputs.front().first <= completed)
+	{
+		// later frames overwrite earlier ones, the latest is reported
+		timings.inputLatency = std::chrono::duration<double, std::milli>(now - frameInputs.front().second).count();
+		timings.inputLatencyValid = true;
+		frameInputs.pop_front();
+	}
+}
+
+void Renderer::waitForFrames(uint32_t framesAhead)
+{
+	if (frameNumber > framesAhead)
+		frameTimeline.wait(frameNumber - framesAhead);
+}
+
+void Renderer::setLatencyMode(LatencyMode mode)
+{
+	latencyMode = mode;
+	switch (mode)
+	{
+	case LatencyMode::LowLatency:
+		framesInFlight = 1;
+		break;
+	case LatencyMode::Balanced:
+		framesInFlight = 2;
+		break;
+	case LatencyMode::Throughput:
+		framesInFlight = maxFramesInFlight;
+		break;
+	}
+
+	// the frame limit holds from the end of the next draw(), the swapchain is recreated
+	// before the frame after
+	if (swapChain != VK_NULL_HANDLE)
+		swapChainOutdated = true;
 }
 
 void Renderer::shutdown()
 {
 	vkDeviceWaitIdle(device);
 
+	deletionQueue.destroy();
+	uploadManager.destroy();
+	if (gpuCullingSupported)
+		gpuCuller.destroy();
+	frameAllocator.destroy();
+	vkDestroyDescriptorPool(device, uniformPool, nullptr);
+	bindlessDescriptors.destroy();
+	vkDestroySampler(device, defaultSampler, nullptr);
+	vkDestroyImageView(device, defaultTextureView, nullptr);
+	memoryAllocator.destroyImage(defaultTexture);
+	memoryAllocator.destroyBuffer(defaultBuffer);
+
 	
 	
 	for (size_t i = 0; i < maxFramesInFlight; i++)
 	{
 		vkDestroySemaphore(device, renderingFinishedSemaphores[i], nullptr);
 		vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-		vkDestroyFence(device, inFlightFences[i], nullptr);
+	}
+	frameTimeline.destroy();
+
+	for (auto pool : commandPools)
+		vkDestroyCommandPool(device, pool, nullptr);
+
+	for (const auto& framePools : recordingPools)
+	{
+		for (const auto& recordingPool : framePools)
+			vkDestroyCommandPool(device, recordingPool.pool, nullptr);
 	}
 
-	vkDestroyCommandPool(device, commandPool, nullptr);
+	if (timestampQueryPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	if (statisticsQueryPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(device, statisticsQueryPool, nullptr);
 
-	for (auto framebuffer : swapChainFramebuffers)
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	// compile jobs end in reload(), which must not outlive the compiler
+	for (auto& job : shaderJobs)
+	{
+		if (job.compile.valid())
+			job.compile.wait();
+		job.pending = false;
+	}
+	shaderWatcher.destroy();
+	pipelineCompiler.destroy();
+	pipelineCache.save();
+	pipelineCache.destroy();
+	layoutCache.destroy();
+	frameGraph.reset();
 
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
+	vkDestroyImageView(device, depthImageView, nullptr);
+	memoryAllocator.destroyImage(depthImage);
 
 	for (size_t i = 0; i < swapChainImages.size(); i++)
 	{
 		vkDestroyImageView(device, swapChainImageViews[i], nullptr);
 	}
 
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
+	if (headless)
+	{
+		for (size_t i = 0; i < offscreenImages.size(); i++)
+			memoryAllocator.destroyImage(offscreenImages[i]);
+	}
+	else
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
+
+	memoryAllocator.destroy();
 
 	if (validationLayersEnabled)
 		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (!headless)
+		vkDestroySurfaceKHR(instance, surface, nullptr);
 	vkDestroyDevice(device, nullptr);
 	vkDestroyInstance(instance, nullptr);
 }
@@ -129,7 +405,14 @@ void Renderer::createInstance()
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	// 1.0 loaders lack vkEnumerateInstanceVersion; descriptor indexing needs 1.2
+	uint32_t loaderVersion = VK_API_VERSION_1_0;
+	auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+		vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+	if (enumerateInstanceVersion)
+		enumerateInstanceVersion(&loaderVersion);
+	apiVersion = loaderVersion >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+	appInfo.apiVersion = apiVersion;
 	appInfo.pApplicationName = "Vulkan renderer";
 	appInfo.pEngineName = "Vortex Engine";
 
@@ -137,10 +420,14 @@ void Renderer::createInstance()
 	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceInfo.pApplicationInfo = &appInfo;
 
-	uint32_t extensionCount = 0;
-	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
+	std::vector<const char*> extensions;
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + extensionCount);
+	if (!headless)
+	{
+		uint32_t extensionCount = 0;
+		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + extensionCount);
+	}
 
 
 	
@@ -169,7 +456,7 @@ void Renderer::createInstance()
 	if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS)
 		throw std::runtime_error("cannot create instance");
 
-	std::cout << "INSTANCE CREATED!" << std::endl;
+	std::cout << "INSTANCE CREATED! (Vulkan " << VK_VERSION_MAJOR(apiVersion) << "." << VK_VERSION_MINOR(apiVersion) << ")" << std::endl;
 }
 
 void Renderer::createSurface(GLFWwindow* window)
@@ -220,13 +507,33 @@ void Renderer::pickPhysicalDevice()
 	{
 		if (checkDeviceRequirements(device))
 		{
-			VkPhysicalDeviceProperties properties;
-			vkGetPhysicalDeviceProperties(device, &properties);
-			std::cout << "picked physical device name: " << properties.deviceName << std::endl;
 			physicalDevice = device;
 			break;
 		}
 	}
+
+	// software ICDs (lavapipe, SwiftShader) are fine when there is nothing to present to
+	if (physicalDevice == VK_NULL_HANDLE && headless)
+	{
+		for (const auto& device : physicalDevices)
+		{
+			if (checkQueueFamilies(device))
+			{
+				physicalDevice = device;
+				break;
+			}
+		}
+	}
+
+	if (physicalDevice == VK_NULL_HANDLE)
+		throw std::runtime_error("cannot find suitable physical device");
+
+	// queue family indices are left over from the last device checked
+	checkQueueFamilies(physicalDevice);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	std::cout << "picked physical device name: " << properties.deviceName << std::endl;
 }
 
 bool Renderer::checkQueueFamilies(VkPhysicalDevice device)
@@ -238,24 +545,47 @@ bool Renderer::checkQueueFamilies(VkPhysicalDevice device)
 	families.resize(familiesCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &familiesCount, families.data());
 
+	queueFamilies = {};
+
 	VkBool32 presentSupported = false;
 	for (size_t i = 0; i < families.size(); i++)
 	{
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupported);
+		if (!headless)
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupported);
 
-		if (families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		// a graphics family that can also run compute is worth more than one that cannot
+		bool graphicsCompute = (families[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) ==
+			(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+		if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && (!queueFamilies.computeFamily.has_value() || graphicsCompute))
+		{
 			queueFamilies.graphicsFamily = i;
+			if (graphicsCompute)
+				queueFamilies.computeFamily = i;
+		}
 		if (presentSupported)
 			queueFamilies.presentFamily = i;
+
+		// prefer a transfer-only family over one that can also run compute
+		bool transferOnly = (families[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0;
+		if ((families[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+			(!queueFamilies.transferFamily.has_value() || transferOnly))
+			queueFamilies.transferFamily = i;
 	}
 
+	if (headless)
+		return queueFamilies.graphicsFamily.has_value();
+
 	return queueFamilies.graphicsFamily.has_value() && queueFamilies.presentFamily.has_value();
 }
 
 void Renderer::createLogicalDevice()
 {
 	std::vector<VkDeviceQueueCreateInfo> queueInfos{};
-	std::set<uint32_t> uniqueQueueFamilies = { queueFamilies.graphicsFamily.value(), queueFamilies.presentFamily.value() };
+	std::set<uint32_t> uniqueQueueFamilies = { queueFamilies.graphicsFamily.value() };
+	if (!headless)
+		uniqueQueueFamilies.insert(queueFamilies.presentFamily.value());
+	if (queueFamilies.transferFamily.has_value())
+		uniqueQueueFamilies.insert(queueFamilies.transferFamily.value());
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -268,15 +598,108 @@ void Renderer::createLogicalDevice()
 		queueInfos.push_back(queueCreateInfo);
 	}
 
-	VkPhysicalDeviceFeatures requiredFeatures{};
+	// only what the renderer uses, and only where the device has it
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	enabledFeatures = {};
+	// GPU culling draws runs of batches with one indirect count draw
+	enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	// push constant indices into the bindless arrays are dynamically uniform
+	enabledFeatures.shaderStorageBufferArrayDynamicIndexing = supportedFeatures.shaderStorageBufferArrayDynamicIndexing;
+	enabledFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+	// overdraw statistics, also while recording into secondary command buffers
+	enabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+	enabledFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	uniformAlignment = properties.limits.minUniformBufferOffsetAlignment;
+	uniformRange = std::min<VkDeviceSize>(maxUniformRange, properties.limits.maxUniformBufferRange);
+
+	// descriptor indexing as promoted to 1.2, with just the parts the bindless set uses
+	VkPhysicalDeviceVulkan12Features supported12{};
+	supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceVulkan12Features enabled12{};
+	enabled12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	descriptorIndexingSupported = false;
+	timelineSemaphoreSupported = false;
+	if (apiVersion >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2)
+	{
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+		descriptorIndexingSupported = supported12.descriptorIndexing && supported12.runtimeDescriptorArray &&
+			supported12.descriptorBindingPartiallyBound && supported12.descriptorBindingUpdateUnusedWhilePending &&
+			supported12.descriptorBindingStorageBufferUpdateAfterBind && supported12.descriptorBindingSampledImageUpdateAfterBind;
+		timelineSemaphoreSupported = supported12.timelineSemaphore;
+	}
+	enabled12.timelineSemaphore = timelineSemaphoreSupported;
+
+	if (descriptorIndexingSupported)
+	{
+		enabled12.descriptorIndexing = VK_TRUE;
+		enabled12.runtimeDescriptorArray = VK_TRUE;
+		enabled12.descriptorBindingPartiallyBound = VK_TRUE;
+		enabled12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		enabled12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		enabled12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		enabled12.shaderSampledImageArrayNonUniformIndexing = supported12.shaderSampledImageArrayNonUniformIndexing;
+		enabled12.shaderStorageBufferArrayNonUniformIndexing = supported12.shaderStorageBufferArrayNonUniformIndexing;
+
+		VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+		indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &indexingProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+		// a combined image sampler counts as both a sampler and a sampled image
+		bindlessCapacity.buffers = std::min({ maxBindlessBuffers, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+			indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers, indexingProperties.maxPerStageUpdateAfterBindResources / 2 });
+		bindlessCapacity.textures = std::min({ maxBindlessTextures, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+			indexingProperties.maxDescriptorSetUpdateAfterBindSamplers, indexingProperties.maxPerStageUpdateAfterBindResources / 2 });
+	}
+	else
+	{
+		const VkPhysicalDeviceLimits& limits = properties.limits;
+		bindlessCapacity.buffers = std::min({ fallbackBindlessBuffers, limits.maxPerStageDescriptorStorageBuffers,
+			limits.maxDescriptorSetStorageBuffers });
+		bindlessCapacity.textures = std::min({ fallbackBindlessTextures, limits.maxPerStageDescriptorSampledImages,
+			limits.maxPerStageDescriptorSamplers, limits.maxDescriptorSetSampledImages, limits.maxDescriptorSetSamplers });
+	}
+
+	// no swapchain without a surface
+	std::vector<const char*> extensions;
+	if (!headless)
+		extensions = requiredExtensions;
+
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+	bool drawIndirectCountSupported = false;
+	for (const auto& extension : availableExtensions)
+	{
+		if (strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0)
+			drawIndirectCountSupported = true;
+	}
+	if (drawIndirectCountSupported)
+		extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
 
 	VkDeviceCreateInfo deviceInfo{};
 	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	deviceInfo.enabledExtensionCount = requiredExtensions.size();
-	deviceInfo.ppEnabledExtensionNames = requiredExtensions.data();
+	deviceInfo.enabledExtensionCount = extensions.size();
+	deviceInfo.ppEnabledExtensionNames = extensions.data();
 	deviceInfo.queueCreateInfoCount = queueInfos.size();
 	deviceInfo.pQueueCreateInfos = queueInfos.data();
-	deviceInfo.pEnabledFeatures = &requiredFeatures;
+	deviceInfo.pEnabledFeatures = &enabledFeatures;
+	if (descriptorIndexingSupported || timelineSemaphoreSupported)
+		deviceInfo.pNext = &enabled12;
 	
 	if (validationLayersEnabled)
 	{
@@ -290,10 +713,22 @@ void Renderer::createLogicalDevice()
 		throw std::runtime_error("cannot create logical device");
 
 	vkGetDeviceQueue(device, queueFamilies.graphicsFamily.value(), 0, &graphicsQueue);
-	vkGetDeviceQueue(device, queueFamilies.presentFamily.value(), 0, &presentQueue);
+
+	drawIndexedIndirectCount = nullptr;
+	if (drawIndirectCountSupported)
+		drawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+			vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+	if (!headless)
+		vkGetDeviceQueue(device, queueFamilies.presentFamily.value(), 0, &presentQueue);
+
+	// without a dedicated family uploads go through the graphics queue
+	if (queueFamilies.transferFamily.has_value())
+		vkGetDeviceQueue(device, queueFamilies.transferFamily.value(), 0, &transferQueue);
+	else
+		transferQueue = graphicsQueue;
 }
 
-void Renderer::createSwapChain()
+void Renderer::createSwapChain(VkSwapchainKHR oldSwapChain)
 {
 	SwapChainCapabilities capabilities = getSwapChainCapabilities();
 
@@ -304,7 +739,7 @@ void Renderer::createSwapChain()
 
 	VkSwapchainCreateInfoKHR swapChainInfo{};
 	swapChainInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-	swapChainInfo.minImageCount = capabilities.capabilities.minImageCount + 1;
+	swapChainInfo.minImageCount = chooseSwapChainImageCount(capabilities.capabilities);
 	swapChainInfo.surface = surface;
 	swapChainInfo.imageFormat = format.format;
 	swapChainInfo.imageColorSpace = format.colorSpace;
@@ -315,7 +750,7 @@ void Renderer::createSwapChain()
 	swapChainInfo.preTransform = capabilities.capabilities.currentTransform;
 	swapChainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 	swapChainInfo.imageArrayLayers = 1;
-	swapChainInfo.oldSwapchain = VK_NULL_HANDLE;
+	swapChainInfo.oldSwapchain = oldSwapChain;
 
 	uint32_t queueFamilyIndices[] = { queueFamilies.graphicsFamily.value(), queueFamilies.presentFamily.value() };
 	if (queueFamilies.graphicsFamily.value() != queueFamilies.presentFamily.value())
@@ -344,6 +779,215 @@ void Renderer::createSwapChain()
 	createSwapChainImageViews();
 }
 
+bool Renderer::recreateSwapChain()
+{
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	if (width == 0 || height == 0)
+		return false;
+
+	// Frames in flight may still reference the old objects, so they are retired and
+	// destroyed once those frames completed instead of idling the device here.
+	uint64_t lastUse = frameTimeline.getSubmittedValue();
+	for (VkImageView view : swapChainImageViews)
+	{
+		for (VkFramebuffer framebuffer : frameGraph.releaseFramebuffers(view))
+			deletionQueue.retireFramebuffer(lastUse, framebuffer);
+		deletionQueue.retireImageView(lastUse, view);
+	}
+	deletionQueue.retireImageView(lastUse, depthImageView);
+	deletionQueue.retireImage(lastUse, depthImage);
+	deletionQueue.retireSwapChain(lastUse, swapChain);
+	swapChainImageViews.clear();
+
+	// The surface format is picked deterministically, so the frame graph's render pass
+	// and every pipeline built against it stay compatible; the graph builds framebuffers
+	// for the new images as they come up.
+	createSwapChain(swapChain);
+	createDepthTarget();
+
+	// fences of the old images are meaningless for the new ones
+	imageLastUse.assign(swapChainImages.size(), 0);
+
+	swapChainOutdated = false;
+	return true;
+}
+
+void Renderer::setShaderHotReload(bool enabled)
+{
+	if (enabled == shaderHotReload)
+		return;
+
+	shaderHotReload = enabled;
+	if (!enabled)
+	{
+		shaderWatcher.destroy();
+		return;
+	}
+
+	std::vector<std::string> sources;
+	for (const auto& target : shaderTargets)
+	{
+		std::string source = std::filesystem::path(target.source).filename().string();
+		if (std::find(sources.begin(), sources.end(), source) == sources.end())
+			sources.push_back(source);
+	}
+	shaderWatcher.init("assets/shaders", sources);
+}
+
+void Renderer::updateShaderReload()
+{
+	for (const auto& changed : shaderWatcher.poll())
+	{
+		for (size_t i = 0; i < shaderTargets.size(); i++)
+		{
+			if (std::filesystem::path(shaderTargets[i].source).filename().string() == changed)
+				shaderJobs[i].pending = true;
+		}
+	}
+
+	for (size_t i = 0; i < shaderTargets.size(); i++)
+	{
+		ShaderJob& job = shaderJobs[i];
+		if (job.compile.valid())
+		{
+			if (job.compile.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+			// the pipeline compiler reloads on the job, the culler's pipelines are rebuilt here
+			if (job.compile.get() && gpuCullingSupported && shaderTargets[i].output == GpuCuller::shaderPath)
+				reloadCullingPipelines();
+		}
+
+		if (!job.pending)
+			continue;
+
+		// compiling takes far longer than a frame, the render thread never waits for it
+		const ShaderCompiler::Target& target = shaderTargets[i];
+		job.pending = false;
+		job.compile = JobSystem::submit([target]() {
+			auto start = std::chrono::steady_clock::now();
+			try
+			{
+				ShaderCompiler::compile(target);
+			}
+			catch (const std::exception& e)
+			{
+				std::cout << "shader compilation failed: " << target.source << "\n" << e.what() << std::endl;
+				return false;
+			}
+
+			std::cout << "compiled " << target.output << " in " << millisecondsSince(start) << " ms" << std::endl;
+			pipelineCompiler.reload(target.output);
+			return true;
+		});
+	}
+
+	// the frame just submitted was the last one recorded with the replaced pipelines
+	for (VkPipeline pipeline : pipelineCompiler.swapReloaded())
+		deletionQueue.retirePipeline(frameTimeline.getSubmittedValue(), pipeline);
+}
+
+void Renderer::reloadCullingPipelines()
+{
+	std::vector<VkPipeline> replaced;
+	try
+	{
+		replaced = gpuCuller.reloadPipelines();
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "culling pipeline reload failed, keeping the old one\n" << e.what() << std::endl;
+		return;
+	}
+
+	// the frame just submitted was the last one recorded with the replaced pipelines
+	for (VkPipeline pipeline : replaced)
+		deletionQueue.retirePipeline(frameTimeline.getSubmittedValue(), pipeline);
+}
+
+void Renderer::createOffscreenTargets(uint32_t width, uint32_t height)
+{
+	swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	swapChainExtent = { width, height };
+
+	swapChainImages.resize(offscreenImageCount);
+	offscreenImages.resize(offscreenImageCount);
+
+	for (size_t i = 0; i < offscreenImageCount; i++)
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = swapChainImageFormat;
+		imageInfo.extent = { width, height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		offscreenImages[i] = memoryAllocator.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		swapChainImages[i] = offscreenImages[i].image;
+	}
+
+	createSwapChainImageViews();
+}
+
+VkFormat Renderer::chooseDepthFormat()
+{
+	// no stencil is used, so the formats without it come first
+	VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D16_UNORM };
+
+	for (VkFormat format : candidates)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+			return format;
+	}
+
+	throw std::runtime_error("no supported depth format");
+}
+
+void Renderer::createDepthTarget()
+{
+	if (depthFormat == VK_FORMAT_UNDEFINED)
+		depthFormat = chooseDepthFormat();
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = depthFormat;
+	imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	depthImage = memoryAllocator.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = depthImage.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = depthFormat;
+	bool stencil = depthFormat == VK_FORMAT_D24_UNORM_S8_UINT || depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | (stencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &depthImageView) != VK_SUCCESS)
+		throw std::runtime_error("cannot create depth image view");
+}
+
 Renderer::SwapChainCapabilities Renderer::getSwapChainCapabilities()
 {
 	SwapChainCapabilities swapChainCapabilities;
@@ -370,15 +1014,41 @@ Renderer::SwapChainCapabilities Renderer::getSwapChainCapabilities()
 
 VkPresentModeKHR Renderer::chooseSwapChainPresentMode(const std::vector<VkPresentModeKHR>& presentModes)
 {
-	for (const auto& presentMode : presentModes)
+	// MAILBOX replaces a queued image instead of waiting behind it, IMMEDIATE does not wait
+	// for vertical blank at all; FIFO is the only mode every device supports
+	std::vector<VkPresentModeKHR> preferred;
+	switch (latencyMode)
+	{
+	case LatencyMode::LowLatency:
+		preferred = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+		break;
+	case LatencyMode::Balanced:
+		preferred = { VK_PRESENT_MODE_MAILBOX_KHR };
+		break;
+	case LatencyMode::Throughput:
+		preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+		break;
+	}
+
+	for (VkPresentModeKHR presentMode : preferred)
 	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (std::find(presentModes.begin(), presentModes.end(), presentMode) != presentModes.end())
 			return presentMode;
 	}
 
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t Renderer::chooseSwapChainImageCount(const VkSurfaceCapabilitiesKHR& capabilities)
+{
+	uint32_t spareImages = latencyMode == LatencyMode::LowLatency ? 0 : latencyMode == LatencyMode::Balanced ? 1 : 2;
+	uint32_t imageCount = capabilities.minImageCount + spareImages;
+	// 0 means no limit
+	if (capabilities.maxImageCount != 0)
+		imageCount = std::min(imageCount, capabilities.maxImageCount);
+	return imageCount;
+}
+
 VkSurfaceFormatKHR Renderer::chooseSwapChainFormat(const std::vector<VkSurfaceFormatKHR>& formats)
 {
 	for (const auto& format : formats)
@@ -409,8 +1079,9 @@ VkExtent2D Renderer::chooseSwapChainExtent(const VkSurfaceCapabilitiesKHR& capab
 
 		extent.height = std::max(capabilities.minImageExtent.height,
 			std::min(capabilities.maxImageExtent.height, extent.height));
-	}
 
+		return extent;
+	}
 }
 
 bool Renderer::checkDeviceRequirements(VkPhysicalDevice device)
@@ -463,266 +1134,1118 @@ void Renderer::createSwapChainImageViews()
 
 void Renderer::createGraphicsPipeline()
 {
-	auto vertShaderCode = readFile("assets/shaders/vert.spv");
-	auto fragShaderCode = readFile("assets/shaders/frag.spv");
+	// every graphics pipeline's layout starts from the sets the renderer binds once per
+	// command buffer and the push constant range shared by all draws, 128 bytes being the
+	// guaranteed minimum; shaders that use nothing else all end up with this one layout
+	LayoutCache::PipelineLayoutDesc sharedLayout;
+	sharedLayout.sets = { bindlessDescriptors.getSetLayoutDesc(), getUniformSetLayoutDesc() };
+	sharedLayout.pushConstantRanges = { { VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, 128 } };
+	pipelineLayout = layoutCache.getPipelineLayout(sharedLayout);
+
+	pipelineCompiler.init(device, pipelineCache.get(), layoutCache, sharedLayout);
+
+	auto start = std::chrono::steady_clock::now();
+	if (depthPrepass)
+	{
+		GraphicsPipelineDesc depthOnly = getDepthOnlyPipelineDesc(getDefaultPipelineDesc());
+		graphicsPipeline = pipelineCompiler.compile(getDefaultPipelineDesc(), PipelineHandle(), &depthOnly);
+	}
+	else
+		graphicsPipeline = pipelineCompiler.compile(getDefaultPipelineDesc(), PipelineHandle());
+	graphicsPipeline.wait();
 
-	VkShaderModule vertexShaderModule = createShaderModule(vertShaderCode);
-	VkShaderModule fragmentShaderModule = createShaderModule(fragShaderCode);
+	std::cout << "graphics pipeline created in " << millisecondsSince(start) << " ms ("
+		<< (pipelineCache.isWarm() ? "warm" : "cold") << " cache)" << std::endl;
 
-	VkPipelineShaderStageCreateInfo vertexShaderStageInfo{};
-	vertexShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertexShaderStageInfo.module = vertexShaderModule;
-	vertexShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertexShaderStageInfo.pName = "main";
-	
-	VkPipelineShaderStageCreateInfo fragmentShaderStageInfo{};
-	fragmentShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragmentShaderStageInfo.module = fragmentShaderModule;
-	fragmentShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragmentShaderStageInfo.pName = "main";
+	prewarmPipelines(permutationManifestPath);
+}
 
-	VkPipelineShaderStageCreateInfo stages[] = { vertexShaderStageInfo, fragmentShaderStageInfo };
+void Renderer::prewarmPipelines(const std::string& manifestPath)
+{
+	std::ifstream manifest(manifestPath);
+	if (!manifest.is_open())
+		return;
 
-	VkPipelineVertexInputStateCreateInfo  vertexInputInfo{};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
+	std::vector<GraphicsPipelineDesc> descs;
+	std::string line;
+	for (uint32_t lineNumber = 1; std::getline(manifest, line); lineNumber++)
+	{
+		std::istringstream words(line.substr(0, line.find('#')));
+		std::string format;
+		if (!(words >> format))
+			continue;
+
+		std::string location = manifestPath + ":" + std::to_string(lineNumber) + ": ";
+		GraphicsPipelineDesc desc;
+		if (format == "default")
+			desc = getDefaultPipelineDesc();
+		else if (format == "mesh")
+			desc = getMeshPipelineDesc();
+		else if (format == "packed_mesh")
+			desc = getPackedMeshPipelineDesc();
+		else if (format == "instanced")
+			desc = getInstancedPipelineDesc(Mesh::VertexFormat::Float);
+		else if (format == "instanced_packed")
+			desc = getInstancedPipelineDesc(Mesh::VertexFormat::Packed);
+		else
+			throw std::runtime_error(location + "unknown vertex format " + format);
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
-	inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+		ShaderPermutation permutation;
+		std::string feature;
+		while (words >> feature)
+		{
+			if (feature == "flat")
+				permutation.lighting = LightingModel::Flat;
+			else if (feature == "alpha_test")
+				permutation.alphaTest = true;
+			else
+				throw std::runtime_error(location + "unknown feature " + feature);
+		}
 
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = float(swapChainExtent.width);
-	viewport.height = float(swapChainExtent.height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
+		applyPermutation(desc, permutation);
+		descs.push_back(desc);
+	}
 
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapChainExtent;
+	for (const auto& desc : descs)
+		requestPipeline(desc);
 
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
-
-	VkPipelineRasterizationStateCreateInfo rasterizer{};
-	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-
-	rasterizer.depthBiasEnable = VK_FALSE;
-	rasterizer.depthBiasConstantFactor = 0.0f;
-	rasterizer.depthBiasClamp = 0.0f;
-	rasterizer.depthBiasSlopeFactor = 0.0f;
-
-	VkPipelineMultisampleStateCreateInfo multisampling{};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	multisampling.minSampleShading = 1.0f;
-	multisampling.pSampleMask = nullptr;
-	multisampling.alphaToCoverageEnable = VK_FALSE;
-	multisampling.alphaToOneEnable = VK_FALSE;
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-		VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending{};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY; // optional
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
-
-	VkPipelineLayoutCreateInfo layoutInfo{};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-	if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-		throw std::runtime_error("cannot create pipeline layout");
-
-
-	VkGraphicsPipelineCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = stages;
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDepthStencilState = nullptr;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
-
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
-		throw std::runtime_error("cannot create graphics pipeline");
-
-	vkDestroyShaderModule(device, vertexShaderModule, nullptr);
-	vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
-
-}
-
-VkShaderModule Renderer::createShaderModule(const std::vector<char>& code)
-{
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = (uint32_t*)code.data();
-
-	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-		throw std::runtime_error("cannot create shader module");
-
-	return shaderModule;
+	std::cout << "prewarming " << descs.size() << " pipelines from " << manifestPath << std::endl;
 }
 
-std::vector<char> Renderer::readFile(const std::string& path)
+void Renderer::applyPermutation(GraphicsPipelineDesc& desc, const ShaderPermutation& permutation)
 {
-	std::ifstream file(path, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open())
-		throw std::runtime_error("cannot open a file");
-
-	size_t fileSize = (size_t) file.tellg();
-	std::vector<char> code(fileSize);
-	file.seekg(0);
-	file.read(code.data(), fileSize);
-	file.close();
+	uint32_t alphaCutoff;
+	std::memcpy(&alphaCutoff, &permutation.alphaCutoff, sizeof(alphaCutoff));
+
+	// Values equal to the shader's defaults are left out, so that a default permutation
+	// shares its pipeline with descriptions that never had one applied.
+	auto set = [&desc](uint32_t constantId, uint32_t value, bool isDefault) {
+		auto constant = std::find_if(desc.specialization.begin(), desc.specialization.end(),
+			[constantId](const GraphicsPipelineDesc::SpecializationConstant& c) { return c.constantId == constantId; });
+		if (isDefault)
+		{
+			if (constant != desc.specialization.end())
+				desc.specialization.erase(constant);
+		}
+		else if (constant != desc.specialization.end())
+			constant->value = value;
+		else
+			desc.specialization.push_back({ constantId, value });
+	};
+
+	const ShaderPermutation defaults;
+	set(lightingConstant, uint32_t(permutation.lighting), permutation.lighting == defaults.lighting);
+	set(alphaTestConstant, VK_TRUE, !permutation.alphaTest);
+	// the cutoff only matters to the test
+	set(alphaCutoffConstant, alphaCutoff, !permutation.alphaTest || permutation.alphaCutoff == defaults.alphaCutoff);
+}
 
-	return code;
+GraphicsPipelineDesc Renderer::getDefaultPipelineDesc()
+{
+	GraphicsPipelineDesc desc;
+	desc.vertexShaderPath = "assets/shaders/vert.spv";
+	desc.fragmentShaderPath = "assets/shaders/frag.spv";
+	desc.renderPass = renderPass;
+	desc.subpass = frameGraph.getSubpass(mainPass);
+	// after the pre-pass the depth buffer already holds the nearest surface
+	desc.depthTest = true;
+	desc.depthWrite = !depthPrepass;
+	desc.depthCompare = depthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+	return desc;
 }
 
-void Renderer::createRenderPass()
+GraphicsPipelineDesc Renderer::getDepthOnlyPipelineDesc(const GraphicsPipelineDesc& desc)
 {
-	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = swapChainImageFormat;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// the same vertex stage, so positions and with them depth match the main pass exactly
+	GraphicsPipelineDesc depthOnly = desc;
+
+	// an alpha test has to run in the pre-pass too, or the main pass would find depth of
+	// fragments it discards; unlit, the colour is never written
+	bool alphaTest = std::any_of(desc.specialization.begin(), desc.specialization.end(),
+		[](const GraphicsPipelineDesc::SpecializationConstant& constant) {
+			return constant.constantId == alphaTestConstant && constant.value != VK_FALSE;
+		});
+	if (alphaTest)
+	{
+		// Unlit is the default, which applyPermutation leaves out
+		depthOnly.specialization.erase(std::remove_if(depthOnly.specialization.begin(), depthOnly.specialization.end(),
+			[](const GraphicsPipelineDesc::SpecializationConstant& constant) { return constant.constantId == lightingConstant; }),
+			depthOnly.specialization.end());
+	}
+	else
+	{
+		// the permutation constants are the fragment stage's, they go with it
+		depthOnly.fragmentShaderPath.clear();
+		depthOnly.specialization.erase(std::remove_if(depthOnly.specialization.begin(), depthOnly.specialization.end(),
+			[](const GraphicsPipelineDesc::SpecializationConstant& constant) {
+				return constant.constantId == lightingConstant || constant.constantId == alphaTestConstant ||
+					constant.constantId == alphaCutoffConstant;
+			}),
+			depthOnly.specialization.end());
+	}
 
-	VkAttachmentReference colorAttachmentRef{};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	depthOnly.blendEnable = false;
+	depthOnly.depthOnly = true;
+	depthOnly.depthTest = true;
+	depthOnly.depthWrite = true;
+	depthOnly.depthCompare = VK_COMPARE_OP_LESS;
+	depthOnly.renderPass = frameGraph.getRenderPass(depthPrepassPass);
+	depthOnly.subpass = frameGraph.getSubpass(depthPrepassPass);
+	return depthOnly;
+}
 
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
+VkPipeline Renderer::getDepthOnlyPipeline(VkPipeline pipeline)
+{
+	return pipelineCompiler.getDepthOnly(pipeline);
+}
 
-	VkRenderPassCreateInfo renderPassInfo{};
+GraphicsPipelineDesc Renderer::getMeshPipelineDesc()
+{
+	GraphicsPipelineDesc desc = getDefaultPipelineDesc();
+	desc.vertexShaderPath = "assets/shaders/mesh_vert.spv";
 
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpass;
-	
-	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
-		throw std::runtime_error("cannot create render pass");
+	auto attributes = Vertex::getAttributeDescriptions();
+	desc.vertexBindings = { Vertex::getBindingDescription() };
+	desc.vertexAttributes.assign(attributes.begin(), attributes.end());
+	return desc;
+}
 
+GraphicsPipelineDesc Renderer::getPackedMeshPipelineDesc()
+{
+	GraphicsPipelineDesc desc = getDefaultPipelineDesc();
+	desc.vertexShaderPath = "assets/shaders/packed_mesh_vert.spv";
 
-	
+	auto attributes = PackedVertex::getAttributeDescriptions();
+	desc.vertexBindings = { PackedVertex::getBindingDescription() };
+	desc.vertexAttributes.assign(attributes.begin(), attributes.end());
+	return desc;
 }
 
-void Renderer::createFramebuffers()
+GraphicsPipelineDesc Renderer::getInstancedPipelineDesc(Mesh::VertexFormat vertexFormat)
 {
-	swapChainFramebuffers.resize(swapChainImages.size());
+	bool packed = vertexFormat == Mesh::VertexFormat::Packed;
+	GraphicsPipelineDesc desc = packed ? getPackedMeshPipelineDesc() : getMeshPipelineDesc();
+	desc.vertexShaderPath = packed ? "assets/shaders/instanced_packed_mesh_vert.spv" : "assets/shaders/instanced_mesh_vert.spv";
 
-	for (size_t i = 0; i < swapChainFramebuffers.size(); i++)
+	// each transform row is its own binding, which keeps the instance data SoA
+	for (uint32_t row = 0; row < 3; row++)
 	{
-		VkImageView attachments[] = {
-			swapChainImageViews[i]
-		};
-
-		VkFramebufferCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		createInfo.renderPass = renderPass;
-		createInfo.attachmentCount = 1;
-		createInfo.pAttachments = attachments;
-		createInfo.width = swapChainExtent.width;
-		createInfo.height = swapChainExtent.height;
-		createInfo.layers = 1;
-
-		if (vkCreateFramebuffer(device, &createInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
-			throw std::runtime_error("cannot create framebuffer");
+		desc.vertexBindings.push_back({ 1 + row, 4 * sizeof(float), VK_VERTEX_INPUT_RATE_INSTANCE });
+		desc.vertexAttributes.push_back({ 3 + row, 1 + row, VK_FORMAT_R32G32B32A32_SFLOAT, 0 });
 	}
+	return desc;
 }
 
-void Renderer::createCommandPool()
+PipelineHandle Renderer::requestPipeline(const GraphicsPipelineDesc& desc)
 {
-	VkCommandPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex = queueFamilies.graphicsFamily.value();
+	if (!depthPrepass)
+		return pipelineCompiler.compile(desc, graphicsPipeline);
 
-	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
-		throw std::runtime_error("cannot create command pool");
+	GraphicsPipelineDesc depthOnly = getDepthOnlyPipelineDesc(desc);
+	return pipelineCompiler.compile(desc, graphicsPipeline, &depthOnly);
 }
 
-void Renderer::createCommandBuffers()
+std::vector<PipelineHandle> Renderer::requestPipelines(const std::vector<GraphicsPipelineDesc>& descs)
 {
-	commandBuffers.resize(swapChainFramebuffers.size());
-
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = commandPool;
-	allocInfo.commandBufferCount = commandBuffers.size();
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-
-	if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
-		throw std::runtime_error("cannot create command buffers");
+	if (!depthPrepass)
+		return pipelineCompiler.compile(descs, graphicsPipeline);
+
+	std::vector<PipelineHandle> handles;
+	handles.reserve(descs.size());
+	for (const auto& desc : descs)
+		handles.push_back(requestPipeline(desc));
+	return handles;
+}
 
-	for (size_t i = 0; i < commandBuffers.size(); i++)
+Buffer Renderer::createDeviceBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	// shared between the transfer and graphics families without ownership transfers
+	uint32_t families[] = { queueFamilies.graphicsFamily.value(), queueFamilies.transferFamily.value_or(0) };
+	if (queueFamilies.transferFamily.has_value())
 	{
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = families;
+	}
+	else
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
-			throw std::runtime_error("cannot begin command buffer");
+	Buffer buffer = memoryAllocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (data)
+		uploadManager.upload(buffer.buffer, 0, data, size);
+	return buffer;
+}
 
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = swapChainExtent;
+bool Renderer::streamUpload(const Buffer& dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	return uploadManager.tryUpload(dst.buffer, dstOffset, data, size);
+}
+
+Mesh Renderer::createMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool upload)
+{
+	Mesh mesh;
+	mesh.vertexCount = vertices.size();
+	mesh.indexCount = indices.size();
+	mesh.vertexBuffer = createDeviceBuffer(upload ? vertices.data() : nullptr, vertices.size() * sizeof(Vertex),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	mesh.indexBuffer = createDeviceBuffer(upload ? indices.data() : nullptr, indices.size() * sizeof(uint32_t),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+	// centered on the bounding box, which is close enough for culling
+	float boxMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float boxMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const Vertex& vertex : vertices)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boxMin[axis] = std::min(boxMin[axis], vertex.position[axis]);
+			boxMax[axis] = std::max(boxMax[axis], vertex.position[axis]);
+		}
+	}
+
+	float radiusSquared = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+		mesh.boundingSphere[axis] = 0.5f * (boxMin[axis] + boxMax[axis]);
+	for (const Vertex& vertex : vertices)
+	{
+		float dx = vertex.position[0] - mesh.boundingSphere[0];
+		float dy = vertex.position[1] - mesh.boundingSphere[1];
+		float dz = vertex.position[2] - mesh.boundingSphere[2];
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+	mesh.boundingSphere[3] = std::sqrt(radiusSquared);
+	return mesh;
+}
+
+Mesh Renderer::createMesh(const MeshFileView& file, bool upload)
+{
+	const MeshFileHeader& header = *file.header;
+
+	Mesh mesh;
+	mesh.vertexCount = header.vertexCount;
+	mesh.indexCount = header.indexCount;
+	mesh.vertexFormat = Mesh::VertexFormat::Packed;
+	mesh.indexType = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	mesh.dequantization = header.dequantization;
+	mesh.vertexBuffer = createDeviceBuffer(upload ? file.vertices : nullptr, header.vertices.size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	mesh.indexBuffer = createDeviceBuffer(upload ? file.indices : nullptr, header.indices.size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+	// positions are quantized over the bounding box, so it spans offset to offset + scale
+	float radiusSquared = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float halfExtent = 0.5f * header.dequantization.scale[axis];
+		mesh.boundingSphere[axis] = header.dequantization.offset[axis] + halfExtent;
+		radiusSquared += halfExtent * halfExtent;
+	}
+	mesh.boundingSphere[3] = std::sqrt(radiusSquared);
+	return mesh;
+}
+
+void Renderer::destroyMesh(Mesh& mesh)
+{
+	// the copies into the buffers run on the upload timeline, and the last of them may
+	// not be flushed yet; the next frame's submit waits for everything flushed up to it,
+	// so it is the first frame whose completion covers them
+	uint64_t lastUse = frameTimeline.getSubmittedValue() + 1;
+	deletionQueue.retireBuffer(lastUse, mesh.vertexBuffer);
+	deletionQueue.retireBuffer(lastUse, mesh.indexBuffer);
+	mesh = Mesh();
+}
+
+LinearAllocator::Suballocation Renderer::composeInstanceTransforms(const InstanceBatch& instances)
+{
+	uint32_t count = instances.size();
+	VkDeviceSize rowSize = VkDeviceSize(count) * 4 * sizeof(float);
+	LinearAllocator::Suballocation memory = allocateFrameMemory(3 * rowSize, 16);
+
+	float* row0 = static_cast<float*>(memory.mapped);
+	float* row1 = row0 + count * 4;
+	float* row2 = row1 + count * 4;
+	TransformArrays arrays = instances.getArrays();
+
+	uint32_t jobCount = (count + instancesPerJob - 1) / instancesPerJob;
+	JobSystem::parallelFor(jobCount, JobSystem::getThreadCount() + 1, [&](uint32_t job) {
+		size_t first = size_t(job) * instancesPerJob;
+		Math::composeTransforms(arrays, first, std::min<size_t>(instancesPerJob, count - first), row0, row1, row2);
+	});
+
+	return memory;
+}
+
+void Renderer::submitInstanced(const Mesh& mesh, VkPipeline pipeline, const InstanceBatch& instances)
+{
+	uint32_t count = instances.size();
+	if (count == 0)
+		return;
+
+	LinearAllocator::Suballocation memory = composeInstanceTransforms(instances);
+
+	submit(mesh, pipeline, count);
+	drawList.back().instanceBuffer = memory.buffer;
+	drawList.back().instanceOffset = memory.offset;
+}
+
+void Renderer::submitCulled(const Mesh& mesh, VkPipeline pipeline, const InstanceBatch& instances)
+{
+	if (!gpuCullingSupported || !gpuCullingEnabled)
+	{
+		auto start = std::chrono::steady_clock::now();
+		CullingStats stats = cpuCuller.cull(instances, mesh.boundingSphere, occlusionCulling ? &occlusionBuffer : nullptr,
+			cpuCulledInstances);
+		cpuCullingTime += millisecondsSince(start);
+
+		cpuCullingStats.objects += stats.objects;
+		cpuCullingStats.visible += stats.visible;
+		cpuCullingStats.occluded += stats.occluded;
+
+		submitInstanced(mesh, pipeline, cpuCulledInstances);
+		return;
+	}
+
+	uint32_t count = instances.size();
+	if (count == 0)
+		return;
+
+	LinearAllocator::Suballocation memory = composeInstanceTransforms(instances);
+
+	// the culler binds the survivors itself, the draw only carries the state
+	submit(mesh, pipeline);
+	bool continueRun = false;
+	if (drawList.size() > 1)
+	{
+		const DrawCommand& previous = drawList[drawList.size() - 2];
+		continueRun = previous.cullingBatch >= 0 && sameDrawState(previous, drawList.back());
+	}
+	drawList.back().cullingBatch = gpuCuller.addBatch(memory.offset, count, mesh.indexCount, mesh.boundingSphere,
+		continueRun);
+}
+
+bool Renderer::sameDrawState(const DrawCommand& a, const DrawCommand& b)
+{
+	return a.pipeline == b.pipeline && a.vertexBuffer == b.vertexBuffer && a.indexBuffer == b.indexBuffer &&
+		a.indexType == b.indexType && a.pushConstants == b.pushConstants && a.materialIndex == b.materialIndex &&
+		a.uniformOffset == b.uniformOffset;
+}
+
+LinearAllocator::Suballocation Renderer::allocateFrameMemory(VkDeviceSize size, VkDeviceSize alignment)
+{
+	// draw() waits for the same frame, so this only moves the wait earlier
+	if (frameAllocatorFrame != frameNumber)
+	{
+		waitForFrames(maxFramesInFlight - 1);
+		frameAllocator.beginFrame(currentFrame);
+		frameAllocatorFrame = frameNumber;
+	}
+
+	LinearAllocator::Suballocation suballocation;
+	if (!frameAllocator.allocate(size, alignment, suballocation))
+		throw std::runtime_error("frame memory exhausted");
+
+	return suballocation;
+}
+
+LinearAllocator::Suballocation Renderer::allocateUniforms(VkDeviceSize size)
+{
+	if (size > uniformRange)
+		throw std::runtime_error("uniform data exceeds the uniform range");
+
+	return allocateFrameMemory(size, uniformAlignment);
+}
+
+void Renderer::setFrameUniforms(const void* data, VkDeviceSize size)
+{
+	LinearAllocator::Suballocation memory = allocateUniforms(size);
+	memcpy(memory.mapped, data, size);
+	frameUniformOffset = uint32_t(memory.offset);
+}
+
+void Renderer::submit(const Mesh& mesh, VkPipeline pipeline, uint32_t instanceCount)
+{
+	DrawCommand command;
+	command.pipeline = pipeline;
+	command.vertexBuffer = mesh.vertexBuffer.buffer;
+	command.indexBuffer = mesh.indexBuffer.buffer;
+	command.indexType = mesh.indexType;
+	command.indexCount = mesh.indexCount;
+	command.instanceCount = instanceCount;
+	if (mesh.vertexFormat == Mesh::VertexFormat::Packed)
+	{
+		command.pushConstants = &mesh.dequantization;
+		command.pushConstantSize = sizeof(MeshDequantization);
+	}
+	drawList.push_back(command);
+}
+
+std::vector<char> Renderer::readFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open())
+		throw std::runtime_error("cannot open a file");
+
+	size_t fileSize = (size_t) file.tellg();
+	std::vector<char> code(fileSize);
+	file.seekg(0);
+	file.read(code.data(), fileSize);
+	file.close();
+
+	return code;
+}
+
+void Renderer::createFrameGraph()
+{
+	// offscreen targets are left ready for readback
+	VkImageLayout finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	backbufferResource = frameGraph.importImage("backbuffer", swapChainImageFormat, swapChainExtent,
+		VK_IMAGE_LAYOUT_UNDEFINED, finalLayout);
+	RenderGraph::Resource drawCommands = frameGraph.importBuffer("indirect draws");
+	RenderGraph::Resource visibleTransforms = frameGraph.importBuffer("visible transforms");
+	// nothing reads depth after the frame, so it is never written back
+	depthResource = frameGraph.importImage("depth", depthFormat, swapChainExtent, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+	VkClearValue clearDepth{};
+	clearDepth.depthStencil = { 1.0f, 0 };
+
+	if (gpuCullingSupported)
+	{
+		RenderGraph::Pass culling = frameGraph.addPass("culling", RenderGraph::PassType::Compute, [](VkCommandBuffer commandBuffer) {
+			gpuCuller.recordCulling(commandBuffer, currentFrame);
+		});
+		frameGraph.use(culling, drawCommands, RenderGraph::Usage::StorageWrite);
+		frameGraph.use(culling, visibleTransforms, RenderGraph::Usage::StorageWrite);
+	}
+
+	// merged with the main pass into one render pass, depth stays on chip in between
+	if (depthPrepass)
+	{
+		depthPrepassPass = frameGraph.addPass("depth prepass", RenderGraph::PassType::Graphics, recordDepthPrepass);
+		frameGraph.useAttachment(depthPrepassPass, depthResource, RenderGraph::Usage::DepthAttachment, clearDepth);
+		if (gpuCullingSupported)
+		{
+			frameGraph.use(depthPrepassPass, drawCommands, RenderGraph::Usage::IndirectRead);
+			frameGraph.use(depthPrepassPass, visibleTransforms, RenderGraph::Usage::VertexRead);
+		}
+	}
+
+	mainPass = frameGraph.addPass("main", RenderGraph::PassType::Graphics, recordMainPass);
+	VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+	frameGraph.useAttachment(mainPass, backbufferResource, RenderGraph::Usage::ColorAttachment, clearColor);
+	if (depthPrepass)
+		frameGraph.use(mainPass, depthResource, RenderGraph::Usage::DepthAttachment);
+	else
+		frameGraph.useAttachment(mainPass, depthResource, RenderGraph::Usage::DepthAttachment, clearDepth);
+	if (gpuCullingSupported)
+	{
+		frameGraph.use(mainPass, drawCommands, RenderGraph::Usage::IndirectRead);
+		frameGraph.use(mainPass, visibleTransforms, RenderGraph::Usage::VertexRead);
+	}
+
+	frameGraph.compile();
+	frameGraph.realize(device, memoryAllocator);
+	renderPass = frameGraph.getRenderPass(mainPass);
+}
+
+void Renderer::createCommandPools()
+{
+	commandPools.resize(maxFramesInFlight);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamilies.graphicsFamily.value();
+
+	for (size_t i = 0; i < maxFramesInFlight; i++)
+	{
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPools[i]) != VK_SUCCESS)
+			throw std::runtime_error("cannot create command pool");
+	}
+}
+
+LayoutCache::SetLayoutDesc Renderer::getUniformSetLayoutDesc()
+{
+	LayoutCache::SetLayoutDesc desc;
+	desc.bindings.resize(2);
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		desc.bindings[i].binding = i;
+		desc.bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		desc.bindings[i].descriptorCount = 1;
+		desc.bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	return desc;
+}
+
+void Renderer::createUniformSet()
+{
+	uniformSetLayout = layoutCache.getSetLayout(getUniformSetLayoutDesc());
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2 };
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &uniformPool) != VK_SUCCESS)
+		throw std::runtime_error("cannot create uniform descriptor pool");
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = uniformPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &uniformSetLayout;
+	if (vkAllocateDescriptorSets(device, &allocInfo, &uniformSet) != VK_SUCCESS)
+		throw std::runtime_error("cannot allocate uniform descriptor set");
+
+	// written once: every frame only moves the dynamic offsets within the same buffer
+	VkDescriptorBufferInfo bufferInfo = { frameAllocator.getBuffer(), 0, uniformRange };
+	VkWriteDescriptorSet writes[2]{};
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = uniformSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		writes[i].pBufferInfo = &bufferInfo;
+	}
+	vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+}
+
+void Renderer::createBindlessDescriptors()
+{
+	const uint32_t zeros[64] = {};
+	defaultBuffer = createDeviceBuffer(zeros, sizeof(zeros), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+	// 1x1 white, cleared and moved to its sampling layout once at startup
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.extent = { 1, 1, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	defaultTexture = memoryAllocator.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = defaultTexture.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = imageInfo.format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	if (vkCreateImageView(device, &viewInfo, nullptr, &defaultTextureView) != VK_SUCCESS)
+		throw std::runtime_error("cannot create default texture view");
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &defaultSampler) != VK_SUCCESS)
+		throw std::runtime_error("cannot create default sampler");
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamilies.graphicsFamily.value();
+	VkCommandPool pool;
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("cannot create command pool");
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("cannot create command buffer");
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = defaultTexture.image;
+	barrier.subresourceRange = viewInfo.subresourceRange;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkClearColorValue white = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+	vkCmdClearColorImage(commandBuffer, defaultTexture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &white, 1, &viewInfo.subresourceRange);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("cannot end command buffer");
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		throw std::runtime_error("cannot submit default texture initialization");
+	vkQueueWaitIdle(graphicsQueue);
+	vkDestroyCommandPool(device, pool, nullptr);
+
+	bindlessDescriptors.init(device, layoutCache, descriptorIndexingSupported, bindlessCapacity, maxFramesInFlight,
+		{ defaultBuffer.buffer, 0, VK_WHOLE_SIZE }, { defaultSampler, defaultTextureView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+
+	std::cout << (descriptorIndexingSupported ? "bindless descriptors with descriptor indexing (" : "bindless descriptors rewritten per frame (")
+		<< bindlessCapacity.buffers << " buffers, " << bindlessCapacity.textures << " textures)" << std::endl;
+}
+
+void Renderer::createCullers()
+{
+	occlusionBuffer.init(occlusionBufferWidth, occlusionBufferHeight);
+
+	gpuCullingSupported = queueFamilies.computeFamily.has_value();
+	if (!gpuCullingSupported)
+	{
+		std::cout << "no compute on the graphics queue, culling on the CPU ("
+			<< Culling::getName(cpuCuller.getKernel()) << ")" << std::endl;
+		return;
+	}
+
+	GpuCuller::Features features;
+	features.multiDrawIndirect = enabledFeatures.multiDrawIndirect;
+	features.drawIndirectFirstInstance = enabledFeatures.drawIndirectFirstInstance;
+	features.drawIndexedIndirectCount = drawIndexedIndirectCount;
+	gpuCuller.init(device, pipelineCache.get(), memoryAllocator, layoutCache, features, frameAllocator.getBuffer(), maxFramesInFlight);
+
+	std::cout << "GPU culling with " << (gpuCuller.drawsWithIndirectCount() ? "one indirect count draw per run" :
+		"one indirect draw per batch") << std::endl;
+}
+
+void Renderer::clearDrawList()
+{
+	drawList.clear();
+	gpuCuller.endFrame();
+	cpuCullingStats = {};
+	cpuCullingTime = 0.0;
+	occlusionBuffer.clear();
+	frameUniformOffset = 0;
+}
+
+void Renderer::createQueryPool()
+{
+	std::vector<VkQueueFamilyProperties> families;
+	uint32_t familiesCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familiesCount, nullptr);
+
+	families.resize(familiesCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familiesCount, families.data());
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	timestampPeriod = properties.limits.timestampPeriod;
+	gpuTimingSupported = families[queueFamilies.graphicsFamily.value()].timestampValidBits != 0;
+
+	if (!gpuTimingSupported)
+	{
+		std::cout << "graphics queue has no timestamp support, GPU timings disabled" << std::endl;
+		return;
+	}
+
+	// a begin/end pair per frame in flight
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = 2 * maxFramesInFlight;
+
+	if (vkCreateQueryPool(device, &poolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS)
+		throw std::runtime_error("cannot create timestamp query pool");
+}
 
-		VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+void Renderer::createStatisticsQueryPool()
+{
+	overdrawSupported = enabledFeatures.pipelineStatisticsQuery;
+	statisticsRecorded.assign(maxFramesInFlight, false);
+	if (!overdrawSupported)
+	{
+		std::cout << "no pipeline statistics queries, overdraw statistics disabled" << std::endl;
+		return;
+	}
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	poolInfo.queryCount = maxFramesInFlight;
+	poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	if (vkCreateQueryPool(device, &poolInfo, nullptr, &statisticsQueryPool) != VK_SUCCESS)
+		throw std::runtime_error("cannot create pipeline statistics query pool");
+}
+
+bool Renderer::readGpuTimestamps(uint32_t frameIndex, double& gpuTime)
+{
+	if (!gpuTimingSupported)
+		return false;
+
+	uint64_t timestamps[2];
+	VkResult result = vkGetQueryPoolResults(device, timestampQueryPool, 2 * frameIndex, 2,
+		sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (result != VK_SUCCESS)
+		return false;
+
+	gpuTime = double(timestamps[1] - timestamps[0]) * timestampPeriod / 1e6;
+	return true;
+}
+
+bool Renderer::readOverdraw(uint32_t frameIndex, double& overdraw)
+{
+	if (!overdrawSupported || !statisticsRecorded[frameIndex])
+		return false;
+
+	uint64_t invocations;
+	VkResult result = vkGetQueryPoolResults(device, statisticsQueryPool, frameIndex, 1,
+		sizeof(invocations), &invocations, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (result != VK_SUCCESS)
+		return false;
+
+	// a resize since only skews the figure for a frame
+	overdraw = double(invocations) / (double(swapChainExtent.width) * swapChainExtent.height);
+	return true;
+}
+
+std::string Renderer::getDeviceName()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	return properties.deviceName;
+}
+
+void Renderer::createCommandBuffers()
+{
+	commandBuffers.resize(maxFramesInFlight);
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandBufferCount = 1;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+	for (size_t i = 0; i < maxFramesInFlight; i++)
+	{
+		allocInfo.commandPool = commandPools[i];
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS)
+			throw std::runtime_error("cannot create command buffers");
+	}
+
+	drawList.reserve(1024);
+}
+
+void Renderer::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("cannot begin command buffer");
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-		vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-		vkCmdEndRenderPass(commandBuffers[i]);
+	if (gpuTimingSupported)
+	{
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 2 * currentFrame, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 2 * currentFrame);
+	}
+
+	frameDescriptorSet = bindlessDescriptors.beginFrame(currentFrame, frameNumber, frameTimeline.getCompletedValue());
 
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
-			throw std::runtime_error("cannot end command buffer");
+	uint32_t drawCount = drawList.size();
+	uint32_t chunkCount = recordingThreads > 1 ? std::min(recordingThreads * 4, drawCount / minDrawsPerChunk) : 0;
+	drawChunkCount = chunkCount < 2 ? 0 : chunkCount;
+
+	frameGraph.setImage(backbufferResource, swapChainImages[imageIndex], swapChainImageViews[imageIndex], swapChainExtent);
+	frameGraph.setImage(depthResource, depthImage.image, depthImageView, swapChainExtent);
+	frameGraph.setSecondaryContents(mainPass, drawChunkCount != 0);
+	if (depthPrepass)
+		frameGraph.setSecondaryContents(depthPrepassPass, drawChunkCount != 0);
+
+	// secondary command buffers only count towards a query they inherit
+	bool statistics = overdrawSupported && (drawChunkCount == 0 || enabledFeatures.inheritedQueries);
+	statisticsRecorded[currentFrame] = statistics;
+	if (statistics)
+	{
+		vkCmdResetQueryPool(commandBuffer, statisticsQueryPool, currentFrame, 1);
+		vkCmdBeginQuery(commandBuffer, statisticsQueryPool, currentFrame, 0);
+	}
+
+	frameGraph.execute(commandBuffer);
+
+	if (statistics)
+		vkCmdEndQuery(commandBuffer, statisticsQueryPool, currentFrame);
+
+	if (gpuTimingSupported)
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 2 * currentFrame + 1);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("cannot end command buffer");
+}
+
+void Renderer::recordDraws(VkCommandBuffer commandBuffer, const DrawCommand* draws, uint32_t count, bool depthOnly)
+{
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = float(swapChainExtent.width);
+	viewport.height = float(swapChainExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = swapChainExtent;
+
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	// every pipeline shares the layout, so this survives pipeline switches
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameDescriptorSet, 0, nullptr);
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	// the pipeline the draws asked for, which the depth-only variant stands in for
+	VkPipeline requestedPipeline = VK_NULL_HANDLE;
+	bool skipping = false;
+	VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+	VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+	const void* boundPushConstants = nullptr;
+	uint32_t boundMaterialIndex = UINT32_MAX;
+	uint32_t boundUniformOffset = UINT32_MAX;
+	VkBuffer boundInstanceBuffer = VK_NULL_HANDLE;
+	VkDeviceSize boundInstanceOffset = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const DrawCommand& command = draws[i];
+
+		VkPipeline pipeline = command.pipeline != VK_NULL_HANDLE ? command.pipeline : graphicsPipeline.get();
+		if (pipeline != requestedPipeline)
+		{
+			requestedPipeline = pipeline;
+			if (depthOnly)
+				pipeline = getDepthOnlyPipeline(pipeline);
+
+			skipping = pipeline == VK_NULL_HANDLE;
+			if (!skipping && pipeline != boundPipeline)
+			{
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+				boundPipeline = pipeline;
+			}
+		}
+
+		if (skipping)
+			continue;
+
+		if (command.pushConstants != nullptr && command.pushConstants != boundPushConstants)
+		{
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				0, command.pushConstantSize, command.pushConstants);
+			boundPushConstants = command.pushConstants;
+		}
+
+		if (command.materialIndex != boundMaterialIndex)
+		{
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				materialIndexOffset, sizeof(uint32_t), &command.materialIndex);
+			boundMaterialIndex = command.materialIndex;
+		}
+
+		// only the object offset moves between draws, the frame one is fixed for the frame
+		if (command.uniformOffset != boundUniformOffset)
+		{
+			uint32_t offsets[] = { frameUniformOffset, command.uniformOffset };
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &uniformSet, 2, offsets);
+			boundUniformOffset = command.uniformOffset;
+		}
+
+		if (command.vertexBuffer != boundVertexBuffer && command.vertexBuffer != VK_NULL_HANDLE)
+		{
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &command.vertexBuffer, &offset);
+			boundVertexBuffer = command.vertexBuffer;
+		}
+
+		if (command.instanceBuffer != VK_NULL_HANDLE &&
+			(command.instanceBuffer != boundInstanceBuffer || command.instanceOffset != boundInstanceOffset))
+		{
+			VkDeviceSize rowSize = VkDeviceSize(command.instanceCount) * 4 * sizeof(float);
+			VkBuffer buffers[] = { command.instanceBuffer, command.instanceBuffer, command.instanceBuffer };
+			VkDeviceSize offsets[] = { command.instanceOffset, command.instanceOffset + rowSize, command.instanceOffset + 2 * rowSize };
+			vkCmdBindVertexBuffers(commandBuffer, 1, 3, buffers, offsets);
+			boundInstanceBuffer = command.instanceBuffer;
+			boundInstanceOffset = command.instanceOffset;
+		}
+
+		if (command.indexBuffer == VK_NULL_HANDLE)
+		{
+			vkCmdDraw(commandBuffer, command.vertexCount, command.instanceCount, command.firstVertex, command.firstInstance);
+			continue;
+		}
+
+		if (command.indexBuffer != boundIndexBuffer)
+		{
+			vkCmdBindIndexBuffer(commandBuffer, command.indexBuffer, 0, command.indexType);
+			boundIndexBuffer = command.indexBuffer;
+		}
+
+		if (command.cullingBatch >= 0)
+		{
+			// the batches that follow with the same state draw together, whole runs as one draw
+			uint32_t batchCount = 1;
+			while (i + batchCount < count && draws[i + batchCount].cullingBatch == command.cullingBatch + int32_t(batchCount) &&
+				sameDrawState(draws[i + batchCount], command))
+				batchCount++;
+
+			gpuCuller.recordDraws(commandBuffer, currentFrame, command.cullingBatch, batchCount);
+			// the culler bound its own instance buffers
+			boundInstanceBuffer = VK_NULL_HANDLE;
+			i += batchCount - 1;
+			continue;
+		}
+
+		vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex,
+			command.vertexOffset, command.firstInstance);
+	}
+}
+
+void Renderer::recordMainPass(VkCommandBuffer commandBuffer)
+{
+	recordDrawList(commandBuffer, mainPass);
+}
+
+void Renderer::recordDepthPrepass(VkCommandBuffer commandBuffer)
+{
+	recordDrawList(commandBuffer, depthPrepassPass);
+}
+
+void Renderer::recordDrawList(VkCommandBuffer commandBuffer, RenderGraph::Pass pass)
+{
+	bool depthOnly = depthPrepass && pass == depthPrepassPass;
+	uint32_t drawCount = drawList.size();
+	uint32_t chunkCount = drawChunkCount;
+	if (chunkCount == 0)
+	{
+		recordDraws(commandBuffer, drawList.data(), drawCount, depthOnly);
+		return;
+	}
+
+	// more chunks than threads so that stealing can even out uneven chunks; the buffers
+	// of an earlier pass were already handed to vkCmdExecuteCommands
+	secondaryCommandBuffers.resize(chunkCount);
+	JobSystem::parallelFor(chunkCount, recordingThreads, [pass, drawCount, chunkCount](uint32_t chunk) {
+		uint32_t firstDraw = uint64_t(drawCount) * chunk / chunkCount;
+		uint32_t lastDraw = uint64_t(drawCount) * (chunk + 1) / chunkCount;
+		secondaryCommandBuffers[chunk] = recordSecondaryCommandBuffer(pass, firstDraw, lastDraw - firstDraw);
+	});
+
+	vkCmdExecuteCommands(commandBuffer, chunkCount, secondaryCommandBuffers.data());
+}
+
+VkCommandBuffer Renderer::recordSecondaryCommandBuffer(RenderGraph::Pass pass, uint32_t firstDraw, uint32_t drawCount)
+{
+	// every thread owns its pool for this frame, so no locking is needed
+	RecordingPool& recordingPool = recordingPools[currentFrame][JobSystem::getThreadIndex()];
+
+	if (recordingPool.used == recordingPool.commandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = recordingPool.pool;
+		allocInfo.commandBufferCount = 1;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("cannot create secondary command buffer");
+
+		recordingPool.commandBuffers.push_back(commandBuffer);
+	}
+
+	VkCommandBuffer commandBuffer = recordingPool.commandBuffers[recordingPool.used++];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = frameGraph.getRenderPass(pass);
+	inheritanceInfo.subpass = frameGraph.getSubpass(pass);
+	inheritanceInfo.framebuffer = frameGraph.getFramebuffer(pass);
+	if (statisticsRecorded[currentFrame])
+		inheritanceInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("cannot begin secondary command buffer");
+
+	recordDraws(commandBuffer, drawList.data() + firstDraw, drawCount, depthPrepass && pass == depthPrepassPass);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("cannot end secondary command buffer");
+
+	return commandBuffer;
+}
+
+void Renderer::createRecordingPools()
+{
+	// workers plus the render thread itself
+	uint32_t threadCount = JobSystem::getThreadCount() + 1;
+	recordingPools.resize(maxFramesInFlight);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamilies.graphicsFamily.value();
+
+	for (auto& framePools : recordingPools)
+	{
+		framePools.resize(threadCount);
+		for (auto& recordingPool : framePools)
+		{
+			if (vkCreateCommandPool(device, &poolInfo, nullptr, &recordingPool.pool) != VK_SUCCESS)
+				throw std::runtime_error("cannot create command pool");
+		}
+	}
+}
+
+void Renderer::resetRecordingPools()
+{
+	for (auto& recordingPool : recordingPools[currentFrame])
+	{
+		if (recordingPool.used == 0)
+			continue;
+
+		vkResetCommandPool(device, recordingPool.pool, 0);
+		recordingPool.used = 0;
 	}
 }
 
@@ -730,23 +2253,21 @@ void Renderer::createSyncObjects()
 {
 	imageAvailableSemaphores.resize(maxFramesInFlight);
 	renderingFinishedSemaphores.resize(maxFramesInFlight);
-	inFlightFences.resize(maxFramesInFlight);
-	imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
+	imageLastUse.assign(swapChainImages.size(), 0);
 
+	// the binary semaphores are for the swapchain, which takes no timeline semaphores
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 	for (size_t i = 0; i < maxFramesInFlight; i++)
 	{
 		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderingFinishedSemaphores[i]) != VK_SUCCESS ||
-			vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderingFinishedSemaphores[i]) != VK_SUCCESS)
 			throw  std::runtime_error("failed to create synchronization objects for the frame!");
 	}
+
+	frameTimeline.init(device, timelineSemaphoreSupported);
+	std::cout << (timelineSemaphoreSupported ? "frames tracked with a timeline semaphore" : "frames tracked with fences") << std::endl;
 }
 
 void Renderer::DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) {
@@ -796,6 +2317,7 @@ VkSurfaceKHR Renderer::surface;
 VkQueue Renderer::graphicsQueue;
 
 VkQueue Renderer::presentQueue;
+VkQueue Renderer::transferQueue;
 
 VkSwapchainKHR Renderer::swapChain;
 
@@ -804,12 +2326,72 @@ VkFormat Renderer::swapChainImageFormat;
 VkExtent2D Renderer::swapChainExtent;
 
 VkPipelineLayout Renderer::pipelineLayout;
+LayoutCache Renderer::layoutCache;
 
 VkRenderPass Renderer::renderPass;
-
-VkPipeline Renderer::graphicsPipeline;
-
-VkCommandPool Renderer::commandPool;
+RenderGraph Renderer::frameGraph;
+RenderGraph::Resource Renderer::backbufferResource = 0;
+RenderGraph::Pass Renderer::mainPass = 0;
+RenderGraph::Pass Renderer::depthPrepassPass = 0;
+uint32_t Renderer::drawChunkCount = 0;
+bool Renderer::depthPrepass = false;
+VkFormat Renderer::depthFormat = VK_FORMAT_UNDEFINED;
+Image Renderer::depthImage;
+VkImageView Renderer::depthImageView = VK_NULL_HANDLE;
+RenderGraph::Resource Renderer::depthResource = 0;
+
+PipelineHandle Renderer::graphicsPipeline;
+
+std::vector<VkCommandPool> Renderer::commandPools;
+
+PipelineCache Renderer::pipelineCache;
+MemoryAllocator Renderer::memoryAllocator;
+UploadManager Renderer::uploadManager;
+LinearAllocator Renderer::frameAllocator;
+uint64_t Renderer::frameAllocatorFrame = UINT64_MAX;
+
+PipelineCompiler Renderer::pipelineCompiler;
+bool Renderer::shaderHotReload = false;
+ShaderWatcher Renderer::shaderWatcher;
+const std::vector<ShaderCompiler::Target> Renderer::shaderTargets = {
+	{ "assets/shaders/shader.vert", "assets/shaders/vert.spv", {} },
+	{ "assets/shaders/shader.frag", "assets/shaders/frag.spv", {} },
+	{ "assets/shaders/mesh.vert", "assets/shaders/mesh_vert.spv", {} },
+	{ "assets/shaders/packed_mesh.vert", "assets/shaders/packed_mesh_vert.spv", {} },
+	{ "assets/shaders/instanced.vert", "assets/shaders/instanced_mesh_vert.spv", {} },
+	{ "assets/shaders/instanced.vert", "assets/shaders/instanced_packed_mesh_vert.spv", { "PACKED" } },
+	{ "assets/shaders/cull.comp", "assets/shaders/cull_comp.spv", {} },
+};
+std::vector<Renderer::ShaderJob> Renderer::shaderJobs(Renderer::shaderTargets.size());
+GpuCuller Renderer::gpuCuller;
+bool Renderer::gpuCullingSupported = false;
+VkPhysicalDeviceFeatures Renderer::enabledFeatures{};
+PFN_vkCmdDrawIndexedIndirectCountKHR Renderer::drawIndexedIndirectCount = nullptr;
+bool Renderer::gpuCullingEnabled = true;
+bool Renderer::descriptorIndexingSupported = false;
+BindlessDescriptors::Capacity Renderer::bindlessCapacity{};
+BindlessDescriptors Renderer::bindlessDescriptors;
+VkDescriptorSet Renderer::frameDescriptorSet = VK_NULL_HANDLE;
+Buffer Renderer::defaultBuffer;
+Image Renderer::defaultTexture;
+VkImageView Renderer::defaultTextureView = VK_NULL_HANDLE;
+VkSampler Renderer::defaultSampler = VK_NULL_HANDLE;
+uint32_t Renderer::apiVersion = VK_API_VERSION_1_0;
+VkDescriptorSetLayout Renderer::uniformSetLayout = VK_NULL_HANDLE;
+VkDescriptorPool Renderer::uniformPool = VK_NULL_HANDLE;
+VkDescriptorSet Renderer::uniformSet = VK_NULL_HANDLE;
+VkDeviceSize Renderer::uniformAlignment = 256;
+VkDeviceSize Renderer::uniformRange = Renderer::maxUniformRange;
+uint32_t Renderer::frameUniformOffset = 0;
+CpuCuller Renderer::cpuCuller;
+InstanceBatch Renderer::cpuCulledInstances;
+CullingStats Renderer::cpuCullingStats;
+double Renderer::cpuCullingTime = 0.0;
+OcclusionBuffer Renderer::occlusionBuffer;
+bool Renderer::occlusionCulling = false;
+
+const std::string Renderer::pipelineCachePath = "pipeline_cache.bin";
+const std::string Renderer::permutationManifestPath = "assets/shaders/permutations.txt";
 
 Renderer::QueueFamilyIndices Renderer::queueFamilies;
 
@@ -825,18 +2407,57 @@ std::vector<VkImage> Renderer::swapChainImages;
 
 std::vector<VkImageView> Renderer::swapChainImageViews;
 
-std::vector<VkFramebuffer> Renderer::swapChainFramebuffers;
 
 std::vector<VkCommandBuffer> Renderer::commandBuffers;
 
+std::vector<DrawCommand> Renderer::drawList;
+
+std::vector<std::vector<Renderer::RecordingPool>> Renderer::recordingPools;
+
+std::vector<VkCommandBuffer> Renderer::secondaryCommandBuffers;
+
+uint32_t Renderer::recordingThreads = 1;
+
 std::vector<VkSemaphore> Renderer::imageAvailableSemaphores;
 
 std::vector<VkSemaphore> Renderer::renderingFinishedSemaphores;
 
-std::vector<VkFence> Renderer::inFlightFences;
+GpuTimeline Renderer::frameTimeline;
+bool Renderer::timelineSemaphoreSupported = false;
 
-std::vector<VkFence> Renderer::imagesInFlight;
+std::vector<uint64_t> Renderer::imageLastUse;
+
+VkQueryPool Renderer::timestampQueryPool;
+
+bool Renderer::gpuTimingSupported = false;
+
+float Renderer::timestampPeriod = 1.0f;
+
+FrameTimings Renderer::lastFrameTimings;
+VkQueryPool Renderer::statisticsQueryPool = VK_NULL_HANDLE;
+bool Renderer::overdrawSupported = false;
+std::vector<bool> Renderer::statisticsRecorded;
 
 uint32_t Renderer::currentFrame = 0;
 
-uint32_t Renderer::maxFramesInFlight = 2;
+bool Renderer::swapChainOutdated = false;
+
+DeletionQueue Renderer::deletionQueue;
+
+uint64_t Renderer::frameNumber = 0;
+
+bool Renderer::headless = false;
+
+std::vector<Image> Renderer::offscreenImages;
+std::vector<VkSemaphore> Renderer::submitWaitSemaphores;
+std::vector<VkPipelineStageFlags> Renderer::submitWaitStages;
+
+uint32_t Renderer::offscreenImageIndex = 0;
+
+uint32_t Renderer::maxFramesInFlight = 3;
+uint32_t Renderer::framesInFlight = 2;
+Renderer::LatencyMode Renderer::latencyMode = Renderer::LatencyMode::Balanced;
+double Renderer::targetFrameTime = 0.0;
+std::chrono::steady_clock::time_point Renderer::nextFrameTime;
+std::optional<std::chrono::steady_clock::time_point> Renderer::pendingInputTime;
+std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>> Renderer::frameInputs;
@@ -1,16 +1,234 @@
 #pragma once
 #include "vulkan/vulkan.h"
 #include "GLFW/glfw3.h"
+#include "PipelineCache.h"
+#include "PipelineCompiler.h"
+#include "MemoryAllocator.h"
+#include "UploadManager.h"
+#include "Mesh.h"
+#include "MeshFormat.h"
+#include "LinearAllocator.h"
+#include "InstanceBatch.h"
+#include "GpuCuller.h"
+#include "CpuCuller.h"
+#include "BindlessDescriptors.h"
+#include "RenderGraph.h"
+#include "ShaderCompiler.h"
+#include "ShaderWatcher.h"
+#include "GpuTimeline.h"
+#include "DeletionQueue.h"
 #include <vector>
 #include <optional>
 #include <string>
+#include <algorithm>
+#include <future>
+#include <deque>
+#include <chrono>
+
+// A draw recorded into the next frame. A null pipeline draws with the built-in pipeline;
+// with an index buffer the draw is indexed and vertexCount is ignored. Push constants
+// are read when the frame is recorded, so they have to outlive draw(). With the depth
+// pre-pass only pipelines from requestPipeline() are drawn, the others have no
+// depth-only variant and fail the main pass's EQUAL test.
+struct DrawCommand
+{
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	const void* pushConstants = nullptr;
+	uint32_t pushConstantSize = 0;
+	// three arrays of instanceCount vec4 transform rows, back to back from instanceOffset
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	VkDeviceSize instanceOffset = 0;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 1;
+	uint32_t firstVertex = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+	// a GpuCuller batch that supplies the draws through indirect commands, -1 for none
+	int32_t cullingBatch = -1;
+	// dynamic offset of the draw's object constants from Renderer::allocateUniforms
+	uint32_t uniformOffset = 0;
+	// pushed at Renderer::materialIndexOffset for shaders indexing the bindless arrays
+	uint32_t materialIndex = 0;
+};
+
+// all times in milliseconds
+struct FrameTimings
+{
+	double fenceWait = 0.0;
+	double acquire = 0.0;
+	double submit = 0.0;
+	double present = 0.0;
+	double record = 0.0;
+	uint32_t drawCount = 0;
+	// GPU time of the render pass of an earlier frame, resolved once its fence signalled
+	double gpu = 0.0;
+	bool gpuValid = false;
+	// culling results, of the same earlier frame with GPU culling and of this frame on the
+	// CPU; culledObjects includes the occluded ones
+	uint32_t culledObjects = 0;
+	uint32_t visibleObjects = 0;
+	uint32_t occludedObjects = 0;
+	bool cullingValid = false;
+	// CPU culling time of this frame
+	double culling = 0.0;
+	// fragment shader invocations per pixel of the same earlier frame as gpu; 1 means
+	// every pixel was shaded once
+	double overdraw = 0.0;
+	bool overdrawValid = false;
+	// spent at the end of draw() holding the frame to the latency mode and target frame time
+	double pacing = 0.0;
+	// from Renderer::markInput() until the rendering of the frame that consumed it completed,
+	// for the latest frame found complete during this draw(); the image may still wait to
+	// be displayed. Exact with one frame in flight, otherwise late by up to a frame
+	double inputLatency = 0.0;
+	bool inputLatencyValid = false;
+};
 
 class Renderer
 {
 public:
 	static void init(GLFWwindow* windowPointer);
+	static void initHeadless(uint32_t width, uint32_t height);
 	static void draw();
 	static void shutdown();
+	static void waitIdle() { vkDeviceWaitIdle(device); }
+	static void onFramebufferResized() { swapChainOutdated = true; }
+
+	// queues a draw for the next draw() call; render thread only
+	static void submit(const DrawCommand& command) { drawList.push_back(command); }
+	// the mesh has to outlive draw()
+	static void submit(const Mesh& mesh, VkPipeline pipeline, uint32_t instanceCount = 1);
+	// one indexed draw for every instance; the transforms are composed on the job system
+	// straight into this frame's memory
+	static void submitInstanced(const Mesh& mesh, VkPipeline pipeline, const InstanceBatch& instances);
+	// like submitInstanced, but only instances whose bounding sphere intersects the frustum
+	// are drawn; culled by a compute pass where the device supports it, otherwise on the
+	// job system before recording
+	static void submitCulled(const Mesh& mesh, VkPipeline pipeline, const InstanceBatch& instances);
+	static bool isGpuCullingSupported() { return gpuCullingSupported; }
+	// false culls on the CPU even where the GPU could
+	static void setGpuCulling(bool enabled) { gpuCullingEnabled = enabled; }
+	// planes as (normal, distance) in clip space, the normals pointing inside
+	static void setCullingFrustum(const float planes[6][4])
+	{
+		gpuCuller.setFrustum(planes);
+		cpuCuller.setFrustum(planes);
+	}
+	// CPU culling also tests against the occluders of the frame
+	static void setOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+	// occluders are added per frame before submitCulled and cleared by draw()
+	static OcclusionBuffer& getOcclusionBuffer() { return occlusionBuffer; }
+	// host-visible memory valid until this frame slot comes around again; render thread only
+	static LinearAllocator::Suballocation allocateFrameMemory(VkDeviceSize size, VkDeviceSize alignment);
+	// frame memory for set 1, binding 1; the offset goes into DrawCommand::uniformOffset
+	static LinearAllocator::Suballocation allocateUniforms(VkDeviceSize size);
+	// copied into frame memory and read through set 1, binding 0 by every draw of the frame
+	static void setFrameUniforms(const void* data, VkDeviceSize size);
+	// 1 records inline on the render thread, more splits large draw lists into secondary
+	// command buffers recorded in parallel on the job system
+	static void setRecordingThreads(uint32_t threadCount) { recordingThreads = std::max(1u, threadCount); }
+	// before init: lay down depth in a depth-only pass first and shade only the fragments
+	// that match it; the frame graph and every pipeline are built for one of the modes
+	static void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+	static bool isDepthPrepassEnabled() { return depthPrepass; }
+	static VkFormat getDepthFormat() { return depthFormat; }
+	// after init: recompiles edited GLSL in assets/shaders on the job system and swaps the
+	// pipelines built from it between frames; a shader that fails to compile or link keeps
+	// the pipelines running as they were
+	static void setShaderHotReload(bool enabled);
+
+	// how far frames may queue up between input and display. Every mode can be switched
+	// to at any time: per-frame resources exist for the deepest one, and the swapchain is
+	// recreated with the mode's present mode and image count before the next frame
+	enum class LatencyMode
+	{
+		// one frame in flight and the fewest images; MAILBOX, else IMMEDIATE, else FIFO
+		LowLatency,
+		// two frames in flight and one spare image; MAILBOX, else FIFO
+		Balanced,
+		// every frame slot in flight and two spare images; IMMEDIATE first, as batch
+		// renders do not mind tearing
+		Throughput,
+	};
+	static void setLatencyMode(LatencyMode mode);
+	static LatencyMode getLatencyMode() { return latencyMode; }
+	// draw() returns at most once per target frame time, 0 leaves frames unpaced; it sleeps
+	// before returning so that the caller samples input for the next frame late
+	static void setTargetFrameTime(double milliseconds) { targetFrameTime = milliseconds; }
+	// when the input the next draw() renders was sampled, see FrameTimings::inputLatency
+	static void markInput(std::chrono::steady_clock::time_point time) { pendingInputTime = time; }
+
+	static const FrameTimings& getLastFrameTimings() { return lastFrameTimings; }
+	// a resource last used by the frames submitted so far is free once the completed count
+	// reaches the submitted one; completed frames can be read from any thread and never block
+	static uint64_t getSubmittedFrameCount() { return frameNumber; }
+	static uint64_t getCompletedFrameCount() { return frameTimeline.getCompletedValue(); }
+	// destroys objects once the frames that use them completed; retire them with
+	// getSubmittedFrameCount() after recording them for the last time
+	static DeletionQueue& getDeletionQueue() { return deletionQueue; }
+	static std::string getDeviceName();
+	static MemoryAllocator& getMemoryAllocator() { return memoryAllocator; }
+	static const PipelineCompiler& getPipelineCompiler() { return pipelineCompiler; }
+	// culling, the depth pre-pass and the main pass; compiled at startup, for inspection
+	static const RenderGraph& getFrameGraph() { return frameGraph; }
+	// set 0 of every graphics pipeline, bound once per command buffer
+	static BindlessDescriptors& getBindlessDescriptors() { return bindlessDescriptors; }
+	// the last four bytes of the shared push constant range hold DrawCommand::materialIndex
+	static const uint32_t materialIndexOffset = 124;
+
+	// description of the built-in pipeline, a starting point for variants
+	static GraphicsPipelineDesc getDefaultPipelineDesc();
+	// the built-in pipeline fed from the Vertex layout
+	static GraphicsPipelineDesc getMeshPipelineDesc();
+	// for PackedVertex meshes, dequantized from push constants
+	static GraphicsPipelineDesc getPackedMeshPipelineDesc();
+	// mesh pipelines that also read per-instance transforms
+	static GraphicsPipelineDesc getInstancedPipelineDesc(Mesh::VertexFormat vertexFormat);
+
+	// features of shader.frag chosen per pipeline through specialization constants, so one
+	// SPIR-V serves every combination and each pipeline carries only what it uses
+	enum class LightingModel : uint32_t
+	{
+		Unlit = 0,
+		// facet normals from screen-space derivatives of the position
+		Flat = 1,
+	};
+	// the defaults are those of shader.frag
+	struct ShaderPermutation
+	{
+		LightingModel lighting = LightingModel::Unlit;
+		// discards fragments with a vertex colour alpha below the cutoff
+		bool alphaTest = false;
+		float alphaCutoff = 0.5f;
+	};
+	static void applyPermutation(GraphicsPipelineDesc& desc, const ShaderPermutation& permutation);
+	// compiled on the job system; the built-in pipeline stands in until they are ready
+	static PipelineHandle requestPipeline(const GraphicsPipelineDesc& desc);
+	static std::vector<PipelineHandle> requestPipelines(const std::vector<GraphicsPipelineDesc>& descs);
+
+	// device-local buffer filled through the staging ring; usable by draws submitted after this call.
+	// Without data it is left empty for streamUpload
+	static Buffer createDeviceBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage);
+	// copies one chunk of at most getUploadChunkSize() bytes without waiting for ring space;
+	// false if there is none this frame. Usable by draws submitted after it returned true
+	static bool streamUpload(const Buffer& dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	static VkDeviceSize getUploadChunkSize() { return uploadManager.getMaxChunkSize(); }
+	// without upload only the buffers are created, the vertices and indices follow
+	// through streamUpload
+	static Mesh createMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool upload = true);
+	// uploads straight from the file view, typically a memory mapping
+	static Mesh createMesh(const MeshFileView& file, bool upload = true);
+	// the buffers are freed once the frames submitted so far and the next one, which
+	// flushes and waits for the mesh's last copies, completed; the mesh must not be drawn
+	// again
+	static void destroyMesh(Mesh& mesh);
+
+	static std::vector<char> readFile(const std::string& path);
 
 private:
 
@@ -28,10 +246,22 @@ private:
 	static void pickPhysicalDevice();
 	static bool checkQueueFamilies(VkPhysicalDevice device);
 	static void createLogicalDevice();
-	static void createSwapChain();
+	static void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+	static bool recreateSwapChain();
+	static void updateShaderReload();
+	static void reloadCullingPipelines();
+	// frame limit, pacing and input latency once the frame was handed off
+	static void endFrame(FrameTimings& timings);
+	static void resolveInputLatency(FrameTimings& timings);
+	// until at most framesAhead submitted frames are still running
+	static void waitForFrames(uint32_t framesAhead);
+	static void createOffscreenTargets(uint32_t width, uint32_t height);
+	static VkFormat chooseDepthFormat();
+	static void createDepthTarget();
 
 	static SwapChainCapabilities getSwapChainCapabilities();
 	static VkPresentModeKHR chooseSwapChainPresentMode(const std::vector<VkPresentModeKHR>& presentModes);
+	static uint32_t chooseSwapChainImageCount(const VkSurfaceCapabilitiesKHR& capabilities);
 	static VkSurfaceFormatKHR chooseSwapChainFormat(const std::vector<VkSurfaceFormatKHR>& formats);
 	static VkExtent2D chooseSwapChainExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 	static bool checkDeviceRequirements(VkPhysicalDevice device);
@@ -45,11 +275,32 @@ private:
 
 	static void createSwapChainImageViews();
 	static void createGraphicsPipeline();
-	static VkShaderModule createShaderModule(const std::vector<char>& code);
-	static std::vector<char> readFile(const std::string& path);
-	static void createRenderPass();
-	static void createFramebuffers();
-	static void createCommandPool();
+	static void createFrameGraph();
+	static void createCommandPools();
+	static void createQueryPool();
+	static void createStatisticsQueryPool();
+	static void createCullers();
+	static void createBindlessDescriptors();
+	static void createUniformSet();
+	static LayoutCache::SetLayoutDesc getUniformSetLayoutDesc();
+	static LinearAllocator::Suballocation composeInstanceTransforms(const InstanceBatch& instances);
+	static void clearDrawList();
+	static bool readGpuTimestamps(uint32_t frameIndex, double& gpuTime);
+	static bool readOverdraw(uint32_t frameIndex, double& overdraw);
+	static GraphicsPipelineDesc getDepthOnlyPipelineDesc(const GraphicsPipelineDesc& desc);
+	// requests the pipelines listed in the manifest, so the ones requested later are hits
+	static void prewarmPipelines(const std::string& manifestPath);
+	static VkPipeline getDepthOnlyPipeline(VkPipeline pipeline);
+	static void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	static void recordMainPass(VkCommandBuffer commandBuffer);
+	static void recordDepthPrepass(VkCommandBuffer commandBuffer);
+	static void recordDrawList(VkCommandBuffer commandBuffer, RenderGraph::Pass pass);
+	static void recordDraws(VkCommandBuffer commandBuffer, const DrawCommand* draws, uint32_t count, bool depthOnly);
+	// everything recordDraws binds for a draw besides its instance buffers
+	static bool sameDrawState(const DrawCommand& a, const DrawCommand& b);
+	static VkCommandBuffer recordSecondaryCommandBuffer(RenderGraph::Pass pass, uint32_t firstDraw, uint32_t drawCount);
+	static void createRecordingPools();
+	static void resetRecordingPools();
 	static void createCommandBuffers();
 	static void createSyncObjects();
 
@@ -63,33 +314,170 @@ private:
 	static VkSurfaceKHR surface;
 	static VkQueue graphicsQueue;
 	static VkQueue presentQueue;
+	static VkQueue transferQueue;
+	// negotiated with the loader, 1.2 where available
+	static uint32_t apiVersion;
 
 	static VkSwapchainKHR swapChain;
 	static VkFormat swapChainImageFormat;
 	static VkExtent2D swapChainExtent;
+	// owns every descriptor set and pipeline layout; pipelineLayout is the one shared by
+	// graphics pipelines whose shaders need nothing beyond sets 0 and 1
+	static LayoutCache layoutCache;
 	static VkPipelineLayout pipelineLayout;
+	// the main pass's render pass, owned by the frame graph
 	static VkRenderPass renderPass;
-	static VkPipeline graphicsPipeline;
-	static VkCommandPool commandPool;
+	static RenderGraph frameGraph;
+	static RenderGraph::Resource backbufferResource;
+	static RenderGraph::Pass mainPass;
+	static RenderGraph::Pass depthPrepassPass;
+	// secondary command buffers each pass over the draw list records this frame, 0 records inline
+	static uint32_t drawChunkCount;
+	// a handle so that reloads of the built-in shaders reach the pipelines falling back to it
+	static PipelineHandle graphicsPipeline;
+	static bool depthPrepass;
+	// sized with the swapchain and retired with it; scratch memory to the frame graph
+	static VkFormat depthFormat;
+	static Image depthImage;
+	static VkImageView depthImageView;
+	static RenderGraph::Resource depthResource;
+	static PipelineCache pipelineCache;
+	static MemoryAllocator memoryAllocator;
+	static UploadManager uploadManager;
+	static LinearAllocator frameAllocator;
+	// frameNumber the frame allocator was last rewound for
+	static uint64_t frameAllocatorFrame;
+	static const VkDeviceSize frameMemorySize = 32ull * 1024 * 1024;
+	// set 1: frame and object constants as dynamic uniform buffers over the frame memory
+	static VkDescriptorSetLayout uniformSetLayout;
+	static VkDescriptorPool uniformPool;
+	static VkDescriptorSet uniformSet;
+	static VkDeviceSize uniformAlignment;
+	// the range both bindings expose from their dynamic offset
+	static VkDeviceSize uniformRange;
+	static uint32_t frameUniformOffset;
+	static const VkDeviceSize maxUniformRange = 64 * 1024;
+	// transforms per job when composing instance batches
+	static const uint32_t instancesPerJob = 4096;
+	static PipelineCompiler pipelineCompiler;
+	static bool shaderHotReload;
+	static ShaderWatcher shaderWatcher;
+	// the lines of compile.bat
+	static const std::vector<ShaderCompiler::Target> shaderTargets;
+	// one per target, a target never has two compiles writing its output at once; a change
+	// while one runs is compiled after it
+	struct ShaderJob
+	{
+		// whether the output was written
+		std::future<bool> compile;
+		bool pending = false;
+	};
+	static std::vector<ShaderJob> shaderJobs;
+	static GpuCuller gpuCuller;
+	static bool gpuCullingSupported;
+	static VkPhysicalDeviceFeatures enabledFeatures;
+	static PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount;
+	static bool gpuCullingEnabled;
+	static CpuCuller cpuCuller;
+	// the visible instances of the last CPU culled batch
+	static InstanceBatch cpuCulledInstances;
+	static CullingStats cpuCullingStats;
+	static double cpuCullingTime;
+	static OcclusionBuffer occlusionBuffer;
+	static bool occlusionCulling;
+	static bool descriptorIndexingSupported;
+	static BindlessDescriptors::Capacity bindlessCapacity;
+	static BindlessDescriptors bindlessDescriptors;
+	static VkDescriptorSet frameDescriptorSet;
+	// what unused bindless slots point at
+	static Buffer defaultBuffer;
+	static Image defaultTexture;
+	static VkImageView defaultTextureView;
+	static VkSampler defaultSampler;
+	static const uint32_t occlusionBufferWidth = 256;
+	static const uint32_t occlusionBufferHeight = 144;
+	// array sizes of the bindless set, further limited by the device
+	static const uint32_t maxBindlessBuffers = 16384;
+	static const uint32_t maxBindlessTextures = 16384;
+	static const uint32_t fallbackBindlessBuffers = 16;
+	static const uint32_t fallbackBindlessTextures = 64;
+	// one transient pool per frame in flight, reset wholesale before re-recording
+	static std::vector<VkCommandPool> commandPools;
 	
 	struct  QueueFamilyIndices
 	{
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		// a family without graphics, which usually maps to a DMA engine
+		std::optional<uint32_t> transferFamily;
+		// culling dispatches are recorded next to the draws that consume them, so this is
+		// the graphics family when it supports compute
+		std::optional<uint32_t> computeFamily;
 	};
 
+	// in headless mode this holds the offscreen ring instead of swapchain images
 	static std::vector<VkImage> swapChainImages;
 	static std::vector<VkImageView> swapChainImageViews;
-	static std::vector<VkFramebuffer> swapChainFramebuffers;
 	static std::vector<VkCommandBuffer> commandBuffers;
+	static std::vector<DrawCommand> drawList;
+
+	// secondary command buffers of one recording thread for one frame in flight
+	struct RecordingPool
+	{
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> commandBuffers;
+		uint32_t used = 0;
+	};
+
+	// [frame in flight][job system thread index]
+	static std::vector<std::vector<RecordingPool>> recordingPools;
+	static std::vector<VkCommandBuffer> secondaryCommandBuffers;
+	static uint32_t recordingThreads;
+	// below this a chunk costs more in overhead than it saves
+	static const uint32_t minDrawsPerChunk = 1024;
 
 	static std::vector<VkSemaphore> imageAvailableSemaphores;
 	static std::vector<VkSemaphore> renderingFinishedSemaphores;
-	static std::vector<VkFence> inFlightFences;
-	static std::vector<VkFence> imagesInFlight;
+	// frame n signals n + 1 when it completes, so the value counts completed frames
+	static GpuTimeline frameTimeline;
+	static bool timelineSemaphoreSupported;
+	// value of the last frame that rendered to each swapchain image
+	static std::vector<uint64_t> imageLastUse;
+	static std::vector<VkSemaphore> submitWaitSemaphores;
+	static std::vector<VkPipelineStageFlags> submitWaitStages;
+
+	static bool swapChainOutdated;
+	static DeletionQueue deletionQueue;
+	// number of frames submitted so far
+	static uint64_t frameNumber;
+
+	static bool headless;
+	static std::vector<Image> offscreenImages;
+	static uint32_t offscreenImageIndex;
+	static const uint32_t offscreenImageCount = 3;
+
+	static VkQueryPool timestampQueryPool;
+	static bool gpuTimingSupported;
+	static float timestampPeriod;
+	static FrameTimings lastFrameTimings;
+	// fragment shader invocations of the frame's passes, one query per frame in flight
+	static VkQueryPool statisticsQueryPool;
+	static bool overdrawSupported;
+	// whether the frame slot's query was recorded; queries cannot be inherited by
+	// secondary command buffers without the inheritedQueries feature
+	static std::vector<bool> statisticsRecorded;
 
 	static uint32_t currentFrame;
+	// per-frame resources are created for this many frames
 	static uint32_t maxFramesInFlight;
+	// frames the latency mode lets the CPU run ahead, at most maxFramesInFlight
+	static uint32_t framesInFlight;
+	static LatencyMode latencyMode;
+	static double targetFrameTime;
+	static std::chrono::steady_clock::time_point nextFrameTime;
+	static std::optional<std::chrono::steady_clock::time_point> pendingInputTime;
+	// frame timeline values with the input their frame consumed, oldest first
+	static std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>> frameInputs;
 	static QueueFamilyIndices queueFamilies;
 
 #ifdef NDEBUG
@@ -98,6 +486,13 @@ private:
 	static const bool validationLayersEnabled = true;
 #endif
 
+	static const std::string pipelineCachePath;
+	// one pipeline per line: a vertex format followed by the permutation's features
+	static const std::string permutationManifestPath;
+	// constant_ids in shader.frag
+	static const uint32_t lightingConstant = 0;
+	static const uint32_t alphaTestConstant = 1;
+	static const uint32_t alphaCutoffConstant = 2;
 	static const std::vector<const char*> validationLayers;
 	static const std::vector<const char*> requiredExtensions;
 
@@ -0,0 +1,84 @@
+#include "ShaderCompiler.h"
+#include <stdexcept>
+#include <filesystem>
+#include <fstream>
+#include <cstdio>
+
+#ifdef RENDERER_SHADERC
+#include <shaderc/shaderc.hpp>
+#include "Renderer.h"
+#endif
+
+void ShaderCompiler::compile(const Target& target)
+{
+	std::string temporary = target.output + ".tmp";
+
+#ifdef RENDERER_SHADERC
+	shaderc_shader_kind kind;
+	std::string extension = std::filesystem::path(target.source).extension().string();
+	if (extension == ".vert")
+		kind = shaderc_glsl_vertex_shader;
+	else if (extension == ".frag")
+		kind = shaderc_glsl_fragment_shader;
+	else if (extension == ".comp")
+		kind = shaderc_glsl_compute_shader;
+	else
+		throw std::runtime_error("unknown shader stage of " + target.source);
+
+	shaderc::CompileOptions options;
+	for (const auto& define : target.defines)
+		options.AddMacroDefinition(define);
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+	std::vector<char> source = Renderer::readFile(target.source);
+
+	// one compiler per call, shaderc compilers are not thread-safe
+	shaderc::Compiler compiler;
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source.data(), source.size(), kind,
+		target.source.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+		throw std::runtime_error(result.GetErrorMessage());
+
+	std::ofstream file(temporary, std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("cannot write " + temporary);
+	file.write(reinterpret_cast<const char*>(result.cbegin()), (result.cend() - result.cbegin()) * sizeof(uint32_t));
+	file.close();
+#else
+	std::string command = "glslc";
+	for (const auto& define : target.defines)
+		command += " -D" + define;
+	command += " \"" + target.source + "\" -o \"" + temporary + "\" 2>&1";
+
+#ifdef _WIN32
+	FILE* process = _popen(command.c_str(), "r");
+#else
+	FILE* process = popen(command.c_str(), "r");
+#endif
+	if (!process)
+		throw std::runtime_error("cannot run glslc");
+
+	std::string messages;
+	char buffer[256];
+	while (fgets(buffer, sizeof(buffer), process))
+		messages += buffer;
+
+#ifdef _WIN32
+	int status = _pclose(process);
+#else
+	int status = pclose(process);
+#endif
+	if (status != 0)
+		throw std::runtime_error(messages.empty() ? "glslc failed" : messages);
+#endif
+
+	replaceFile(temporary, target.output);
+}
+
+void ShaderCompiler::replaceFile(const std::string& temporary, const std::string& path)
+{
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error)
+		throw std::runtime_error("cannot replace " + path + ": " + error.message());
+}
\ No newline at end of file
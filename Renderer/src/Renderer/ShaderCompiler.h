@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// GLSL to SPIR-V at runtime. Built with RENDERER_SHADERC it links the shaderc library,
+// otherwise it runs glslc from the PATH.
+class ShaderCompiler
+{
+public:
+	// one SPIR-V file and how it is built, mirroring a line of compile.bat
+	struct Target
+	{
+		std::string source;
+		std::string output;
+		std::vector<std::string> defines;
+	};
+
+	// throws with the compiler's messages; the output is replaced through a temporary
+	// file, so pipeline builds never read a partial one
+	static void compile(const Target& target);
+
+private:
+	static void replaceFile(const std::string& temporary, const std::string& path);
+};
\ No newline at end of file
@@ -0,0 +1,451 @@
+#include "ShaderReflection.h"
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+
+namespace
+{
+	const uint32_t spirvMagic = 0x07230203;
+	const uint32_t headerWords = 5;
+
+	// the subset of the SPIR-V specification reflection looks at
+	enum Op : uint32_t
+	{
+		OpEntryPoint = 15,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpSpecConstantTrue = 48,
+		OpSpecConstantFalse = 49,
+		OpSpecConstant = 50,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72,
+	};
+
+	enum Decoration : uint32_t
+	{
+		SpecId = 1,
+		Block = 2,
+		BufferBlock = 3,
+		RowMajor = 4,
+		ArrayStride = 6,
+		MatrixStride = 7,
+		BuiltIn = 11,
+		Location = 30,
+		Binding = 33,
+		DescriptorSet = 34,
+		Offset = 35,
+	};
+
+	enum StorageClass : uint32_t
+	{
+		UniformConstant = 0,
+		Input = 1,
+		Uniform = 2,
+		PushConstant = 9,
+		StorageBuffer = 12,
+	};
+
+	enum Dim : uint32_t
+	{
+		DimBuffer = 5,
+		DimSubpassData = 6,
+	};
+
+	const uint32_t none = UINT32_MAX;
+
+	struct Member
+	{
+		uint32_t offset = 0;
+		uint32_t matrixStride = 0;
+		bool rowMajor = false;
+		bool builtIn = false;
+	};
+
+	struct Id
+	{
+		uint32_t opcode = 0;
+		// index of the instruction's first word
+		uint32_t instruction = 0;
+
+		uint32_t set = none;
+		uint32_t binding = none;
+		uint32_t location = none;
+		uint32_t specId = none;
+		uint32_t arrayStride = 0;
+		bool block = false;
+		bool bufferBlock = false;
+		bool builtIn = false;
+		std::vector<Member> members;
+	};
+
+	class Module
+	{
+	public:
+		Module(const std::vector<char>& code)
+		{
+			if (code.size() % 4 != 0 || code.size() < headerWords * 4)
+				throw std::runtime_error("SPIR-V size is not a multiple of 4 bytes");
+
+			words.resize(code.size() / 4);
+			std::copy(code.begin(), code.end(), reinterpret_cast<char*>(words.data()));
+			if (words[0] != spirvMagic)
+				throw std::runtime_error("not a SPIR-V module");
+
+			ids.resize(words[3]);
+			for (uint32_t i = headerWords; i < words.size();)
+			{
+				uint32_t opcode = words[i] & 0xffff;
+				uint32_t count = words[i] >> 16;
+				if (count == 0 || i + count > words.size())
+					throw std::runtime_error("truncated SPIR-V instruction");
+
+				parse(opcode, i, count);
+				i += count;
+			}
+		}
+
+		uint32_t word(const Id& id, uint32_t index) const { return words[id.instruction + index]; }
+		const Id& get(uint32_t id) const
+		{
+			if (id >= ids.size() || ids[id].opcode == 0)
+				throw std::runtime_error("SPIR-V refers to an undefined id");
+			return ids[id];
+		}
+
+		uint32_t getTypeSize(uint32_t type) const;
+		uint32_t getConstant(uint32_t constant) const;
+
+	public:
+		std::vector<uint32_t> words;
+		std::vector<Id> ids;
+		uint32_t executionModel = none;
+		std::vector<uint32_t> variables;
+		std::vector<uint32_t> specializationConstants;
+
+	private:
+		void parse(uint32_t opcode, uint32_t i, uint32_t count);
+		Member& getMember(uint32_t structure, uint32_t member)
+		{
+			Id& id = at(structure);
+			if (id.members.size() <= member)
+				id.members.resize(member + 1);
+			return id.members[member];
+		}
+		Id& at(uint32_t id)
+		{
+			if (id >= ids.size())
+				throw std::runtime_error("SPIR-V id out of bounds");
+			return ids[id];
+		}
+	};
+
+	void Module::parse(uint32_t opcode, uint32_t i, uint32_t count)
+	{
+		switch (opcode)
+		{
+		case OpEntryPoint:
+			if (executionModel == none)
+				executionModel = words[i + 1];
+			break;
+		case OpDecorate:
+		{
+			Id& id = at(words[i + 1]);
+			uint32_t value = count > 3 ? words[i + 3] : 0;
+			switch (words[i + 2])
+			{
+			case SpecId: id.specId = value; break;
+			case Block: id.block = true; break;
+			case BufferBlock: id.bufferBlock = true; break;
+			case ArrayStride: id.arrayStride = value; break;
+			case BuiltIn: id.builtIn = true; break;
+			case Location: id.location = value; break;
+			case Binding: id.binding = value; break;
+			case DescriptorSet: id.set = value; break;
+			}
+			break;
+		}
+		case OpMemberDecorate:
+		{
+			Member& member = getMember(words[i + 1], words[i + 2]);
+			uint32_t value = count > 4 ? words[i + 4] : 0;
+			switch (words[i + 3])
+			{
+			case RowMajor: member.rowMajor = true; break;
+			case MatrixStride: member.matrixStride = value; break;
+			case BuiltIn: member.builtIn = true; break;
+			case Offset: member.offset = value; break;
+			}
+			break;
+		}
+		case OpTypeBool:
+		case OpTypeInt:
+		case OpTypeFloat:
+		case OpTypeVector:
+		case OpTypeMatrix:
+		case OpTypeImage:
+		case OpTypeSampler:
+		case OpTypeSampledImage:
+		case OpTypeArray:
+		case OpTypeRuntimeArray:
+		case OpTypeStruct:
+		case OpTypePointer:
+			at(words[i + 1]).opcode = opcode;
+			at(words[i + 1]).instruction = i;
+			break;
+		case OpConstant:
+		case OpSpecConstantTrue:
+		case OpSpecConstantFalse:
+		case OpSpecConstant:
+		case OpVariable:
+			at(words[i + 2]).opcode = opcode;
+			at(words[i + 2]).instruction = i;
+			if (opcode == OpVariable)
+				variables.push_back(words[i + 2]);
+			else if (opcode != OpConstant)
+				specializationConstants.push_back(words[i + 2]);
+			break;
+		}
+	}
+
+	uint32_t Module::getConstant(uint32_t constant) const
+	{
+		// array lengths may also be specialization constants, their default applies
+		const Id& id = get(constant);
+		if (id.opcode != OpConstant && id.opcode != OpSpecConstant)
+			throw std::runtime_error("SPIR-V array length is not a constant");
+		return word(id, 3);
+	}
+
+	uint32_t Module::getTypeSize(uint32_t type) const
+	{
+		const Id& id = get(type);
+		switch (id.opcode)
+		{
+		case OpTypeBool:
+			return 4;
+		case OpTypeInt:
+		case OpTypeFloat:
+			return word(id, 2) / 8;
+		case OpTypeVector:
+			return word(id, 3) * getTypeSize(word(id, 2));
+		case OpTypeMatrix:
+			return word(id, 3) * getTypeSize(word(id, 2));
+		case OpTypeArray:
+		{
+			uint32_t stride = id.arrayStride != 0 ? id.arrayStride : getTypeSize(word(id, 2));
+			return getConstant(word(id, 3)) * stride;
+		}
+		case OpTypeRuntimeArray:
+			return 0;
+		case OpTypeStruct:
+		{
+			uint32_t memberCount = (words[id.instruction] >> 16) - 2;
+			uint32_t size = 0;
+			for (uint32_t m = 0; m < memberCount; m++)
+			{
+				uint32_t memberType = word(id, 2 + m);
+				Member member = m < id.members.size() ? id.members[m] : Member();
+				uint32_t memberSize = getTypeSize(memberType);
+
+				// matrices in blocks are laid out by their stride, not packed
+				const Id& typeId = get(memberType);
+				if (typeId.opcode == OpTypeMatrix && member.matrixStride != 0)
+				{
+					uint32_t columns = word(typeId, 3);
+					uint32_t rows = word(get(word(typeId, 2)), 3);
+					memberSize = member.matrixStride * (member.rowMajor ? rows : columns);
+				}
+				size = std::max(size, member.offset + memberSize);
+			}
+			return size;
+		}
+		}
+
+		throw std::runtime_error("SPIR-V type without a size in a block");
+	}
+
+	VkDescriptorType getDescriptorType(const Module& module, const Id& type, uint32_t storageClass)
+	{
+		if (storageClass == StorageBuffer)
+			return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		if (storageClass == Uniform)
+			return type.bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+		switch (type.opcode)
+		{
+		case OpTypeSampler:
+			return VK_DESCRIPTOR_TYPE_SAMPLER;
+		case OpTypeSampledImage:
+			return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		case OpTypeImage:
+		{
+			uint32_t dim = module.word(type, 3);
+			// 1 is sampled, 2 read and written without a sampler
+			bool sampled = module.word(type, 7) == 1;
+			if (dim == DimSubpassData)
+				return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			if (dim == DimBuffer)
+				return sampled ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+			return sampled ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		}
+		}
+
+		throw std::runtime_error("unsupported descriptor type in SPIR-V");
+	}
+
+	VkFormat getVertexFormat(const Module& module, const Id& type, uint32_t& size)
+	{
+		uint32_t components = 1;
+		const Id* scalar = &type;
+		if (type.opcode == OpTypeVector)
+		{
+			components = module.word(type, 3);
+			scalar = &module.get(module.word(type, 2));
+		}
+
+		if (module.word(*scalar, 2) != 32)
+			throw std::runtime_error("vertex inputs other than 32 bit are not supported");
+		size = components * 4;
+
+		static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT,
+			VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT,
+			VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT,
+			VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (scalar->opcode == OpTypeFloat)
+			return floatFormats[components - 1];
+		if (scalar->opcode == OpTypeInt)
+			return module.word(*scalar, 3) ? intFormats[components - 1] : uintFormats[components - 1];
+
+		throw std::runtime_error("unsupported vertex input type in SPIR-V");
+	}
+
+	VkShaderStageFlagBits getStage(uint32_t executionModel)
+	{
+		switch (executionModel)
+		{
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		throw std::runtime_error("SPIR-V module without a supported entry point");
+	}
+}
+
+ShaderReflection ShaderReflection::reflect(const std::vector<char>& code)
+{
+	Module module(code);
+
+	ShaderReflection reflection;
+	reflection.stage = getStage(module.executionModel);
+
+	for (uint32_t variableId : module.variables)
+	{
+		const Id& variable = module.get(variableId);
+		uint32_t storageClass = module.word(variable, 3);
+		const Id& pointer = module.get(module.word(variable, 1));
+		uint32_t typeId = module.word(pointer, 3);
+
+		if (storageClass == PushConstant)
+		{
+			reflection.pushConstantSize = std::max(reflection.pushConstantSize, module.getTypeSize(typeId));
+			continue;
+		}
+
+		if (storageClass == Input)
+		{
+			if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtIn)
+				continue;
+			if (variable.location == none)
+				throw std::runtime_error("vertex input without a location");
+
+			// arrays and matrices take one location per element or column
+			uint32_t locations = 1;
+			const Id* type = &module.get(typeId);
+			if (type->opcode == OpTypeArray)
+			{
+				locations = module.getConstant(module.word(*type, 3));
+				type = &module.get(module.word(*type, 2));
+			}
+			if (type->opcode == OpTypeMatrix)
+			{
+				locations *= module.word(*type, 3);
+				type = &module.get(module.word(*type, 2));
+			}
+
+			VertexInput input;
+			input.format = getVertexFormat(module, *type, input.size);
+			for (uint32_t l = 0; l < locations; l++)
+			{
+				input.location = variable.location + l;
+				reflection.vertexInputs.push_back(input);
+			}
+			continue;
+		}
+
+		if (storageClass != UniformConstant && storageClass != Uniform && storageClass != StorageBuffer)
+			continue;
+
+		Binding binding;
+		binding.count = 1;
+		const Id* type = &module.get(typeId);
+		while (type->opcode == OpTypeArray || type->opcode == OpTypeRuntimeArray)
+		{
+			binding.count = type->opcode == OpTypeArray ? binding.count * module.getConstant(module.word(*type, 3)) : 0;
+			type = &module.get(module.word(*type, 2));
+		}
+
+		if (variable.binding == none)
+			throw std::runtime_error("descriptor without a binding decoration");
+		binding.set = variable.set != none ? variable.set : 0;
+		binding.binding = variable.binding;
+		binding.type = getDescriptorType(module, *type, storageClass);
+		reflection.bindings.push_back(binding);
+	}
+
+	for (uint32_t constantId : module.specializationConstants)
+	{
+		const Id& constant = module.get(constantId);
+		if (constant.specId == none)
+			continue;
+
+		uint32_t size = constant.opcode == OpSpecConstant ? module.getTypeSize(module.word(constant, 1)) : sizeof(VkBool32);
+		reflection.specializationConstants.push_back({ constant.specId, size });
+	}
+
+	std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const Binding& a, const Binding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const VertexInput& a, const VertexInput& b) {
+		return a.location < b.location;
+	});
+	std::sort(reflection.specializationConstants.begin(), reflection.specializationConstants.end(),
+		[](const SpecializationConstant& a, const SpecializationConstant& b) { return a.id < b.id; });
+
+	return reflection;
+}
+
+bool ShaderReflection::readsLocation(uint32_t location) const
+{
+	return std::any_of(vertexInputs.begin(), vertexInputs.end(), [location](const VertexInput& input) {
+		return input.location == location;
+	});
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vector>
+
+// The interface of one SPIR-V entry point, read from the module's decorations: what the
+// pipeline layout and vertex input state must provide for it. Covers what GLSL shaders
+// for this renderer declare; the first entry point of a module is the one reflected.
+struct ShaderReflection
+{
+	struct Binding
+	{
+		uint32_t set;
+		uint32_t binding;
+		// uniform buffers could be bound as their dynamic counterpart, SPIR-V cannot tell
+		VkDescriptorType type;
+		// 0 for runtime-sized arrays
+		uint32_t count;
+	};
+
+	struct VertexInput
+	{
+		uint32_t location;
+		VkFormat format;
+		uint32_t size;
+	};
+
+	struct SpecializationConstant
+	{
+		uint32_t id;
+		uint32_t size;
+	};
+
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	// sorted by set and binding
+	std::vector<Binding> bindings;
+	// the push constant block spans [0, pushConstantSize)
+	uint32_t pushConstantSize = 0;
+	// vertex shaders only, sorted by location; built-ins such as gl_VertexIndex are left out
+	std::vector<VertexInput> vertexInputs;
+	// sorted by id
+	std::vector<SpecializationConstant> specializationConstants;
+
+	// throws on modules it cannot make sense of
+	static ShaderReflection reflect(const std::vector<char>& code);
+	bool readsLocation(uint32_t location) const;
+};
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "ShaderWatcher.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+void ShaderWatcher::init(const std::string& directory, const std::vector<std::string>& files)
+{
+	this->directory = directory;
+	this->files = files;
+
+	writeTimes.clear();
+	for (const auto& file : files)
+		writeTimes.push_back(getWriteTime(file));
+	lastPoll = std::chrono::steady_clock::now();
+
+#ifdef __linux__
+	// editors either write in place or rename a new file over the old one
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(inotifyFd);
+		inotifyFd = -1;
+	}
+
+	if (inotifyFd < 0)
+		std::cout << "cannot watch " << directory << " with inotify, polling for shader changes" << std::endl;
+#endif
+}
+
+void ShaderWatcher::destroy()
+{
+#ifdef __linux__
+	if (inotifyFd >= 0)
+		close(inotifyFd);
+#endif
+	inotifyFd = -1;
+	files.clear();
+	writeTimes.clear();
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+#ifdef __linux__
+	if (inotifyFd >= 0)
+	{
+		std::vector<std::string> changed;
+		alignas(inotify_event) char buffer[4096];
+		ssize_t size;
+		while ((size = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* position = buffer; position < buffer + size;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+				position += sizeof(inotify_event) + event->len;
+				if (event->len == 0)
+					continue;
+
+				// also sees the SPIR-V files written in the same directory
+				std::string name = event->name;
+				if (std::find(files.begin(), files.end(), name) != files.end() &&
+					std::find(changed.begin(), changed.end(), name) == changed.end())
+					changed.push_back(name);
+			}
+		}
+
+		return changed;
+	}
+#endif
+
+	return pollWriteTimes();
+}
+
+std::vector<std::string> ShaderWatcher::pollWriteTimes()
+{
+	std::vector<std::string> changed;
+	auto now = std::chrono::steady_clock::now();
+	if (now - lastPoll < pollInterval)
+		return changed;
+	lastPoll = now;
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		std::filesystem::file_time_type writeTime = getWriteTime(files[i]);
+		if (writeTime == writeTimes[i])
+			continue;
+
+		writeTimes[i] = writeTime;
+		changed.push_back(files[i]);
+	}
+
+	return changed;
+}
+
+std::filesystem::file_time_type ShaderWatcher::getWriteTime(const std::string& file) const
+{
+	// a file being replaced may be missing for a moment, which reads as a change
+	std::error_code error;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(directory + "/" + file, error);
+	return error ? std::filesystem::file_time_type::min() : writeTime;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+
+// Reports writes to a set of files in one directory. Uses inotify on Linux and compares
+// modification times at most every pollInterval elsewhere, or when inotify is unavailable.
+class ShaderWatcher
+{
+public:
+	// files are names within the directory
+	void init(const std::string& directory, const std::vector<std::string>& files);
+	void destroy();
+
+	// the files written since the last call, each once; never blocks
+	std::vector<std::string> poll();
+
+private:
+	std::vector<std::string> pollWriteTimes();
+	std::filesystem::file_time_type getWriteTime(const std::string& file) const;
+
+private:
+	std::string directory;
+	std::vector<std::string> files;
+	int inotifyFd = -1;
+
+	std::vector<std::filesystem::file_time_type> writeTimes;
+	std::chrono::steady_clock::time_point lastPoll;
+	static constexpr std::chrono::milliseconds pollInterval{ 250 };
+};
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "UploadManager.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+void UploadManager::init(VkDevice device, MemoryAllocator& allocator, uint32_t queueFamily, VkQueue queue,
+	bool timelineSemaphore, VkDeviceSize ringSize)
+{
+	this->device = device;
+	this->allocator = &allocator;
+	this->queue = queue;
+	this->ringSize = ringSize;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = ringSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	staging = allocator.createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		throw std::runtime_error("cannot create upload command pool");
+
+	timeline.init(device, timelineSemaphore);
+
+	batches.resize(batchCount);
+	for (uint32_t i = 0; i < batchCount; i++)
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, &batches[i].commandBuffer) != VK_SUCCESS ||
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batches[i].semaphore) != VK_SUCCESS)
+			throw std::runtime_error("cannot create upload batch");
+
+		freeBatches.push_back(i);
+	}
+
+	ringHead = ringTail = 0;
+}
+
+void UploadManager::destroy()
+{
+	waitIdle();
+
+	for (auto& batch : batches)
+		vkDestroySemaphore(device, batch.semaphore, nullptr);
+	batches.clear();
+	freeBatches.clear();
+	timeline.destroy();
+
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	allocator->destroyBuffer(staging);
+}
+
+bool UploadManager::allocateStaging(VkDeviceSize size, VkDeviceSize& offset)
+{
+	uint64_t start = (ringHead + 15) & ~uint64_t(15);
+
+	// a copy source has to be contiguous, so skip the rest of the ring instead of wrapping
+	if (start % ringSize + size > ringSize)
+		start += ringSize - start % ringSize;
+
+	if (start + size - ringTail > ringSize)
+		return false;
+
+	ringHead = start + size;
+	offset = start % ringSize;
+	return true;
+}
+
+void UploadManager::upload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	const char* source = static_cast<const char*>(data);
+	const VkDeviceSize maxChunk = getMaxChunkSize();
+
+	while (size > 0)
+	{
+		VkDeviceSize chunk = std::min(size, maxChunk);
+		VkDeviceSize stagingOffset;
+
+		reclaim(false);
+		while (!allocateStaging(chunk, stagingOffset))
+		{
+			// the copies already queued hold ring space too; they go out without a
+			// semaphore, so they are waited for here and no frame has to
+			if (!pendingCopies.empty())
+			{
+				submit(false);
+				timeline.wait(timeline.getSubmittedValue());
+			}
+
+			reclaim(true);
+			stallCount++;
+		}
+
+		memcpy(static_cast<char*>(staging.allocation->mapped) + stagingOffset, source, chunk);
+		pendingCopies.push_back({ dst, { stagingOffset, dstOffset, chunk } });
+
+		source += chunk;
+		dstOffset += chunk;
+		size -= chunk;
+		uploadedBytes += chunk;
+	}
+}
+
+bool UploadManager::tryUpload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	if (size > getMaxChunkSize())
+		throw std::runtime_error("upload larger than a chunk");
+
+	VkDeviceSize stagingOffset;
+	reclaim(false);
+	if (!allocateStaging(size, stagingOffset))
+		return false;
+
+	memcpy(static_cast<char*>(staging.allocation->mapped) + stagingOffset, data, size);
+	pendingCopies.push_back({ dst, { stagingOffset, dstOffset, size } });
+	uploadedBytes += size;
+	return true;
+}
+
+void UploadManager::flush(std::vector<VkSemaphore>& waitSemaphores)
+{
+	reclaim(false);
+
+	if (pendingCopies.empty())
+		return;
+
+	// the batch that just went out is at the back
+	submit(true);
+	waitSemaphores.push_back(batches[batchesInFlight.back()].semaphore);
+}
+
+void UploadManager::submit(bool signalSemaphore)
+{
+	if (freeBatches.empty())
+	{
+		reclaim(true);
+		stallCount++;
+	}
+
+	uint32_t index = freeBatches.back();
+	freeBatches.pop_back();
+	Batch& batch = batches[index];
+
+	allocator->flush(staging.allocation, 0, ringSize);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(batch.commandBuffer, 0);
+	if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS)
+		throw std::runtime_error("cannot begin upload command buffer");
+
+	// one vkCmdCopyBuffer per destination with all of its regions
+	std::stable_sort(pendingCopies.begin(), pendingCopies.end(),
+		[](const PendingCopy& a, const PendingCopy& b) { return a.dst < b.dst; });
+
+	std::vector<VkBufferCopy> regions;
+	for (size_t i = 0; i < pendingCopies.size();)
+	{
+		VkBuffer dst = pendingCopies[i].dst;
+		regions.clear();
+		for (; i < pendingCopies.size() && pendingCopies[i].dst == dst; i++)
+			regions.push_back(pendingCopies[i].region);
+
+		vkCmdCopyBuffer(batch.commandBuffer, staging.buffer, dst, regions.size(), regions.data());
+	}
+	pendingCopies.clear();
+
+	if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("cannot end upload command buffer");
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+	submitInfo.signalSemaphoreCount = signalSemaphore ? 1 : 0;
+	submitInfo.pSignalSemaphores = &batch.semaphore;
+
+	if (timeline.submit(queue, submitInfo) != VK_SUCCESS)
+		throw std::runtime_error("cannot submit upload batch");
+
+	batch.timelineValue = timeline.getSubmittedValue();
+	batch.ringEnd = ringHead;
+	batchesInFlight.push_back(index);
+}
+
+void UploadManager::reclaim(bool wait)
+{
+	while (!batchesInFlight.empty())
+	{
+		Batch& batch = batches[batchesInFlight.front()];
+
+		if (wait)
+		{
+			timeline.wait(batch.timelineValue);
+			wait = false;
+		}
+		else if (!timeline.isComplete(batch.timelineValue))
+			break;
+
+		ringTail = batch.ringEnd;
+		freeBatches.push_back(batchesInFlight.front());
+		batchesInFlight.pop_front();
+	}
+}
+
+void UploadManager::waitIdle()
+{
+	while (!batchesInFlight.empty())
+		reclaim(true);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "MemoryAllocator.h"
+#include "GpuTimeline.h"
+#include <vector>
+#include <deque>
+
+// Streams data into device-local buffers through a persistently mapped staging ring.
+// Copies are batched and submitted once per frame on the transfer queue; a batch's ring
+// space is reclaimed once the upload timeline passed it, so a frame only stalls when the
+// ring is full. Render thread only, except for reading the timeline.
+class UploadManager
+{
+public:
+	void init(VkDevice device, MemoryAllocator& allocator, uint32_t queueFamily, VkQueue queue,
+		bool timelineSemaphore, VkDeviceSize ringSize = 32ull * 1024 * 1024);
+	void destroy();
+
+	// the data is copied out before returning
+	void upload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	// like upload, but never waits: false if the ring has no room for the copy right now.
+	// size is at most getMaxChunkSize()
+	bool tryUpload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	// a quarter of the ring per copy keeps large uploads overlapping with the GPU
+	VkDeviceSize getMaxChunkSize() const { return ringSize / 4; }
+	// submits queued copies and appends a semaphore the next graphics submit must wait on
+	void flush(std::vector<VkSemaphore>& waitSemaphores);
+	void waitIdle();
+
+	uint64_t getUploadedBytes() const { return uploadedBytes; }
+	// uploads that had to wait for the GPU to free ring space
+	uint32_t getStallCount() const { return stallCount; }
+	// everything flushed so far has landed once this reaches its getSubmittedValue()
+	const GpuTimeline& getTimeline() const { return timeline; }
+
+private:
+	struct Batch
+	{
+		VkCommandBuffer commandBuffer;
+		VkSemaphore semaphore;
+		uint64_t timelineValue;
+		// ring position after this batch's data
+		uint64_t ringEnd;
+	};
+
+	struct PendingCopy
+	{
+		VkBuffer dst;
+		VkBufferCopy region;
+	};
+
+	bool allocateStaging(VkDeviceSize size, VkDeviceSize& offset);
+	void submit(bool signalSemaphore);
+	// retires finished batches, blocking on the oldest one if wait is set
+	void reclaim(bool wait);
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+	VkQueue queue = VK_NULL_HANDLE;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	GpuTimeline timeline;
+
+	Buffer staging;
+	VkDeviceSize ringSize = 0;
+	// monotonic positions; the physical offset is position % ringSize
+	uint64_t ringHead = 0;
+	uint64_t ringTail = 0;
+
+	std::vector<Batch> batches;
+	std::vector<uint32_t> freeBatches;
+	std::deque<uint32_t> batchesInFlight;
+	std::vector<PendingCopy> pendingCopies;
+
+	uint64_t uploadedBytes = 0;
+	uint32_t stallCount = 0;
+
+	static const uint32_t batchCount = 8;
+};
\ No newline at end of file
@@ -1,6 +1,15 @@
 #include "Application.h"
 #include "Renderer/Renderer.h"
+#include "JobSystem.h"
 #include <memory>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+App::App(const AppSettings& settings)
+	: settings(settings)
+{
+}
 
 void App::run()
 {
@@ -11,22 +20,211 @@ void App::run()
 
 void App::start()
 {
-	window = std::unique_ptr<Window>(Window::CreateWindow());
-	Renderer::init(window->getPointer());
+	if (settings.benchmark)
+	{
+		benchmark = std::make_unique<Benchmark>(settings.warmupFrames, settings.measuredFrames);
+		settings.frameCount = settings.warmupFrames + settings.measuredFrames;
+	}
+
+	auto startupBegin = std::chrono::steady_clock::now();
+
+	JobSystem::init();
+	Renderer::setDepthPrepass(settings.depthPrepass);
+	Renderer::setLatencyMode(settings.latencyMode);
+	Renderer::setTargetFrameTime(settings.targetFrameTime);
+
+	if (settings.headless)
+		Renderer::initHeadless(settings.width, settings.height);
+	else
+	{
+		window = std::unique_ptr<Window>(Window::CreateWindow());
+		Renderer::init(window->getPointer());
+	}
+
+	uint32_t recordingThreads = settings.recordingThreads != 0 ? settings.recordingThreads : JobSystem::getThreadCount() + 1;
+	Renderer::setRecordingThreads(recordingThreads);
+	Renderer::setShaderHotReload(settings.shaderHotReload);
+
+	if (settings.dumpFrameGraph)
+		Renderer::getFrameGraph().dump(std::cout);
+
+	if (benchmark)
+	{
+		benchmark->addParameter("headless", settings.headless ? "true" : "false");
+		benchmark->addParameter("draws", std::to_string(settings.drawCount));
+		benchmark->addParameter("recording_threads", std::to_string(recordingThreads));
+		benchmark->addParameter("instances", std::to_string(settings.instanceCount));
+		benchmark->addParameter("culling", settings.cpuCulling ? "cpu" : settings.gpuCulling ? "gpu" : "off");
+		benchmark->addParameter("occlusion", settings.occlusionCulling ? "true" : "false");
+		benchmark->addParameter("depth_prepass", settings.depthPrepass ? "true" : "false");
+		const char* latencyModes[] = { "low", "balanced", "throughput" };
+		benchmark->addParameter("latency", latencyModes[int(settings.latencyMode)]);
+		benchmark->addParameter("target_frame_time", std::to_string(settings.targetFrameTime));
+	}
+
+	if (settings.instanceCount > 0)
+		createInstances();
+
+	if (!settings.meshPaths.empty())
+	{
+		// OBJ files carry no normals, flat shading brings out their shape
+		GraphicsPipelineDesc meshDesc = Renderer::getMeshPipelineDesc();
+		Renderer::ShaderPermutation permutation;
+		permutation.lighting = Renderer::LightingModel::Flat;
+		Renderer::applyPermutation(meshDesc, permutation);
+		meshPipeline = Renderer::requestPipeline(meshDesc);
+		packedMeshPipeline = Renderer::requestPipeline(Renderer::getPackedMeshPipelineDesc());
+		meshLoader.init();
+
+		auto loadBegin = std::chrono::steady_clock::now();
+		for (const auto& path : settings.meshPaths)
+		{
+			meshes.push_back(meshLoader.load(path, [loadBegin](const MeshLoadProgress& progress) {
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - loadBegin;
+				if (progress.state == MeshLoadProgress::State::Done)
+					std::cout << "loaded " << *progress.path << " (" << progress.mesh->indexCount / 3 << " triangles) after "
+						<< elapsed.count() << " ms" << std::endl;
+				else if (progress.state == MeshLoadProgress::State::Failed)
+					std::cout << "cannot load " << *progress.path << ": " << *progress.error << std::endl;
+			}));
+		}
+	}
+
+	std::chrono::duration<double, std::milli> startupTime = std::chrono::steady_clock::now() - startupBegin;
+	std::cout << "startup took " << startupTime.count() << " ms" << std::endl;
+}
+
+void App::createInstances()
+{
+	std::vector<Vertex> vertices = {
+		{ { -0.5f, -0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+		{ { 0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+		{ { 0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+		{ { -0.5f, 0.5f, 0.0f }, { 1.0f, 1.0f, 1.0f } },
+	};
+	instancedMesh = Renderer::createMesh(vertices, { 0, 1, 2, 2, 3, 0 });
+	instancedPipeline = Renderer::requestPipeline(Renderer::getInstancedPipelineDesc(Mesh::VertexFormat::Float));
+
+	// a square grid filling clip space
+	uint32_t columns = uint32_t(std::ceil(std::sqrt(double(settings.instanceCount))));
+	float extent = settings.gpuCulling || settings.cpuCulling ? 2.0f : 1.0f;
+	float spacing = 2.0f * extent / columns;
+	for (uint32_t i = 0; i < settings.instanceCount; i++)
+	{
+		Vec3 position = { -extent + spacing * (i % columns + 0.5f), -extent + spacing * (i / columns + 0.5f), 0.5f };
+		instances.add(position, Quat{ 0.0f, 0.0f, 0.0f, 1.0f }, spacing * 0.8f);
+	}
+
+	Renderer::setGpuCulling(!settings.cpuCulling);
+	Renderer::setOcclusionCulling(settings.occlusionCulling);
+	if (settings.occlusionCulling)
+	{
+		// nearer than the grid, so the depth test hides what it covers
+		occluderPositions = { -0.5f, -0.5f, 0.25f, 0.5f, -0.5f, 0.25f, 0.5f, 0.5f, 0.25f, -0.5f, 0.5f, 0.25f };
+		occluderIndices = { 0, 1, 2, 2, 3, 0 };
+
+		std::vector<Vertex> wall(4);
+		for (size_t i = 0; i < wall.size(); i++)
+			wall[i] = { { occluderPositions[3 * i], occluderPositions[3 * i + 1], occluderPositions[3 * i + 2] }, { 0.3f, 0.3f, 0.3f } };
+		occluderMesh = Renderer::createMesh(wall, occluderIndices);
+		occluderPipeline = Renderer::requestPipeline(Renderer::getMeshPipelineDesc());
+	}
 }
 
 void App::loop()
 {
-	while (!window->shouldClose())
+	auto start = std::chrono::steady_clock::now();
+	uint64_t frames = 0;
+
+	while (settings.headless || !window->shouldClose())
 	{
-		window->update();
+		if (settings.frameCount != 0 && frames == settings.frameCount)
+			break;
+
+		auto frameStart = std::chrono::steady_clock::now();
+		// everything the frame reacts to is gathered from here on
+		Renderer::markInput(frameStart);
+
+		if (window)
+		{
+			window->update();
+			if (window->wasResized())
+				Renderer::onFramebufferResized();
+		}
+
+		DrawCommand triangle;
+		triangle.vertexCount = 3;
+		for (uint32_t i = 0; i < settings.drawCount; i++)
+			Renderer::submit(triangle);
+
+		if (settings.instanceCount > 0 && instancedPipeline.isReady())
+		{
+			Quat rotation = Quat::axisAngle({ 0.0f, 0.0f, 1.0f }, float(frames) * 0.01f);
+			for (uint32_t i = 0; i < instances.size(); i++)
+				instances.setRotation(i, rotation);
+
+			if (settings.occlusionCulling)
+				Renderer::getOcclusionBuffer().addOccluder(occluderPositions.data(), occluderIndices.data(), occluderIndices.size());
+
+			if (settings.gpuCulling || settings.cpuCulling)
+				Renderer::submitCulled(instancedMesh, instancedPipeline.get(), instances);
+			else
+				Renderer::submitInstanced(instancedMesh, instancedPipeline.get(), instances);
+
+			if (settings.occlusionCulling && occluderPipeline.isReady())
+				Renderer::submit(occluderMesh, occluderPipeline.get());
+		}
+
+		meshLoader.update();
+		for (uint32_t id : meshes)
+		{
+			const Mesh* mesh = meshLoader.getMesh(id);
+			if (!mesh)
+				continue;
+
+			const PipelineHandle& pipeline = mesh->vertexFormat == Mesh::VertexFormat::Packed ? packedMeshPipeline : meshPipeline;
+			if (pipeline.isReady())
+				Renderer::submit(*mesh, pipeline.get());
+		}
+
 		Renderer::draw();
+		frames++;
+
+		if (benchmark)
+		{
+			std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+			benchmark->record(Renderer::getLastFrameTimings(), frameTime.count());
+		}
+	}
+
+	if (benchmark)
+	{
+		benchmark->report(std::cout);
+		benchmark->writeJson(settings.benchmarkOutput);
+		std::cout << "benchmark results written to " << settings.benchmarkOutput << std::endl;
+		Renderer::getMemoryAllocator().dumpStats(std::cout);
+		Renderer::getPipelineCompiler().dumpStats(std::cout);
+	}
+
+	if (settings.headless)
+	{
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "rendered " << frames << " frames in " << elapsed.count() << " s ("
+			<< frames / elapsed.count() << " fps)" << std::endl;
 	}
 }
 
 void App::shutDown()
 {
+	Renderer::waitIdle();
+	meshLoader.destroy();
+	if (instancedMesh.indexCount > 0)
+		Renderer::destroyMesh(instancedMesh);
+	if (occluderMesh.indexCount > 0)
+		Renderer::destroyMesh(occluderMesh);
 	Renderer::shutdown();
-	window->shutDown();
+	JobSystem::shutdown();
+	if (window)
+		window->shutDown();
 }
 
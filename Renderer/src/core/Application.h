@@ -1,19 +1,83 @@
 #include "Renderer/Renderer.h"
+#include "Renderer/MeshLoader.h"
 #include "Window.h"
+#include "Benchmark.h"
 #include <memory>
+#include <string>
+#include <vector>
 
 struct GLFWwindow;
 
+struct AppSettings
+{
+	bool headless = false;
+	uint32_t width = 1280, height = 720;
+	// 0 runs until the window is closed
+	uint64_t frameCount = 0;
+	// triangles drawn per frame, each its own draw call
+	uint32_t drawCount = 1;
+	// threads recording command buffers, 0 uses every job system worker plus the render thread
+	uint32_t recordingThreads = 0;
+
+	bool benchmark = false;
+	uint32_t warmupFrames = 100;
+	uint32_t measuredFrames = 1000;
+	std::string benchmarkOutput = "benchmark.json";
+
+	// copies of a small mesh drawn with a single instanced draw
+	uint32_t instanceCount = 0;
+	// frustum cull the instances in a compute pass and draw them indirectly; with any
+	// culling the grid spans twice the clip space so that most of it is culled
+	bool gpuCulling = false;
+	// the same on the job system, also where GPU culling is supported
+	bool cpuCulling = false;
+	// a wall in front of the middle of the grid culls the instances behind it; CPU only
+	bool occlusionCulling = false;
+	// depth-only pass first, then shade only the visible fragments
+	bool depthPrepass = false;
+
+	// prints the compiled frame graph after startup
+	bool dumpFrameGraph = false;
+	// recompiles and swaps shaders edited in assets/shaders while running
+	bool shaderHotReload = false;
+
+	Renderer::LatencyMode latencyMode = Renderer::LatencyMode::Balanced;
+	// milliseconds per frame the loop is paced to, 0 runs as fast as the latency mode allows
+	double targetFrameTime = 0.0;
+
+	// OBJ or .vmesh files streamed in after startup and drawn once loaded
+	std::vector<std::string> meshPaths;
+};
+
 class App
 {
 public:
+	App(const AppSettings& settings = AppSettings());
 	void run();
 
 private:
 	void start();
+	void createInstances();
 	void loop();
 	void shutDown();
 
 private:
+	AppSettings settings;
 	std::unique_ptr<Window> window;
+	std::unique_ptr<Benchmark> benchmark;
+
+	MeshLoader meshLoader;
+	PipelineHandle meshPipeline;
+	PipelineHandle packedMeshPipeline;
+	std::vector<uint32_t> meshes;
+
+	Mesh instancedMesh;
+	InstanceBatch instances;
+	PipelineHandle instancedPipeline;
+
+	Mesh occluderMesh;
+	PipelineHandle occluderPipeline;
+	// the wall in clip space, as the occlusion buffer takes it
+	std::vector<float> occluderPositions;
+	std::vector<uint32_t> occluderIndices;
 };
\ No newline at end of file
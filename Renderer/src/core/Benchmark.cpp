@@ -0,0 +1,168 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cmath>
+
+enum SeriesIndex { Frame, FenceWait, Acquire, Record, Submit, Present, Gpu, CullingTime, Pacing, InputLatency };
+
+Benchmark::Benchmark(uint32_t warmupFrames, uint32_t measuredFrames)
+	: warmupFrames(warmupFrames), measuredFrames(measuredFrames)
+{
+	series = {
+		{ "frame" }, { "fence_wait" }, { "acquire" }, { "record" }, { "submit" }, { "present" }, { "gpu" }, { "culling" },
+		{ "pacing" }, { "input_latency" }
+	};
+
+	for (auto& s : series)
+		s.samples.reserve(measuredFrames);
+	recordPerDraw.reserve(measuredFrames);
+	overdraw.reserve(measuredFrames);
+}
+
+void Benchmark::record(const FrameTimings& timings, double frameTime)
+{
+	framesSeen++;
+	if (framesSeen <= warmupFrames || framesSeen > warmupFrames + measuredFrames)
+		return;
+
+	series[Frame].samples.push_back(frameTime);
+	series[FenceWait].samples.push_back(timings.fenceWait);
+	series[Acquire].samples.push_back(timings.acquire);
+	series[Record].samples.push_back(timings.record);
+	if (timings.drawCount != 0)
+		recordPerDraw.push_back(timings.record * 1e6 / timings.drawCount);
+	series[Submit].samples.push_back(timings.submit);
+	series[Present].samples.push_back(timings.present);
+	series[Pacing].samples.push_back(timings.pacing);
+	if (timings.inputLatencyValid)
+		series[InputLatency].samples.push_back(timings.inputLatency);
+	if (timings.gpuValid)
+		series[Gpu].samples.push_back(timings.gpu);
+	if (timings.overdrawValid)
+		overdraw.push_back(timings.overdraw);
+	if (timings.cullingValid)
+	{
+		visibleObjects += timings.visibleObjects;
+		culledObjects += timings.culledObjects;
+		occludedObjects += timings.occludedObjects;
+		cullingFrames++;
+		// only CPU culling takes time on this side
+		if (timings.culling > 0.0)
+			series[CullingTime].samples.push_back(timings.culling);
+	}
+}
+
+void Benchmark::addParameter(const std::string& name, const std::string& value)
+{
+	parameters.emplace_back(name, value);
+}
+
+Benchmark::Statistics Benchmark::computeStatistics(std::vector<double> samples)
+{
+	Statistics statistics;
+	if (samples.empty())
+		return statistics;
+
+	std::sort(samples.begin(), samples.end());
+
+	// nearest-rank percentile
+	auto percentile = [&samples](double p) {
+		size_t rank = size_t(std::ceil(p * samples.size()));
+		return samples[std::min(samples.size(), std::max<size_t>(rank, 1)) - 1];
+	};
+
+	statistics.p50 = percentile(0.50);
+	statistics.p95 = percentile(0.95);
+	statistics.p99 = percentile(0.99);
+	statistics.max = samples.back();
+
+	double sum = 0.0;
+	for (double sample : samples)
+		sum += sample;
+	statistics.mean = sum / samples.size();
+
+	return statistics;
+}
+
+void Benchmark::report(std::ostream& out) const
+{
+	out << "benchmark: " << warmupFrames << " warm-up, " << series[Frame].samples.size()
+		<< " measured frames on " << Renderer::getDeviceName() << std::endl;
+	for (const auto& parameter : parameters)
+		out << "  " << parameter.first << " = " << parameter.second << std::endl;
+	out << std::left << std::setw(12) << "ms" << std::right
+		<< std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99"
+		<< std::setw(10) << "max" << std::setw(10) << "mean" << std::endl;
+
+	out << std::fixed << std::setprecision(3);
+	for (const auto& s : series)
+	{
+		if (s.samples.empty())
+			continue;
+
+		Statistics statistics = computeStatistics(s.samples);
+		out << std::left << std::setw(12) << s.name << std::right
+			<< std::setw(10) << statistics.p50 << std::setw(10) << statistics.p95
+			<< std::setw(10) << statistics.p99 << std::setw(10) << statistics.max
+			<< std::setw(10) << statistics.mean << std::endl;
+	}
+
+	if (!recordPerDraw.empty())
+		out << "recording cost: " << computeStatistics(recordPerDraw).p50 << " ns per draw (p50)" << std::endl;
+	if (cullingFrames != 0)
+		out << "culling: " << visibleObjects / cullingFrames << " visible, " << culledObjects / cullingFrames
+			<< " culled (" << occludedObjects / cullingFrames << " occluded) objects per frame (mean)" << std::endl;
+	if (!overdraw.empty())
+		out << "overdraw: " << computeStatistics(overdraw).mean << " fragment shader invocations per pixel (mean)" << std::endl;
+	out << std::defaultfloat;
+}
+
+void Benchmark::writeJson(const std::string& path) const
+{
+	std::ofstream file(path);
+
+	if (!file.is_open())
+		throw std::runtime_error("cannot open benchmark output file");
+
+	std::string deviceName = Renderer::getDeviceName();
+	std::replace(deviceName.begin(), deviceName.end(), '"', '\'');
+
+	file << std::setprecision(6);
+	file << "{\n";
+	file << "  \"device\": \"" << deviceName << "\",\n";
+	file << "  \"warmup_frames\": " << warmupFrames << ",\n";
+	file << "  \"measured_frames\": " << series[Frame].samples.size() << ",\n";
+	for (const auto& parameter : parameters)
+		file << "  \"" << parameter.first << "\": \"" << parameter.second << "\",\n";
+	file << "  \"unit\": \"ms\",\n";
+	file << "  \"metrics\": {";
+
+	bool first = true;
+	for (const auto& s : series)
+	{
+		if (s.samples.empty())
+			continue;
+
+		Statistics statistics = computeStatistics(s.samples);
+		file << (first ? "\n" : ",\n");
+		file << "    \"" << s.name << "\": { \"p50\": " << statistics.p50 << ", \"p95\": " << statistics.p95
+			<< ", \"p99\": " << statistics.p99 << ", \"max\": " << statistics.max
+			<< ", \"mean\": " << statistics.mean << " }";
+		first = false;
+	}
+
+	file << "\n  }";
+	if (!recordPerDraw.empty())
+		file << ",\n  \"record_ns_per_draw\": " << computeStatistics(recordPerDraw).p50;
+	if (cullingFrames != 0)
+	{
+		file << ",\n  \"visible_objects\": " << visibleObjects / cullingFrames;
+		file << ",\n  \"culled_objects\": " << culledObjects / cullingFrames;
+		file << ",\n  \"occluded_objects\": " << occludedObjects / cullingFrames;
+	}
+	if (!overdraw.empty())
+		file << ",\n  \"overdraw\": " << computeStatistics(overdraw).mean;
+	file << "\n}\n";
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include "Renderer/Renderer.h"
+#include <vector>
+#include <string>
+#include <ostream>
+
+class Benchmark
+{
+public:
+	Benchmark(uint32_t warmupFrames, uint32_t measuredFrames);
+
+	// frameTime is the full CPU time of the frame in milliseconds
+	void record(const FrameTimings& timings, double frameTime);
+	// run configuration echoed into the report, e.g. draw count
+	void addParameter(const std::string& name, const std::string& value);
+	bool finished() const { return framesSeen >= warmupFrames + measuredFrames; }
+
+	void report(std::ostream& out) const;
+	void writeJson(const std::string& path) const;
+
+private:
+	struct Statistics
+	{
+		double p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0, mean = 0.0;
+	};
+
+	struct Series
+	{
+		const char* name;
+		std::vector<double> samples;
+	};
+
+	static Statistics computeStatistics(std::vector<double> samples);
+
+private:
+	uint32_t warmupFrames;
+	uint32_t measuredFrames;
+	uint32_t framesSeen = 0;
+
+	// frame, fence wait, acquire, record, submit, present, gpu, culling, pacing, input latency
+	std::vector<Series> series;
+	std::vector<double> recordPerDraw;
+	// GPU culling results summed over the measured frames that reported them
+	uint64_t visibleObjects = 0;
+	uint64_t culledObjects = 0;
+	uint64_t occludedObjects = 0;
+	uint32_t cullingFrames = 0;
+	// fragment shader invocations per pixel
+	std::vector<double> overdraw;
+	std::vector<std::pair<std::string, std::string>> parameters;
+};
\ No newline at end of file
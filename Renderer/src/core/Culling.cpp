@@ -0,0 +1,243 @@
+#include "Culling.h"
+#include <bitset>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+#define RENDERER_AVX512 1
+#endif
+#if defined(__AVX2__)
+#define RENDERER_AVX2 1
+#endif
+
+namespace
+{
+	// Thin wrappers so that the test is written once for every vector width. A lane is
+	// visible when the smallest signed plane distance plus its radius is not negative.
+	struct ScalarLanes
+	{
+		using Float = float;
+		using Mask = bool;
+		static const uint32_t width = 1;
+
+		static Float load(const float* p) { return *p; }
+		static Float set(float x) { return x; }
+		static Float add(Float a, Float b) { return a + b; }
+		static Float multiplyAdd(Float a, Float b, Float c) { return a * b + c; }
+		static Float min(Float a, Float b) { return a < b ? a : b; }
+		static Mask nonNegative(Float a) { return a >= 0.0f; }
+
+		static uint32_t storeVisible(uint32_t* out, uint32_t base, Mask mask)
+		{
+			*out = base;
+			return mask ? 1 : 0;
+		}
+	};
+
+	// the branchless store of the 4 and 8 wide kernels: every lane is written, and the
+	// output only advances past visible ones
+	inline uint32_t storeVisibleBits(uint32_t* out, uint32_t base, uint32_t bits, uint32_t width)
+	{
+		uint32_t count = 0;
+		for (uint32_t lane = 0; lane < width; lane++)
+		{
+			out[count] = base + lane;
+			count += (bits >> lane) & 1;
+		}
+		return count;
+	}
+
+#ifdef RENDERER_SSE2
+	struct Sse2Lanes
+	{
+		using Float = __m128;
+		using Mask = uint32_t;
+		static const uint32_t width = 4;
+
+		static Float load(const float* p) { return _mm_loadu_ps(p); }
+		static Float set(float x) { return _mm_set1_ps(x); }
+		static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+		static Float multiplyAdd(Float a, Float b, Float c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+		static Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+		static Mask nonNegative(Float a) { return uint32_t(_mm_movemask_ps(_mm_cmpge_ps(a, _mm_setzero_ps()))); }
+
+		static uint32_t storeVisible(uint32_t* out, uint32_t base, Mask mask) { return storeVisibleBits(out, base, mask, width); }
+	};
+#endif
+
+#ifdef RENDERER_AVX2
+	struct Avx2Lanes
+	{
+		using Float = __m256;
+		using Mask = uint32_t;
+		static const uint32_t width = 8;
+
+		static Float load(const float* p) { return _mm256_loadu_ps(p); }
+		static Float set(float x) { return _mm256_set1_ps(x); }
+		static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+#if defined(__FMA__) || defined(_MSC_VER)
+		static Float multiplyAdd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+		static Float multiplyAdd(Float a, Float b, Float c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+		static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+		static Mask nonNegative(Float a) { return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GE_OQ))); }
+
+		static uint32_t storeVisible(uint32_t* out, uint32_t base, Mask mask) { return storeVisibleBits(out, base, mask, width); }
+	};
+#endif
+
+#ifdef RENDERER_AVX512
+	struct Avx512Lanes
+	{
+		using Float = __m512;
+		using Mask = __mmask16;
+		static const uint32_t width = 16;
+
+		static Float load(const float* p) { return _mm512_loadu_ps(p); }
+		static Float set(float x) { return _mm512_set1_ps(x); }
+		static Float add(Float a, Float b) { return _mm512_add_ps(a, b); }
+		static Float multiplyAdd(Float a, Float b, Float c) { return _mm512_fmadd_ps(a, b, c); }
+		static Float min(Float a, Float b) { return _mm512_min_ps(a, b); }
+		static Mask nonNegative(Float a) { return _mm512_cmp_ps_mask(a, _mm512_setzero_ps(), _CMP_GE_OQ); }
+
+		// compress store writes only the visible lanes, packed
+		static uint32_t storeVisible(uint32_t* out, uint32_t base, Mask mask)
+		{
+			const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+			_mm512_mask_compressstoreu_epi32(out, mask, _mm512_add_epi32(_mm512_set1_epi32(int(base)), lanes));
+			return uint32_t(std::bitset<16>(mask).count());
+		}
+	};
+#endif
+
+	template<typename Lanes>
+	uint32_t cullSpheresWith(const SphereArrays& spheres, uint32_t first, uint32_t count, const float planes[6][4], uint32_t* visible)
+	{
+		typename Lanes::Float normalX[6], normalY[6], normalZ[6], distance[6];
+		for (int p = 0; p < 6; p++)
+		{
+			normalX[p] = Lanes::set(planes[p][0]);
+			normalY[p] = Lanes::set(planes[p][1]);
+			normalZ[p] = Lanes::set(planes[p][2]);
+			distance[p] = Lanes::set(planes[p][3]);
+		}
+
+		uint32_t i = first;
+		uint32_t end = first + count;
+		uint32_t visibleCount = 0;
+		for (; i + Lanes::width <= end; i += Lanes::width)
+		{
+			typename Lanes::Float x = Lanes::load(spheres.centerX + i);
+			typename Lanes::Float y = Lanes::load(spheres.centerY + i);
+			typename Lanes::Float z = Lanes::load(spheres.centerZ + i);
+
+			typename Lanes::Float nearest = Lanes::multiplyAdd(normalX[0], x,
+				Lanes::multiplyAdd(normalY[0], y, Lanes::multiplyAdd(normalZ[0], z, distance[0])));
+			for (int p = 1; p < 6; p++)
+				nearest = Lanes::min(nearest, Lanes::multiplyAdd(normalX[p], x,
+					Lanes::multiplyAdd(normalY[p], y, Lanes::multiplyAdd(normalZ[p], z, distance[p]))));
+
+			typename Lanes::Float margin = Lanes::add(nearest, Lanes::load(spheres.radius + i));
+			visibleCount += Lanes::storeVisible(visible + visibleCount, i, Lanes::nonNegative(margin));
+		}
+
+		if constexpr (Lanes::width > 1)
+			visibleCount += cullSpheresWith<ScalarLanes>(spheres, i, end - i, planes, visible + visibleCount);
+
+		return visibleCount;
+	}
+}
+
+bool Culling::isAvailable(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Scalar:
+		return true;
+#ifdef RENDERER_SSE2
+	case Kernel::Sse2:
+		return true;
+#endif
+#ifdef RENDERER_AVX2
+	case Kernel::Avx2:
+		return true;
+#endif
+#ifdef RENDERER_AVX512
+	case Kernel::Avx512:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+Culling::Kernel Culling::getBestKernel()
+{
+	for (Kernel kernel : { Kernel::Avx512, Kernel::Avx2, Kernel::Sse2 })
+	{
+		if (isAvailable(kernel))
+			return kernel;
+	}
+	return Kernel::Scalar;
+}
+
+const char* Culling::getName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Sse2:
+		return "sse2";
+	case Kernel::Avx2:
+		return "avx2";
+	case Kernel::Avx512:
+		return "avx512";
+	default:
+		return "scalar";
+	}
+}
+
+uint32_t Culling::cullSpheres(Kernel kernel, const SphereArrays& spheres, uint32_t first, uint32_t count,
+	const float planes[6][4], uint32_t* visible)
+{
+	switch (kernel)
+	{
+#ifdef RENDERER_SSE2
+	case Kernel::Sse2:
+		return cullSpheresWith<Sse2Lanes>(spheres, first, count, planes, visible);
+#endif
+#ifdef RENDERER_AVX2
+	case Kernel::Avx2:
+		return cullSpheresWith<Avx2Lanes>(spheres, first, count, planes, visible);
+#endif
+#ifdef RENDERER_AVX512
+	case Kernel::Avx512:
+		return cullSpheresWith<Avx512Lanes>(spheres, first, count, planes, visible);
+#endif
+	default:
+		return cullSpheresWith<ScalarLanes>(spheres, first, count, planes, visible);
+	}
+}
+
+void Culling::transformSpheres(const TransformArrays& transforms, size_t first, size_t count, const float sphere[4],
+	float* centerX, float* centerY, float* centerZ, float* radius)
+{
+	// straight-line code over the arrays, which compilers vectorize on their own
+	for (size_t i = first; i < first + count; i++)
+	{
+		float qx = transforms.rotationX[i], qy = transforms.rotationY[i], qz = transforms.rotationZ[i], qw = transforms.rotationW[i];
+		float s = transforms.scale[i];
+		float cx = sphere[0] * s, cy = sphere[1] * s, cz = sphere[2] * s;
+
+		// v + w * t + q x t with t = 2 * (q x v)
+		float tx = 2.0f * (qy * cz - qz * cy);
+		float ty = 2.0f * (qz * cx - qx * cz);
+		float tz = 2.0f * (qx * cy - qy * cx);
+		centerX[i] = transforms.positionX[i] + cx + qw * tx + (qy * tz - qz * ty);
+		centerY[i] = transforms.positionY[i] + cy + qw * ty + (qz * tx - qx * tz);
+		centerZ[i] = transforms.positionZ[i] + cz + qw * tz + (qx * ty - qy * tx);
+		radius[i] = sphere[3] * std::fabs(s);
+	}
+}
\ No newline at end of file
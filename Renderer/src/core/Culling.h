@@ -0,0 +1,45 @@
+#pragma once
+#include "Math.h"
+#include <cstdint>
+#include <cstddef>
+
+// Bounding spheres as structure of arrays, the layout the SIMD tests read.
+struct SphereArrays
+{
+	const float* centerX;
+	const float* centerY;
+	const float* centerZ;
+	const float* radius;
+};
+
+struct CullingStats
+{
+	uint32_t objects = 0;
+	uint32_t visible = 0;
+	// rejected by the occlusion test after passing the frustum test
+	uint32_t occluded = 0;
+};
+
+class Culling
+{
+public:
+	// Kernels testing 1, 4, 8 or 16 spheres per iteration. The vector ones exist when the
+	// compiler targets the instruction set, e.g. -mavx2 -mfma or /arch:AVX2.
+	enum class Kernel { Scalar, Sse2, Avx2, Avx512 };
+
+	static bool isAvailable(Kernel kernel);
+	static Kernel getBestKernel();
+	static const char* getName(Kernel kernel);
+
+	// Writes the indices of the spheres in [first, first + count) that are not completely
+	// outside one of the planes to visible and returns how many there are. Planes are
+	// (normal, distance) with the normal pointing inside; visible needs room for count
+	// indices.
+	static uint32_t cullSpheres(Kernel kernel, const SphereArrays& spheres, uint32_t first, uint32_t count,
+		const float planes[6][4], uint32_t* visible);
+
+	// World-space bounds of instances whose mesh has the given model-space sphere; the
+	// radius grows with the instance scale.
+	static void transformSpheres(const TransformArrays& transforms, size_t first, size_t count, const float sphere[4],
+		float* centerX, float* centerY, float* centerZ, float* radius);
+};
\ No newline at end of file
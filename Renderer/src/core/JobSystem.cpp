@@ -0,0 +1,125 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+static thread_local uint32_t currentWorkerIndex = UINT32_MAX;
+
+void JobSystem::init(uint32_t threadCount)
+{
+	if (!workers.empty())
+		return;
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	stopping = false;
+	for (uint32_t i = 0; i < threadCount; i++)
+		queues.push_back(std::make_unique<WorkerQueue>());
+
+	for (uint32_t i = 0; i < threadCount; i++)
+		workers.emplace_back(workerLoop, i);
+}
+
+void JobSystem::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeup.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+
+	workers.clear();
+	queues.clear();
+}
+
+uint32_t JobSystem::getThreadIndex()
+{
+	return currentWorkerIndex == UINT32_MAX ? getThreadCount() : currentWorkerIndex;
+}
+
+void JobSystem::push(std::function<void()> job)
+{
+	// workers keep their own jobs local, other threads spread them round-robin
+	uint32_t queueIndex = currentWorkerIndex != UINT32_MAX ? currentWorkerIndex :
+		nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+	// counted before it is visible so the count never drops below the queued jobs
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		pendingJobs.fetch_add(1);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queues[queueIndex]->mutex);
+		queues[queueIndex]->jobs.push_back(std::move(job));
+	}
+	wakeup.notify_one();
+}
+
+bool JobSystem::pop(uint32_t workerIndex, std::function<void()>& job)
+{
+	{
+		WorkerQueue& own = *queues[workerIndex];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			return true;
+		}
+	}
+
+	for (size_t i = 1; i < queues.size(); i++)
+	{
+		WorkerQueue& victim = *queues[(workerIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex)
+{
+	currentWorkerIndex = workerIndex;
+
+	while (true)
+	{
+		std::function<void()> job;
+
+		if (pop(workerIndex, job))
+		{
+			pendingJobs.fetch_sub(1);
+			job();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeup.wait(lock, [] { return stopping || pendingJobs.load() != 0; });
+
+		// queued work is drained before the workers exit
+		if (stopping && pendingJobs.load() == 0)
+			return;
+	}
+}
+
+std::vector<std::thread> JobSystem::workers;
+
+std::vector<std::unique_ptr<JobSystem::WorkerQueue>> JobSystem::queues;
+
+std::atomic<uint32_t> JobSystem::nextQueue{ 0 };
+
+std::atomic<uint32_t> JobSystem::pendingJobs{ 0 };
+
+std::mutex JobSystem::sleepMutex;
+
+std::condition_variable JobSystem::wakeup;
+
+bool JobSystem::stopping = false;
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <type_traits>
+#include <exception>
+
+// Worker pool with one deque per worker. Workers pop their own newest job and steal the
+// oldest job of another worker when they run dry.
+class JobSystem
+{
+public:
+	// 0 uses one worker per hardware thread
+	static void init(uint32_t threadCount = 0);
+	static void shutdown();
+
+	static uint32_t getThreadCount() { return uint32_t(workers.size()); }
+	// 0..getThreadCount()-1 on workers, getThreadCount() on any other thread
+	static uint32_t getThreadIndex();
+
+	template<typename F>
+	static auto submit(F&& function) -> std::future<std::invoke_result_t<F>>
+	{
+		using Result = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+		std::future<Result> future = task->get_future();
+
+		push([task]() { (*task)(); });
+
+		return future;
+	}
+
+	// Calls function(i) for every i in [0, count) on up to maxParallelism threads, the
+	// calling thread included, and returns once all calls finished. The first exception
+	// skips the calls that have not started and is rethrown on the calling thread.
+	template<typename F>
+	static void parallelFor(uint32_t count, uint32_t maxParallelism, const F& function)
+	{
+		struct State
+		{
+			std::atomic<uint32_t> next{ 0 };
+			std::atomic<uint32_t> completed{ 0 };
+			std::atomic<bool> failed{ false };
+			std::mutex errorMutex;
+			std::exception_ptr error;
+			uint32_t count;
+			const F* function;
+		};
+
+		auto state = std::make_shared<State>();
+		state->count = count;
+		state->function = &function;
+
+		// helpers that start late find nothing left and never touch function
+		auto run = [state]() {
+			uint32_t index;
+			while ((index = state->next.fetch_add(1)) < state->count)
+			{
+				// an index counts as completed even when it threw, or the caller never returns
+				if (!state->failed.load(std::memory_order_relaxed))
+				{
+					try
+					{
+						(*state->function)(index);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(state->errorMutex);
+						if (!state->error)
+							state->error = std::current_exception();
+						state->failed = true;
+					}
+				}
+				state->completed.fetch_add(1, std::memory_order_release);
+			}
+		};
+
+		uint32_t helpers = std::min(std::min(maxParallelism, count), getThreadCount() + 1);
+		for (uint32_t i = 1; i < helpers; i++)
+			push(run);
+
+		run();
+
+		while (state->completed.load(std::memory_order_acquire) != count)
+			std::this_thread::yield();
+
+		if (state->error)
+			std::rethrow_exception(state->error);
+	}
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> jobs;
+	};
+
+	static void push(std::function<void()> job);
+	static bool pop(uint32_t workerIndex, std::function<void()>& job);
+	static void workerLoop(uint32_t workerIndex);
+
+private:
+	static std::vector<std::thread> workers;
+	static std::vector<std::unique_ptr<WorkerQueue>> queues;
+	static std::atomic<uint32_t> nextQueue;
+	static std::atomic<uint32_t> pendingJobs;
+
+	// only used to put idle workers to sleep
+	static std::mutex sleepMutex;
+	static std::condition_variable wakeup;
+	static bool stopping;
+};
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "MappedFile.h"
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: view(std::exchange(other.view, nullptr)), length(std::exchange(other.length, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		view = std::exchange(other.view, nullptr);
+		length = std::exchange(other.length, 0);
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+void MappedFile::open(const std::string& path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("cannot open file " + path);
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	length = size_t(fileSize.QuadPart);
+
+	if (length > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+		{
+			view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			// the view keeps the mapping alive
+			CloseHandle(mapping);
+		}
+	}
+
+	CloseHandle(file);
+
+	if (length > 0 && !view)
+	{
+		length = 0;
+		throw std::runtime_error("cannot map file " + path);
+	}
+}
+
+void MappedFile::close()
+{
+	if (view)
+		UnmapViewOfFile(view);
+
+	view = nullptr;
+	length = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+	// PrefetchVirtualMemory needs Windows 8; FILE_FLAG_SEQUENTIAL_SCAN already reads ahead
+	(void)offset;
+	(void)size;
+}
+
+#else
+
+void MappedFile::open(const std::string& path)
+{
+	close();
+
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		throw std::runtime_error("cannot open file " + path);
+
+	struct stat status;
+	fstat(file, &status);
+	length = size_t(status.st_size);
+
+	if (length > 0)
+	{
+		view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view == MAP_FAILED)
+			view = nullptr;
+		else
+			madvise(view, length, MADV_SEQUENTIAL);
+	}
+
+	// the mapping keeps the file alive
+	::close(file);
+
+	if (length > 0 && !view)
+	{
+		length = 0;
+		throw std::runtime_error("cannot map file " + path);
+	}
+}
+
+void MappedFile::close()
+{
+	if (view)
+		munmap(view, length);
+
+	view = nullptr;
+	length = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+	if (!view || offset >= length)
+		return;
+
+	// madvise wants a page aligned start
+	size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+	size_t begin = offset / pageSize * pageSize;
+	size_t end = std::min(offset + size, length);
+	madvise(static_cast<char*>(view) + begin, end - begin, MADV_WILLNEED);
+}
+
+#endif
\ No newline at end of file
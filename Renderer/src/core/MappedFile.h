@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. Pages are faulted in on first touch, so
+// parsing straight out of the mapping avoids both the copy and the up-front read of
+// std::ifstream.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::string& path) { open(path); }
+	~MappedFile() { close(); }
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	void open(const std::string& path);
+	void close();
+
+	// hints the OS to read the range ahead of the parser
+	void prefetch(size_t offset, size_t size) const;
+
+	const char* data() const { return static_cast<const char*>(view); }
+	size_t size() const { return length; }
+
+private:
+	// empty files have no view
+	void* view = nullptr;
+	size_t length = 0;
+};
\ No newline at end of file
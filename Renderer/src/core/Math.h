@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDERER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+struct Vec3
+{
+	float x, y, z;
+};
+
+struct Quat
+{
+	float x, y, z, w;
+
+	static Quat axisAngle(Vec3 axis, float angle)
+	{
+		float length = std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+		float s = length > 0.0f ? std::sin(angle * 0.5f) / length : 0.0f;
+		return { axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f) };
+	}
+};
+
+// Structure-of-arrays inputs of composeTransforms, one array per component.
+struct TransformArrays
+{
+	const float* positionX;
+	const float* positionY;
+	const float* positionZ;
+	// unit quaternions
+	const float* rotationX;
+	const float* rotationY;
+	const float* rotationZ;
+	const float* rotationW;
+	const float* scale;
+};
+
+class Math
+{
+public:
+	// Writes the 3x4 matrix translate * rotate * scale of every transform as three row
+	// arrays of vec4, the layout the instanced vertex shader reads. SSE handles four
+	// transforms per iteration and transposes them into rows; the rest goes scalar.
+	static void composeTransforms(const TransformArrays& in, size_t first, size_t count, float* row0, float* row1, float* row2)
+	{
+		size_t i = first;
+		size_t end = first + count;
+
+#ifdef RENDERER_SSE2
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(in.rotationX + i), y = _mm_loadu_ps(in.rotationY + i);
+			__m128 z = _mm_loadu_ps(in.rotationZ + i), w = _mm_loadu_ps(in.rotationW + i);
+			__m128 s = _mm_loadu_ps(in.scale + i);
+
+			__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+			__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+			__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+			__m128 s2 = _mm_mul_ps(s, two);
+
+			__m128 rows[3][4] = {
+				{ _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), s), _mm_mul_ps(_mm_sub_ps(xy, wz), s2),
+					_mm_mul_ps(_mm_add_ps(xz, wy), s2), _mm_loadu_ps(in.positionX + i) },
+				{ _mm_mul_ps(_mm_add_ps(xy, wz), s2), _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), s),
+					_mm_mul_ps(_mm_sub_ps(yz, wx), s2), _mm_loadu_ps(in.positionY + i) },
+				{ _mm_mul_ps(_mm_sub_ps(xz, wy), s2), _mm_mul_ps(_mm_add_ps(yz, wx), s2),
+					_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), s), _mm_loadu_ps(in.positionZ + i) },
+			};
+
+			float* outputs[3] = { row0, row1, row2 };
+			for (int row = 0; row < 3; row++)
+			{
+				// lanes hold one column for four instances, rows want one instance per vec4
+				_MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+				for (int lane = 0; lane < 4; lane++)
+					_mm_storeu_ps(outputs[row] + (i + lane) * 4, rows[row][lane]);
+			}
+		}
+#endif
+
+		for (; i < end; i++)
+		{
+			float x = in.rotationX[i], y = in.rotationY[i], z = in.rotationZ[i], w = in.rotationW[i], s = in.scale[i];
+
+			float* r0 = row0 + i * 4;
+			float* r1 = row1 + i * 4;
+			float* r2 = row2 + i * 4;
+			r0[0] = (1.0f - 2.0f * (y * y + z * z)) * s;
+			r0[1] = 2.0f * (x * y - w * z) * s;
+			r0[2] = 2.0f * (x * z + w * y) * s;
+			r0[3] = in.positionX[i];
+			r1[0] = 2.0f * (x * y + w * z) * s;
+			r1[1] = (1.0f - 2.0f * (x * x + z * z)) * s;
+			r1[2] = 2.0f * (y * z - w * x) * s;
+			r1[3] = in.positionY[i];
+			r2[0] = 2.0f * (x * z - w * y) * s;
+			r2[1] = 2.0f * (y * z + w * x) * s;
+			r2[2] = (1.0f - 2.0f * (x * x + y * y)) * s;
+			r2[3] = in.positionZ[i];
+		}
+	}
+};
\ No newline at end of file
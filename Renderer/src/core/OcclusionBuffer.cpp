@@ -0,0 +1,99 @@
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <cmath>
+
+// clamped in float first, far off-screen coordinates would overflow an int
+static int pixelIndex(float coordinate, int maxIndex)
+{
+	return int(std::floor(std::min(std::max(coordinate, -1.0f), float(maxIndex + 1))));
+}
+
+void OcclusionBuffer::init(uint32_t width, uint32_t height)
+{
+	this->width = width;
+	this->height = height;
+	depth.resize(size_t(width) * height);
+	clear();
+}
+
+void OcclusionBuffer::clear()
+{
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	occluderCount = 0;
+}
+
+void OcclusionBuffer::addOccluder(const float* positions, const uint32_t* indices, uint32_t indexCount)
+{
+	for (uint32_t i = 0; i + 3 <= indexCount; i += 3)
+		rasterizeTriangle(positions + 3 * indices[i], positions + 3 * indices[i + 1], positions + 3 * indices[i + 2]);
+
+	occluderCount++;
+}
+
+void OcclusionBuffer::rasterizeTriangle(const float* a, const float* b, const float* c)
+{
+	// to pixel coordinates
+	float ax = (a[0] * 0.5f + 0.5f) * width, ay = (a[1] * 0.5f + 0.5f) * height;
+	float bx = (b[0] * 0.5f + 0.5f) * width, by = (b[1] * 0.5f + 0.5f) * height;
+	float cx = (c[0] * 0.5f + 0.5f) * width, cy = (c[1] * 0.5f + 0.5f) * height;
+
+	float area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+	if (area == 0.0f)
+		return;
+
+	// either winding occludes
+	float sign = area > 0.0f ? 1.0f : -1.0f;
+	float triangleDepth = std::min(std::max({ a[2], b[2], c[2] }), 1.0f);
+	if (triangleDepth < 0.0f)
+		return;
+
+	int minX = std::max(0, pixelIndex(std::min({ ax, bx, cx }), width - 1));
+	int maxX = std::min(int(width) - 1, pixelIndex(std::max({ ax, bx, cx }), width - 1));
+	int minY = std::max(0, pixelIndex(std::min({ ay, by, cy }), height - 1));
+	int maxY = std::min(int(height) - 1, pixelIndex(std::max({ ay, by, cy }), height - 1));
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		float py = y + 0.5f;
+		float* row = depth.data() + size_t(y) * width;
+		for (int x = minX; x <= maxX; x++)
+		{
+			// covered when the pixel centre is on the inner side of all three edges
+			float px = x + 0.5f;
+			float e0 = ((bx - ax) * (py - ay) - (by - ay) * (px - ax)) * sign;
+			float e1 = ((cx - bx) * (py - by) - (cy - by) * (px - bx)) * sign;
+			float e2 = ((ax - cx) * (py - cy) - (ay - cy) * (px - cx)) * sign;
+			if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f)
+				row[x] = std::min(row[x], triangleDepth);
+		}
+	}
+}
+
+bool OcclusionBuffer::isVisible(float centerX, float centerY, float centerZ, float radius) const
+{
+	float nearest = centerZ - radius;
+	if (occluderCount == 0 || nearest <= 0.0f)
+		return true;
+
+	// every pixel the rectangle overlaps, not just the ones whose centre it contains
+	int minX = std::max(0, pixelIndex(((centerX - radius) * 0.5f + 0.5f) * width, width - 1));
+	int maxX = std::min(int(width) - 1, pixelIndex(((centerX + radius) * 0.5f + 0.5f) * width, width - 1));
+	int minY = std::max(0, pixelIndex(((centerY - radius) * 0.5f + 0.5f) * height, height - 1));
+	int maxY = std::min(int(height) - 1, pixelIndex(((centerY + radius) * 0.5f + 0.5f) * height, height - 1));
+
+	// off screen is for the frustum test to decide
+	if (minX > maxX || minY > maxY)
+		return true;
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		const float* row = depth.data() + size_t(y) * width;
+		for (int x = minX; x <= maxX; x++)
+		{
+			if (row[x] >= nearest)
+				return true;
+		}
+	}
+
+	return false;
+}
\ No newline at end of file
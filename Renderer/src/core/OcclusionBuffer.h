@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+// Low-resolution depth of a frame's occluders, rasterized on the CPU. Coordinates are
+// clip space of w = 1 positions: x and y in [-1, 1], depth in [0, 1] with 0 nearest.
+// Triangles are written at their farthest depth, so an occluder never hides more than
+// it covers.
+class OcclusionBuffer
+{
+public:
+	void init(uint32_t width, uint32_t height);
+	// resets every pixel to the far plane
+	void clear();
+
+	// positions are xyz triples; not thread safe, add all occluders before testing
+	void addOccluder(const float* positions, const uint32_t* indices, uint32_t indexCount);
+	// false when every pixel the sphere's screen rectangle touches has an occluder in front
+	// of the sphere's nearest point; safe to call from several threads
+	bool isVisible(float centerX, float centerY, float centerZ, float radius) const;
+
+	bool hasOccluders() const { return occluderCount != 0; }
+	uint32_t getWidth() const { return width; }
+	uint32_t getHeight() const { return height; }
+
+private:
+	void rasterizeTriangle(const float* a, const float* b, const float* c);
+
+private:
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t occluderCount = 0;
+	std::vector<float> depth;
+};
\ No newline at end of file
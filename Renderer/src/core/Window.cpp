@@ -13,6 +13,7 @@ Window::Window()
 
 	glfwSetWindowUserPointer(window, this);
 	glfwSetWindowCloseCallback(window, closeCallback);
+	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
 }
 
@@ -34,6 +35,19 @@ void Window::closeCallback(GLFWwindow* window)
 	windowInstance->close = true;
 }
 
+void Window::framebufferSizeCallback(GLFWwindow* window, int width, int height)
+{
+	auto windowInstance = reinterpret_cast<Window*>(glfwGetWindowUserPointer(window));
+	windowInstance->resized = true;
+}
+
+bool Window::wasResized()
+{
+	bool result = resized;
+	resized = false;
+	return result;
+}
+
 bool Window::shouldClose()
 {
 	return close;
@@ -8,7 +8,10 @@ public:
 
 	void shutDown();
 	static void closeCallback(GLFWwindow* window);
+	static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 	bool shouldClose();
+	// true once after every framebuffer resize
+	bool wasResized();
 	void update();
 	inline GLFWwindow* getPointer() { return window; }
 
@@ -21,4 +24,5 @@ private:
 	GLFWwindow* window;
 	uint32_t width = 1280, height = 720;
 	bool close = false;
+	bool resized = false;
 };
\ No newline at end of file
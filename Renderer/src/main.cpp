@@ -1,17 +1,93 @@
 #include "core/Application.h"
 #include <stdexcept>
 #include <iostream>
+#include <string>
 
-void main()
+static AppSettings parseArguments(int argc, char** argv)
 {
-	App app;
+	AppSettings settings;
 
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (argument == "--headless")
+			settings.headless = true;
+		else if (argument == "--frames" && hasValue)
+			settings.frameCount = std::stoull(argv[++i]);
+		else if (argument == "--width" && hasValue)
+			settings.width = std::stoul(argv[++i]);
+		else if (argument == "--height" && hasValue)
+			settings.height = std::stoul(argv[++i]);
+		else if (argument == "--draws" && hasValue)
+			settings.drawCount = std::stoul(argv[++i]);
+		else if (argument == "--threads" && hasValue)
+			settings.recordingThreads = std::stoul(argv[++i]);
+		else if (argument == "--benchmark")
+			settings.benchmark = true;
+		else if (argument == "--warmup" && hasValue)
+			settings.warmupFrames = std::stoul(argv[++i]);
+		else if (argument == "--measure" && hasValue)
+			settings.measuredFrames = std::stoul(argv[++i]);
+		else if (argument == "--output" && hasValue)
+			settings.benchmarkOutput = argv[++i];
+		else if (argument == "--instances" && hasValue)
+			settings.instanceCount = std::stoul(argv[++i]);
+		else if (argument == "--gpu-culling")
+			settings.gpuCulling = true;
+		else if (argument == "--cpu-culling")
+			settings.cpuCulling = true;
+		else if (argument == "--occlusion")
+			settings.occlusionCulling = settings.cpuCulling = true;
+		else if (argument == "--depth-prepass")
+			settings.depthPrepass = true;
+		else if (argument == "--dump-graph")
+			settings.dumpFrameGraph = true;
+		else if (argument == "--hot-reload")
+			settings.shaderHotReload = true;
+		else if (argument == "--latency" && hasValue)
+		{
+			std::string mode = argv[++i];
+			if (mode == "low")
+				settings.latencyMode = Renderer::LatencyMode::LowLatency;
+			else if (mode == "balanced")
+				settings.latencyMode = Renderer::LatencyMode::Balanced;
+			else if (mode == "throughput")
+				settings.latencyMode = Renderer::LatencyMode::Throughput;
+			else
+				throw std::runtime_error("unknown latency mode: " + mode);
+		}
+		else if (argument == "--target-fps" && hasValue)
+		{
+			double framesPerSecond = std::stod(argv[++i]);
+			settings.targetFrameTime = framesPerSecond > 0.0 ? 1000.0 / framesPerSecond : 0.0;
+		}
+		else if (argument == "--mesh" && hasValue)
+			settings.meshPaths.push_back(argv[++i]);
+		else
+			throw std::runtime_error("unknown argument: " + argument);
+	}
+
+	// nothing would ever stop a headless run otherwise
+	if (settings.headless && settings.frameCount == 0)
+		settings.frameCount = 1000;
+
+	return settings;
+}
+
+int main(int argc, char** argv)
+{
 	try
 	{
+		App app(parseArguments(argc, argv));
 		app.run();
 	}
 	catch (std::exception& e)
 	{
 		std::cout << e.what() << std::endl;
+		return 1;
 	}
+
+	return 0;
 }
\ No newline at end of file
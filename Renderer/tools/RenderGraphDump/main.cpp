@@ -0,0 +1,89 @@
+// Compiles an example deferred frame with the render graph and prints the result.
+//
+//   RenderGraphDump [width] [height]
+//
+// Nothing touches a device: the dump shows the culled passes, the merged render passes,
+// every barrier and subpass dependency, and the aliasing plan with the memory sizes
+// estimated from the formats. Builds from src/Renderer/RenderGraph.cpp and
+// src/Renderer/MemoryAllocator.cpp with src on the include path, linked against Vulkan.
+#include "Renderer/RenderGraph.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		VkExtent2D extent = { 1920, 1080 };
+		if (argc > 2)
+			extent = { uint32_t(std::stoul(argv[1])), uint32_t(std::stoul(argv[2])) };
+
+		RenderGraph graph;
+		typedef RenderGraph::Usage Usage;
+		VkClearValue black = {};
+		VkClearValue far = {};
+		far.depthStencil = { 1.0f, 0 };
+
+		RenderGraph::Resource backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, extent,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		RenderGraph::Resource commands = graph.importBuffer("draw commands");
+		RenderGraph::Resource shadowMap = graph.createImage("shadow map", VK_FORMAT_D32_SFLOAT, { 2048, 2048 });
+		RenderGraph::Resource albedo = graph.createImage("albedo", VK_FORMAT_R8G8B8A8_UNORM, extent);
+		RenderGraph::Resource normals = graph.createImage("normals", VK_FORMAT_R16G16B16A16_SFLOAT, extent);
+		RenderGraph::Resource depth = graph.createImage("depth", VK_FORMAT_D32_SFLOAT, extent);
+		RenderGraph::Resource hdr = graph.createImage("hdr", VK_FORMAT_R16G16B16A16_SFLOAT, extent);
+		RenderGraph::Resource bloom = graph.createImage("bloom", VK_FORMAT_R16G16B16A16_SFLOAT, extent);
+		RenderGraph::Resource debug = graph.createImage("debug", VK_FORMAT_R8G8B8A8_UNORM, extent);
+
+		RenderGraph::Pass culling = graph.addPass("culling", RenderGraph::PassType::Compute, nullptr);
+		graph.use(culling, commands, Usage::StorageWrite);
+
+		RenderGraph::Pass shadows = graph.addPass("shadows", RenderGraph::PassType::Graphics, nullptr);
+		graph.use(shadows, commands, Usage::IndirectRead);
+		graph.useAttachment(shadows, shadowMap, Usage::DepthAttachment, far);
+
+		RenderGraph::Pass gbuffer = graph.addPass("gbuffer", RenderGraph::PassType::Graphics, nullptr);
+		graph.use(gbuffer, commands, Usage::IndirectRead);
+		graph.useAttachment(gbuffer, albedo, Usage::ColorAttachment, black);
+		graph.useAttachment(gbuffer, normals, Usage::ColorAttachment, black);
+		graph.useAttachment(gbuffer, depth, Usage::DepthAttachment, far);
+
+		RenderGraph::Pass decals = graph.addPass("decals", RenderGraph::PassType::Graphics, nullptr);
+		graph.use(decals, albedo, Usage::ColorAttachment);
+		graph.use(decals, depth, Usage::DepthAttachment);
+
+		RenderGraph::Pass lighting = graph.addPass("lighting", RenderGraph::PassType::Compute, nullptr);
+		graph.use(lighting, albedo, Usage::Sampled);
+		graph.use(lighting, normals, Usage::Sampled);
+		graph.use(lighting, depth, Usage::Sampled);
+		graph.use(lighting, shadowMap, Usage::Sampled);
+		graph.use(lighting, hdr, Usage::StorageWrite);
+
+		RenderGraph::Pass bloomPass = graph.addPass("bloom", RenderGraph::PassType::Compute, nullptr);
+		graph.use(bloomPass, hdr, Usage::Sampled);
+		graph.use(bloomPass, bloom, Usage::StorageWrite);
+
+		RenderGraph::Pass debugView = graph.addPass("debug view", RenderGraph::PassType::Graphics, nullptr);
+		graph.use(debugView, normals, Usage::Sampled);
+		graph.useAttachment(debugView, debug, Usage::ColorAttachment, black);
+
+		RenderGraph::Pass tonemap = graph.addPass("tonemap", RenderGraph::PassType::Graphics, nullptr);
+		graph.use(tonemap, hdr, Usage::Sampled);
+		graph.use(tonemap, bloom, Usage::Sampled);
+		graph.useAttachment(tonemap, backbuffer, Usage::ColorAttachment, black);
+
+		RenderGraph::Pass ui = graph.addPass("ui", RenderGraph::PassType::Graphics, nullptr);
+		graph.use(ui, backbuffer, Usage::ColorAttachment);
+
+		graph.compile();
+		graph.dump(std::cout);
+	}
+	catch (std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file